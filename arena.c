@@ -0,0 +1,65 @@
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+#define ARENA_BLOCK 16384
+
+void *arena_alloc(Arena *a, size_t size) {
+    size = (size + 7) & ~(size_t)7;
+    if (!a->head || a->head->size - a->head->used < size) {
+        size_t block = size > ARENA_BLOCK / 4 ? size : ARENA_BLOCK;
+        ArenaBlock *b = malloc(sizeof(*b) + block);
+        if (!b) {
+            return NULL;
+        }
+        b->used = 0;
+        b->size = block;
+        if (block == size && a->head) {
+            // Oversized request: keep filling the current block afterwards
+            b->next = a->head->next;
+            a->head->next = b;
+            b->used = size;
+            return b->data;
+        }
+        b->next = a->head;
+        a->head = b;
+    }
+    void *p = a->head->data + a->head->used;
+    a->head->used += size;
+    return p;
+}
+
+char *arena_strdup(Arena *a, const char *s) {
+    size_t len = strlen(s) + 1;
+    char *copy = arena_alloc(a, len);
+    if (copy) {
+        memcpy(copy, s, len);
+    }
+    return copy;
+}
+
+void arena_reset(Arena *a) {
+    ArenaBlock *keep = a->head;
+    if (keep && keep->size != ARENA_BLOCK) {
+        keep = NULL;            // one huge line should not pin its block
+    }
+    for (ArenaBlock *b = a->head, *next; b; b = next) {
+        next = b->next;
+        if (b != keep) {
+            free(b);
+        }
+    }
+    if (keep) {
+        keep->next = NULL;
+        keep->used = 0;
+    }
+    a->head = keep;
+}
+
+void arena_free(Arena *a) {
+    for (ArenaBlock *b = a->head, *next; b; b = next) {
+        next = b->next;
+        free(b);
+    }
+    a->head = NULL;
+}
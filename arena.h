@@ -0,0 +1,31 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Bump allocator: allocations are carved out of large blocks and only ever
+// released together. Used for script variable scopes and for the words of
+// each command line. A zeroed Arena is empty and ready to use.
+
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t             used, size;
+    char               data[];
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock *head;
+} Arena;
+
+// 8-byte aligned; NULL if out of memory
+void *arena_alloc(Arena *a, size_t size);
+char *arena_strdup(Arena *a, const char *s);
+
+// Release everything allocated so far but keep one ordinary block, so an
+// arena reset after every command stops calling malloc once it is warm
+void  arena_reset(Arena *a);
+
+// Release everything, including the blocks
+void  arena_free(Arena *a);
+
+#endif
@@ -0,0 +1,815 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <limits.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <openssl/evp.h>
+#include "audit.h"
+#include "auth.h"
+#include "config.h"
+#include "logger.h"
+#include "worker_pool.h"
+
+// Records larger than a log ring slot are truncated (trailing arguments dropped)
+#define AUDIT_RECORD_MAX 1024
+
+uint32_t audit_command_id(const char *name) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        h = (h ^ *p) * 16777619u;
+    }
+    return h;
+}
+
+// Returns the well-formed record at `pos`, or NULL if [pos, end) does not
+// start with one
+static const AuditRecord *record_at(const char *base, uint64_t pos, uint64_t end) {
+    if (pos + sizeof(AuditRecord) > end) {
+        return NULL;
+    }
+    const AuditRecord *rec = (const AuditRecord *)(base + pos);
+    if (rec->magic != AUDIT_RECORD_MAGIC || rec->length < sizeof(AuditRecord) ||
+        rec->length > end - pos || rec->length % 8 != 0 ||
+        rec->argv_len > rec->length - sizeof(AuditRecord)) {
+        return NULL;
+    }
+    if (rec->type == AUDIT_CHECKPOINT) {
+        return rec->argv_len == 0 ? rec : NULL;
+    }
+    const char *argv = (const char *)(rec + 1);
+    if (rec->type != AUDIT_COMMAND || rec->argv_len == 0 || argv[rec->argv_len - 1] != '\0') {
+        return NULL;
+    }
+    return rec;
+}
+
+// Fetched once: looking the digest up again on every record (as passing
+// EVP_sha256() to each init does on OpenSSL 3) dominates hashing ~100 bytes
+static EVP_MD *sha256_md;
+static pthread_once_t sha256_once = PTHREAD_ONCE_INIT;
+
+static void fetch_sha256(void) {
+    sha256_md = EVP_MD_fetch(NULL, "SHA256", NULL);
+}
+
+static const EVP_MD *chain_md_type(void) {
+    pthread_once(&sha256_once, fetch_sha256);
+    return sha256_md ? sha256_md : EVP_sha256();
+}
+
+// SHA-256(prev || record without its digest field)
+static void chain_digest(EVP_MD_CTX *md, const uint8_t prev[AUDIT_DIGEST_LEN],
+                         const AuditRecord *rec, uint8_t out[AUDIT_DIGEST_LEN]) {
+    const char *bytes = (const char *)rec;
+    EVP_DigestInit_ex(md, chain_md_type(), NULL);
+    EVP_DigestUpdate(md, prev, AUDIT_DIGEST_LEN);
+    EVP_DigestUpdate(md, bytes, offsetof(AuditRecord, digest));
+    EVP_DigestUpdate(md, bytes + sizeof(AuditRecord), rec->length - sizeof(AuditRecord));
+    EVP_DigestFinal_ex(md, out, NULL);
+}
+
+// Chain value before the first record
+static void chain_genesis(const AuditFileHeader *hdr, uint8_t out[AUDIT_DIGEST_LEN]) {
+    EVP_Digest(hdr, sizeof(*hdr), out, NULL, chain_md_type(), NULL);
+}
+
+void audit_timer_start(AuditTimer *timer) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    timer->start_us = (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+    clock_gettime(CLOCK_MONOTONIC, &timer->started);
+}
+
+void audit_finish(const AuditTimer *timer, int argc, char *const argv[], int status) {
+    if (argc <= 0 || !argv[0]) {
+        return;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t elapsed = (int64_t)(now.tv_sec - timer->started.tv_sec) * 1000000 +
+                      (now.tv_nsec - timer->started.tv_nsec) / 1000;
+
+    _Alignas(8) char buf[AUDIT_RECORD_MAX];
+    AuditRecord *rec = (AuditRecord *)buf;
+    memset(rec, 0, sizeof(*rec));
+    rec->magic = AUDIT_RECORD_MAGIC;
+    rec->type = AUDIT_COMMAND;
+    rec->start_us = timer->start_us;
+    rec->duration_us = elapsed > 0 ? (uint64_t)elapsed : 0;
+    rec->status = status;
+    rec->cmd_id = audit_command_id(argv[0]);
+    if (current_user) {
+        size_t n = strnlen(current_user->username, sizeof(rec->user) - 1);
+        memcpy(rec->user, current_user->username, n);
+    }
+
+    // Arguments that do not fit are dropped, keeping the record in one ring slot
+    size_t used = sizeof(*rec);
+    for (int i = 0; i < argc && argv[i]; i++) {
+        size_t len = strlen(argv[i]) + 1;
+        if (used + len > sizeof(buf)) {
+            break;
+        }
+        memcpy(buf + used, argv[i], len);
+        used += len;
+        rec->argc++;
+    }
+    rec->argv_len = (uint16_t)(used - sizeof(*rec));
+
+    size_t padded = (used + 7) & ~(size_t)7;
+    memset(buf + used, 0, padded - used);
+    rec->length = (uint32_t)padded;
+
+    logger_submit_record(buf, padded);
+}
+
+// ---------------------------------------------------------------------------
+// Writer side (log writer thread only)
+// ---------------------------------------------------------------------------
+
+static int data_fd = -1;
+static int index_fd = -1;
+static int writer_failed = 0;
+static uint64_t data_end;         // offset of the next record
+static AuditIndexEntry span;      // records written since the last index entry
+static unsigned int span_records;
+static EVP_MD_CTX *chain_md;
+static uint8_t chain_head[AUDIT_DIGEST_LEN];
+static unsigned int since_checkpoint;   // records in the file since its last checkpoint
+
+static void write_header(int fd, const char *magic) {
+    AuditFileHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, magic, sizeof(hdr.magic));
+    hdr.version = AUDIT_VERSION;
+    hdr.header_size = sizeof(hdr);
+    ssize_t w = write(fd, &hdr, sizeof(hdr));
+    (void)w;
+}
+
+// Open or create a file starting with an AuditFileHeader; returns its size.
+// A log from an older format version is moved aside to <path>.v<N>.
+static int open_with_header(const char *path, const char *magic, off_t *size) {
+    int fd = open(path, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return -1;
+    }
+
+    // Another process may be creating the file too; only one writes the header
+    struct stat st;
+    if (flock(fd, LOCK_EX) != 0 || fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    AuditFileHeader hdr;
+    if (st.st_size > 0) {
+        // Refuse to append to something that is not ours
+        if (pread(fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr) ||
+            memcmp(hdr.magic, magic, sizeof(hdr.magic)) != 0) {
+            close(fd);
+            return -1;
+        }
+        if (hdr.version == AUDIT_VERSION) {
+            flock(fd, LOCK_UN);
+            *size = st.st_size;
+            return fd;
+        }
+
+        char old[512];
+        snprintf(old, sizeof(old), "%s.v%u", path, hdr.version);
+        close(fd);
+        if (rename(path, old) != 0) {
+            return -1;
+        }
+        fd = open(path, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+        if (fd < 0) {
+            return -1;
+        }
+        if (flock(fd, LOCK_EX) != 0 || fstat(fd, &st) != 0) {
+            close(fd);
+            return -1;
+        }
+    }
+
+    // Someone else may have moved the old log aside and started the new one
+    if (st.st_size == 0) {
+        write_header(fd, magic);
+        st.st_size = sizeof(hdr);
+    }
+    flock(fd, LOCK_UN);
+    *size = st.st_size;
+    return fd;
+}
+
+// Find the chain head, the end of the last complete record and the number
+// of records since the last checkpoint. A torn record left by a crash is
+// cut off. Caller holds the lock on data_fd.
+static int resume_chain(uint64_t size) {
+    AuditFileHeader hdr;
+    if (pread(data_fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr)) {
+        return -1;
+    }
+    chain_genesis(&hdr, chain_head);
+    data_end = sizeof(hdr);
+    since_checkpoint = 0;
+    if (size <= sizeof(hdr)) {
+        return 0;
+    }
+
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, data_fd, 0);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    // Every checkpoint starts an index span, so scan from the newest entry
+    // that starts at one; there are at most AUDIT_CHECKPOINT_EVERY entries
+    // after it. Failing that, from the start of a short index, or else from
+    // its newest entry with the count unknown.
+    uint64_t pos = sizeof(hdr), newest = 0;
+    int counted = 1;
+    struct stat ist;
+    if (fstat(index_fd, &ist) == 0) {
+        off_t n = (ist.st_size - (off_t)sizeof(hdr)) / (off_t)sizeof(AuditIndexEntry);
+        off_t oldest = n - 1 - AUDIT_CHECKPOINT_EVERY;
+        int found = 0;
+        for (off_t k = n - 1; k >= 0 && k >= oldest && !found; k--) {
+            AuditIndexEntry e;
+            off_t at = (off_t)sizeof(hdr) + k * (off_t)sizeof(e);
+            if (pread(index_fd, &e, sizeof(e), at) != (ssize_t)sizeof(e) || e.offset < sizeof(hdr)) {
+                continue;
+            }
+            const AuditRecord *rec = record_at(map, e.offset, size);
+            if (!rec) continue;
+            if (!newest) newest = e.offset;
+            if (rec->type == AUDIT_CHECKPOINT) {
+                pos = e.offset;
+                found = 1;
+            }
+        }
+        if (!found && oldest >= 0 && newest) {
+            pos = newest;
+            counted = 0;
+        }
+    }
+
+    const AuditRecord *rec;
+    while ((rec = record_at(map, pos, size)) != NULL) {
+        memcpy(chain_head, rec->digest, AUDIT_DIGEST_LEN);
+        pos += rec->length;
+        if (rec->type == AUDIT_CHECKPOINT) {
+            since_checkpoint = 0;
+            counted = 1;
+        } else {
+            since_checkpoint++;
+        }
+    }
+    if (!counted) {
+        since_checkpoint = AUDIT_CHECKPOINT_EVERY;   // write one with the next record
+    }
+
+    // Only a record cut short by the end of the file is a torn write;
+    // anything else is left in place for logverify to report
+    const AuditRecord *tail = (const AuditRecord *)((const char *)map + pos);
+    int torn = pos < size && (size - pos < sizeof(AuditRecord) ||
+                              (tail->magic == AUDIT_RECORD_MAGIC && tail->length > size - pos));
+    munmap(map, size);
+
+    if (torn) {
+        if (ftruncate(data_fd, pos) != 0) {
+            return -1;
+        }
+        size = pos;
+    }
+    data_end = size;
+    return 0;
+}
+
+// Index entries stay in file order: if another process has already indexed
+// records it appended after ours, ours are left to the gap scan of queries
+static void close_span(void) {
+    if (span_records == 0) return;
+    struct stat st;
+    AuditIndexEntry last;
+    if (fstat(index_fd, &st) == 0 &&
+        (size_t)st.st_size >= sizeof(AuditFileHeader) + sizeof(last) &&
+        pread(index_fd, &last, sizeof(last), st.st_size - sizeof(last)) == (ssize_t)sizeof(last) &&
+        last.offset > span.offset) {
+        span_records = 0;
+        return;
+    }
+    ssize_t w = write(index_fd, &span, sizeof(span));
+    (void)w;
+    span_records = 0;
+}
+
+// Take the writer lock on the data file. Other processes (a batch run next
+// to an interactive session, say) append to the same log, so whatever they
+// wrote since we last held the lock is picked up first: the chain and the
+// index continue from the real end of the file, not from our last record.
+static int lock_writer(void) {
+    while (flock(data_fd, LOCK_EX) != 0) {
+        if (errno != EINTR) return -1;
+    }
+    struct stat st;
+    if (fstat(data_fd, &st) != 0) {
+        flock(data_fd, LOCK_UN);
+        return -1;
+    }
+    if ((uint64_t)st.st_size != data_end) {
+        if ((uint64_t)st.st_size > data_end) {
+            close_span();           // our records end where theirs begin
+        }
+        span_records = 0;
+        if (resume_chain((uint64_t)st.st_size) != 0) {
+            flock(data_fd, LOCK_UN);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int open_writer(void) {
+    if (data_fd >= 0) return 0;
+    if (writer_failed) return -1;
+
+    off_t size = 0, index_size = 0;
+    chain_md = EVP_MD_CTX_new();
+    data_fd = open_with_header(AUDIT_FILE, AUDIT_FILE_MAGIC, &size);
+    if (data_fd >= 0) {
+        index_fd = open_with_header(AUDIT_INDEX_FILE, AUDIT_INDEX_MAGIC, &index_size);
+    }
+    data_end = 0;
+    span_records = 0;
+    if (!chain_md || data_fd < 0 || index_fd < 0 || lock_writer() != 0) {
+        goto fail;
+    }
+
+    // An index that outlived its data file would point at the wrong records
+    struct stat ist;
+    if (data_end == sizeof(AuditFileHeader) && fstat(index_fd, &ist) == 0 &&
+        (size_t)ist.st_size > sizeof(AuditFileHeader) &&
+        ftruncate(index_fd, sizeof(AuditFileHeader)) != 0) {
+        goto fail;
+    }
+    flock(data_fd, LOCK_UN);
+
+    // Records past the last index entry (e.g. after a crash) are found by
+    // queries scanning the unindexed gap, so indexing simply resumes here
+    return 0;
+
+fail:
+    if (index_fd >= 0) close(index_fd);
+    if (data_fd >= 0) close(data_fd);      // also drops the lock
+    index_fd = data_fd = -1;
+    writer_failed = 1;
+    return -1;
+}
+
+static void make_checkpoint(AuditRecord *cp) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    memset(cp, 0, sizeof(*cp));
+    cp->magic = AUDIT_RECORD_MAGIC;
+    cp->length = sizeof(*cp);
+    cp->type = AUDIT_CHECKPOINT;
+    cp->start_us = (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+void audit_write_batch(struct iovec *records, int count) {
+    if (count <= 0 || open_writer() != 0 || lock_writer() != 0) {
+        return;
+    }
+
+    // Chain every record (and any checkpoints due) before writing. Hashing
+    // happens here on the writer thread, never in audit_finish().
+    int max_out = count + count / AUDIT_CHECKPOINT_EVERY + 2;
+    struct iovec out[max_out];
+    AuditRecord checkpoints[count / AUDIT_CHECKPOINT_EVERY + 2];
+    int nout = 0, ncp = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (since_checkpoint >= AUDIT_CHECKPOINT_EVERY) {
+            AuditRecord *cp = &checkpoints[ncp++];
+            make_checkpoint(cp);
+            chain_digest(chain_md, chain_head, cp, cp->digest);
+            memcpy(chain_head, cp->digest, AUDIT_DIGEST_LEN);
+            out[nout].iov_base = cp;
+            out[nout].iov_len = sizeof(*cp);
+            nout++;
+            since_checkpoint = 0;
+        }
+
+        AuditRecord *rec = records[i].iov_base;
+        chain_digest(chain_md, chain_head, rec, rec->digest);
+        memcpy(chain_head, rec->digest, AUDIT_DIGEST_LEN);
+        out[nout++] = records[i];
+        since_checkpoint++;
+    }
+
+    // Remember the layout before writev trims the iovecs
+    int64_t starts[nout];
+    size_t lengths[nout];
+    uint16_t types[nout];
+    for (int i = 0; i < nout; i++) {
+        const AuditRecord *rec = out[i].iov_base;
+        starts[i] = rec->start_us;
+        types[i] = rec->type;
+        lengths[i] = out[i].iov_len;
+    }
+
+    if (logger_writev_all(data_fd, out, nout) != 0) {
+        // The file no longer matches the chain; stop rather than write a broken one
+        writer_failed = 1;
+        audit_writer_close();
+        return;
+    }
+
+    for (int i = 0; i < nout; i++) {
+        // A checkpoint starts a span, which is how resume_chain() finds it
+        if (types[i] == AUDIT_CHECKPOINT) {
+            close_span();
+        }
+        if (span_records == 0) {
+            span.offset = data_end;
+            span.length = 0;
+            span.min_start_us = span.max_start_us = starts[i];
+        }
+        if (starts[i] < span.min_start_us) span.min_start_us = starts[i];
+        if (starts[i] > span.max_start_us) span.max_start_us = starts[i];
+        span.length += lengths[i];
+        data_end += lengths[i];
+
+        if (++span_records >= AUDIT_SPAN_RECORDS || span.length >= AUDIT_SPAN_BYTES) {
+            close_span();
+        }
+    }
+    flock(data_fd, LOCK_UN);
+}
+
+void audit_sync(void) {
+    if (data_fd >= 0) {
+        fdatasync(data_fd);
+        fdatasync(index_fd);
+    }
+}
+
+void audit_writer_close(void) {
+    if (data_fd < 0) return;
+    flock(data_fd, LOCK_EX);       // see close_span()
+    close_span();
+    if (strcmp(log_fsync, "none") != 0) {
+        audit_sync();
+    }
+    close(index_fd);
+    close(data_fd);
+    index_fd = data_fd = -1;
+    EVP_MD_CTX_free(chain_md);
+    chain_md = NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Queries
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const void *base;
+    size_t      size;
+} Mapping;
+
+static int map_file(const char *path, const char *magic, Mapping *m) {
+    m->base = NULL;
+    m->size = 0;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return errno == ENOENT ? 0 : -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    if ((size_t)st.st_size < sizeof(AuditFileHeader)) {
+        close(fd);
+        return 0;
+    }
+
+    void *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return -1;
+    }
+
+    const AuditFileHeader *hdr = base;
+    if (memcmp(hdr->magic, magic, sizeof(hdr->magic)) != 0 || hdr->version != AUDIT_VERSION) {
+        munmap(base, st.st_size);
+        errno = EINVAL;
+        return -1;
+    }
+    m->base = base;
+    m->size = st.st_size;
+    return 0;
+}
+
+static void unmap_file(Mapping *m) {
+    if (m->base) {
+        munmap((void *)m->base, m->size);
+    }
+}
+
+static int record_matches(const AuditRecord *rec, const char *argv,
+                          const AuditFilter *f, uint32_t cmd_id) {
+    if (rec->start_us < f->since_us || rec->start_us > f->until_us) {
+        return 0;
+    }
+    if (f->cmd && (rec->cmd_id != cmd_id || strcmp(argv, f->cmd) != 0)) {
+        return 0;
+    }
+    if (f->user && strncmp(rec->user, f->user, sizeof(rec->user) - 1) != 0) {
+        return 0;
+    }
+    return 1;
+}
+
+// Visit matching records in [from, to); stops at the first malformed record
+static long scan_range(const Mapping *data, uint64_t from, uint64_t to,
+                       const AuditFilter *f, uint32_t cmd_id,
+                       AuditVisitor visit, void *ctx) {
+    long matches = 0;
+    const char *base = data->base;
+    uint64_t pos = from;
+
+    const AuditRecord *rec;
+    while ((rec = record_at(base, pos, to)) != NULL) {
+        const char *argv = (const char *)(rec + 1);
+        if (rec->type == AUDIT_COMMAND && record_matches(rec, argv, f, cmd_id)) {
+            visit(rec, argv, ctx);
+            matches++;
+        }
+        pos += rec->length;
+    }
+    return matches;
+}
+
+long audit_query(const AuditFilter *f, AuditVisitor visit, void *ctx) {
+    // Include records still queued for the log writer
+    logger_flush();
+
+    Mapping data, index;
+    if (map_file(AUDIT_FILE, AUDIT_FILE_MAGIC, &data) != 0) {
+        return -1;
+    }
+    if (!data.base) {
+        return 0;
+    }
+    if (map_file(AUDIT_INDEX_FILE, AUDIT_INDEX_MAGIC, &index) != 0) {
+        index.base = NULL;   // no usable index: scan everything
+        index.size = 0;
+    }
+
+    uint32_t cmd_id = f->cmd ? audit_command_id(f->cmd) : 0;
+    long matches = 0;
+    uint64_t cursor = sizeof(AuditFileHeader);
+
+    if (index.base) {
+        const AuditIndexEntry *entries =
+            (const AuditIndexEntry *)((const char *)index.base + sizeof(AuditFileHeader));
+        size_t n = (index.size - sizeof(AuditFileHeader)) / sizeof(AuditIndexEntry);
+
+        for (size_t i = 0; i < n; i++) {
+            const AuditIndexEntry *e = &entries[i];
+            if (e->offset < cursor || e->offset + e->length > data.size) {
+                continue;   // stale or corrupt entry
+            }
+            // Records written while no index entry covered them
+            if (e->offset > cursor) {
+                matches += scan_range(&data, cursor, e->offset, f, cmd_id, visit, ctx);
+            }
+            if (e->max_start_us >= f->since_us && e->min_start_us <= f->until_us) {
+                matches += scan_range(&data, e->offset, e->offset + e->length,
+                                      f, cmd_id, visit, ctx);
+            }
+            cursor = e->offset + e->length;
+        }
+    }
+
+    // Tail that has not been indexed yet
+    matches += scan_range(&data, cursor, data.size, f, cmd_id, visit, ctx);
+
+    unmap_file(&index);
+    unmap_file(&data);
+    return matches;
+}
+
+// ---------------------------------------------------------------------------
+// Chain verification
+// ---------------------------------------------------------------------------
+
+// Records after checkpoint `start` (or from the first record) up to and
+// including the next checkpoint, verified from the digest they chain from
+typedef struct {
+    uint64_t from, to;
+    const uint8_t *prev;      // digest preceding `from`
+} VerifySpan;
+
+typedef struct {
+    const char     *base;
+    VerifySpan     *spans;
+    int             nspans;
+    uint8_t         genesis[AUDIT_DIGEST_LEN];
+    atomic_int      next_span;
+    atomic_long     bad_offset;      // lowest mismatch found, LONG_MAX if none
+    atomic_int      threads;
+    int             spans_done;
+    int             refs;            // caller + queued helpers; last one frees
+    pthread_mutex_t lock;
+    pthread_cond_t  all_done;
+} VerifyJob;
+
+static void verify_span(VerifyJob *job, const VerifySpan *sp, EVP_MD_CTX *md) {
+    uint8_t prev[AUDIT_DIGEST_LEN], digest[AUDIT_DIGEST_LEN];
+    memcpy(prev, sp->prev, AUDIT_DIGEST_LEN);
+
+    for (uint64_t pos = sp->from; pos < sp->to; ) {
+        const AuditRecord *rec = (const AuditRecord *)(job->base + pos);
+        chain_digest(md, prev, rec, digest);
+        if (memcmp(digest, rec->digest, AUDIT_DIGEST_LEN) != 0) {
+            long seen = atomic_load(&job->bad_offset);
+            while ((long)pos < seen &&
+                   !atomic_compare_exchange_weak(&job->bad_offset, &seen, (long)pos)) {
+            }
+            return;
+        }
+        memcpy(prev, rec->digest, AUDIT_DIGEST_LEN);
+        pos += rec->length;
+    }
+}
+
+static void release_job(VerifyJob *job) {
+    pthread_mutex_lock(&job->lock);
+    int last = (--job->refs == 0);
+    pthread_mutex_unlock(&job->lock);
+    if (last) {
+        pthread_mutex_destroy(&job->lock);
+        pthread_cond_destroy(&job->all_done);
+        free(job->spans);
+        free(job);
+    }
+}
+
+// Verify spans until none is left unclaimed. Run by the caller and by
+// worker-pool helpers alike, so verification completes even if every
+// worker is busy.
+static void claim_spans(VerifyJob *job, EVP_MD_CTX *md) {
+    int did_work = 0;
+    int i;
+
+    while ((i = atomic_fetch_add(&job->next_span, 1)) < job->nspans) {
+        verify_span(job, &job->spans[i], md);
+        did_work = 1;
+        pthread_mutex_lock(&job->lock);
+        if (++job->spans_done == job->nspans) {
+            pthread_cond_broadcast(&job->all_done);
+        }
+        pthread_mutex_unlock(&job->lock);
+    }
+    if (did_work) {
+        atomic_fetch_add(&job->threads, 1);
+    }
+}
+
+// A helper without a digest context just claims nothing; the caller has
+// its own and covers whatever is left
+static void verify_worker(void *arg) {
+    VerifyJob *job = arg;
+    EVP_MD_CTX *md = EVP_MD_CTX_new();
+    if (md) {
+        claim_spans(job, md);
+        EVP_MD_CTX_free(md);
+    }
+    release_job(job);
+}
+
+static void add_span(VerifyJob *job, int *cap, uint64_t from, uint64_t to, const uint8_t *prev) {
+    if (job->nspans == *cap) {
+        int grown_cap = *cap ? *cap * 2 : 64;
+        VerifySpan *grown = realloc(job->spans, grown_cap * sizeof(VerifySpan));
+        if (!grown) {
+            // Fold into the previous span; it just verifies further
+            if (job->nspans > 0) job->spans[job->nspans - 1].to = to;
+            return;
+        }
+        job->spans = grown;
+        *cap = grown_cap;
+    }
+    job->spans[job->nspans++] = (VerifySpan){ from, to, prev };
+}
+
+int audit_verify(AuditVerifyResult *result) {
+    memset(result, 0, sizeof(*result));
+    result->bad_offset = -1;
+
+    // Everything queued so far should be covered
+    logger_flush();
+
+    Mapping data;
+    if (map_file(AUDIT_FILE, AUDIT_FILE_MAGIC, &data) != 0) {
+        return -1;
+    }
+    if (!data.base) {
+        return 0;
+    }
+    madvise((void *)data.base, data.size, MADV_WILLNEED);
+
+    VerifyJob *job = calloc(1, sizeof(VerifyJob));
+    if (!job) {
+        unmap_file(&data);
+        return -1;
+    }
+    job->base = data.base;
+    chain_genesis(data.base, job->genesis);
+    atomic_init(&job->bad_offset, LONG_MAX);
+    pthread_mutex_init(&job->lock, NULL);
+    pthread_cond_init(&job->all_done, NULL);
+
+    // Cheap sequential pass over record headers to find checkpoints
+    int cap = 0;
+    uint64_t pos = sizeof(AuditFileHeader), span_start = pos;
+    const uint8_t *span_prev = job->genesis;
+    const AuditRecord *rec, *last = NULL;
+    while ((rec = record_at(data.base, pos, data.size)) != NULL) {
+        result->records++;
+        pos += rec->length;
+        last = rec;
+        if (rec->type == AUDIT_CHECKPOINT) {
+            result->checkpoints++;
+            add_span(job, &cap, span_start, pos, span_prev);
+            span_start = pos;
+            span_prev = rec->digest;
+        }
+    }
+    if (span_start < pos) {
+        add_span(job, &cap, span_start, pos, span_prev);
+    }
+
+    job->refs = 1;
+    EVP_MD_CTX *md = EVP_MD_CTX_new();
+    if (!md) {
+        release_job(job);
+        unmap_file(&data);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    // Helpers from the worker pool, plus this thread
+    int helpers = worker_pool_size();
+    if (helpers > job->nspans - 1) helpers = job->nspans - 1;
+    for (int i = 0; i < helpers; i++) {
+        pthread_mutex_lock(&job->lock);
+        job->refs++;
+        pthread_mutex_unlock(&job->lock);
+        if (worker_pool_submit(verify_worker, job) != 0) {
+            pthread_mutex_lock(&job->lock);
+            job->refs--;
+            pthread_mutex_unlock(&job->lock);
+            break;
+        }
+    }
+
+    claim_spans(job, md);
+    EVP_MD_CTX_free(md);
+
+    pthread_mutex_lock(&job->lock);
+    while (job->spans_done < job->nspans) {
+        pthread_cond_wait(&job->all_done, &job->lock);
+    }
+    pthread_mutex_unlock(&job->lock);
+
+    long bad = atomic_load(&job->bad_offset);
+    result->spans = job->nspans;
+    result->threads = atomic_load(&job->threads);
+    result->size = (long)pos;
+    if (bad != LONG_MAX) {
+        result->bad_offset = bad;
+    } else if (pos < data.size) {
+        result->bad_offset = (long)pos;   // unparseable data after the last good record
+    }
+    if (last) {
+        memcpy(result->head, last->digest, AUDIT_DIGEST_LEN);
+    }
+
+    release_job(job);
+    unmap_file(&data);
+    return 0;
+}
@@ -0,0 +1,116 @@
+#ifndef AUDIT_H
+#define AUDIT_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/uio.h>
+
+// Structured audit log: one fixed-layout binary record per finished command,
+// plus a sparse index of record spans so queries can skip most of the file.
+// All integers are stored in host byte order.
+//
+// Records form a hash chain: each digest is SHA-256 over the previous
+// record's digest and this record (minus the digest field); the first
+// record chains from SHA-256 of the file header. Checkpoint records, written
+// after every AUDIT_CHECKPOINT_EVERY records of the file (whichever process
+// appended them), split the chain into spans that can be verified
+// independently.
+#define AUDIT_FILE        "securecli.audit"
+#define AUDIT_INDEX_FILE  "securecli.audit.idx"
+
+#define AUDIT_FILE_MAGIC   "SCAUDIT1"
+#define AUDIT_INDEX_MAGIC  "SCAIDX01"
+#define AUDIT_RECORD_MAGIC 0x52445541u    // "AUDR"
+#define AUDIT_VERSION      2              // v1 logs had no hash chain
+
+#define AUDIT_DIGEST_LEN       32
+#define AUDIT_CHECKPOINT_EVERY 4096
+
+// AuditRecord.type
+enum { AUDIT_COMMAND = 0, AUDIT_CHECKPOINT = 1 };
+
+// Starts both the data file and the index file
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t header_size;
+} AuditFileHeader;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t length;          // whole record incl. argv and padding, multiple of 8
+    int64_t  start_us;        // wall-clock start of the command (µs since epoch)
+    uint64_t duration_us;
+    int32_t  status;          // exit status; 128+N if killed by signal N
+    uint32_t cmd_id;          // audit_command_id(argv[0])
+    uint16_t argc;
+    uint16_t argv_len;        // bytes of NUL-terminated argv strings after the header
+    uint16_t type;            // AUDIT_COMMAND or AUDIT_CHECKPOINT (no argv)
+    uint16_t reserved;
+    char     user[24];
+    uint8_t  digest[AUDIT_DIGEST_LEN];   // filled in by the log writer
+} AuditRecord;                // 96 bytes
+
+// One entry per span of consecutive records. Records are appended when a
+// command finishes, so start times are only roughly ordered; each span
+// carries its own min/max and queries skip spans outside the range.
+typedef struct {
+    uint64_t offset;
+    uint64_t length;
+    int64_t  min_start_us;
+    int64_t  max_start_us;
+} AuditIndexEntry;
+
+#define AUDIT_SPAN_RECORDS 256
+#define AUDIT_SPAN_BYTES   (64 * 1024)
+
+// Times a command for audit_finish()
+typedef struct {
+    int64_t         start_us;
+    struct timespec started;  // CLOCK_MONOTONIC
+} AuditTimer;
+
+void audit_timer_start(AuditTimer *timer);
+
+// Queue the record for a finished command (any thread; written by the log
+// writer thread, see logger.h)
+void audit_finish(const AuditTimer *timer, int argc, char *const argv[], int status);
+
+// Stable command ID (FNV-1a of the command name)
+uint32_t audit_command_id(const char *name);
+
+// Log writer thread only
+void audit_write_batch(struct iovec *records, int count);
+void audit_sync(void);
+void audit_writer_close(void);
+
+typedef struct {
+    int64_t     since_us;     // INT64_MIN for no lower bound
+    int64_t     until_us;     // INT64_MAX for no upper bound
+    const char *user;         // NULL matches anyone
+    const char *cmd;          // NULL matches any command
+} AuditFilter;
+
+// argv holds rec->argc NUL-terminated strings
+typedef void (*AuditVisitor)(const AuditRecord *rec, const char *argv, void *ctx);
+
+// Memory-map the audit log and call `visit` for every matching record.
+// Returns the number of matches, or -1 if the log cannot be read.
+long audit_query(const AuditFilter *filter, AuditVisitor visit, void *ctx);
+
+typedef struct {
+    long    records;          // records checked, checkpoints included
+    long    checkpoints;
+    int     spans;            // checkpoint-delimited spans verified in parallel
+    int     threads;
+    long    bad_offset;       // first record whose digest does not match, or -1
+    long    size;             // bytes of log covered
+    uint8_t head[AUDIT_DIGEST_LEN];   // digest of the last record (chain head)
+} AuditVerifyResult;
+
+// Check the hash chain of the whole log. Returns 0 with the outcome in
+// *result (bad_offset >= 0 if the chain is broken), or -1 with errno set if
+// the log is unreadable or there is no memory to check it with.
+int audit_verify(AuditVerifyResult *result);
+
+#endif
@@ -1,10 +1,12 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <openssl/sha.h>
 #include "auth.h"
 #include <stdbool.h>
 #include <termios.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #define MAX_USERS 10
 #define USER_FILE "users.db"
 
@@ -29,7 +31,7 @@ static void hash_password(const char *password, char *output) {
 void load_users() {
     FILE *f = fopen(USER_FILE, "r");
     if (!f) {
-        printf("⚠️  No user database found (%s).\n", USER_FILE);
+        fprintf(stderr, "⚠️  No user database found (%s).\n", USER_FILE);
         return;
     }
     while (fscanf(f, "%49s %64s %9s",
@@ -70,9 +72,23 @@ static void read_password(char *password, size_t max_len) {
     printf("\n");  // Print newline after password input
 }
 
+// The user with these credentials, or NULL
+static User *authenticate(const char *user, const char *pass) {
+    char hash[65];
+    hash_password(pass, hash);
+
+    for (int i = 0; i < user_count; i++) {
+        if (strcmp(users[i].username, user) == 0 &&
+            strcmp(users[i].password_hash, hash) == 0) {
+            return &users[i];
+        }
+    }
+    return NULL;
+}
+
 // Login function
 int login() {
-    char user[50], pass[50], hash[65];
+    char user[50], pass[50];
     int c;
 
     printf("Username: ");
@@ -87,21 +103,71 @@ int login() {
     fflush(stdout);  // Ensure prompt is displayed
     read_password(pass, sizeof(pass));
 
-    hash_password(pass, hash);
-
-    for (int i = 0; i < user_count; i++) {
-        if (strcmp(users[i].username, user) == 0 &&
-            strcmp(users[i].password_hash, hash) == 0) {
-            current_user = &users[i];
-            printf("✅  Login successful. Welcome %s (%s)\n",
-                   user, current_user->role);
-            return 1;
-        }
+    current_user = authenticate(user, pass);
+    memset(pass, 0, sizeof(pass));
+    if (current_user) {
+        printf("✅  Login successful. Welcome %s (%s)\n",
+               user, current_user->role);
+        return 1;
     }
     printf("❌  Invalid credentials.\n");
     return 0;
 }
 
+// Read "user:password" from the first line of a key file only its owner can read
+static int read_key_file(const char *path, char *buf, size_t size) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "Cannot open key file %s\n", path);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fileno(f), &st) != 0 || st.st_uid != geteuid() || (st.st_mode & 077)) {
+        fprintf(stderr, "Key file %s must belong to you and not be accessible by others (chmod 600)\n", path);
+        fclose(f);
+        return -1;
+    }
+    if (!fgets(buf, (int)size, f)) {
+        buf[0] = '\0';
+    }
+    fclose(f);
+    buf[strcspn(buf, "\r\n")] = '\0';
+    return 0;
+}
+
+int login_batch(const char *key_file) {
+    char cred[128] = "";
+    if (!key_file) {
+        key_file = getenv(KEY_FILE_ENV);
+    }
+    if (key_file) {
+        if (read_key_file(key_file, cred, sizeof(cred)) != 0) {
+            return 0;
+        }
+    } else {
+        const char *token = getenv(TOKEN_ENV);
+        if (!token) {
+            fprintf(stderr, "No credentials: use -k KEYFILE, $%s or $%s\n", KEY_FILE_ENV, TOKEN_ENV);
+            return 0;
+        }
+        snprintf(cred, sizeof(cred), "%s", token);
+    }
+    // Programs started by the batch command must not see the token
+    unsetenv(TOKEN_ENV);
+
+    char *pass = strchr(cred, ':');
+    if (pass) {
+        *pass++ = '\0';
+        current_user = authenticate(cred, pass);
+    }
+    memset(cred, 0, sizeof(cred));
+    if (!current_user) {
+        fprintf(stderr, "❌  Invalid credentials.\n");
+        return 0;
+    }
+    return 1;
+}
+
 bool is_admin() {
     return current_user && strcmp(current_user->role, "admin") == 0;
 }
@@ -11,8 +11,18 @@ typedef struct {
 
 extern User *current_user;
 
+// Batch mode credentials ("user:password"): a key file readable only by
+// its owner, named with -k or in $SECURECLI_KEY_FILE, else $SECURECLI_TOKEN
+#define KEY_FILE_ENV "SECURECLI_KEY_FILE"
+#define TOKEN_ENV    "SECURECLI_TOKEN"
+
 void load_users();
 int login();
+
+// Log in without prompting (batch mode). Returns 0 after printing the
+// reason to stderr if there are no valid credentials.
+int login_batch(const char *key_file);
+
 bool is_admin();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,167 @@
+// Audit log benchmark: append latency with the hash chain, writer
+// throughput, and parallel chain verification.
+//
+// Usage: ./bench/bench_audit [records] [producer-threads]
+//
+// Runs in a fresh temporary directory. Each producer times every
+// audit_finish() call (what a command pays to log itself); hashing and
+// writing happen on the log writer thread. The log is then verified with
+// audit_verify().
+//
+// First, two processes append to one log at once, as a batch run next to an
+// interactive session does, and that log must verify too.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "audit.h"
+#include "auth.h"
+#include "logger.h"
+
+// Normally defined in auth.c
+User *current_user = NULL;
+
+static long per_thread;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void *producer(void *arg) {
+    double *lat = arg;
+    char index_arg[32];
+    char *argv[] = { "checksum", index_arg, NULL };
+
+    for (long i = 0; i < per_thread; i++) {
+        snprintf(index_arg, sizeof(index_arg), "file-%ld.bin", i);
+        AuditTimer timer;
+        audit_timer_start(&timer);
+        double t0 = now_sec();
+        audit_finish(&timer, 2, argv, 0);
+        lat[i] = now_sec() - t0;
+    }
+    return NULL;
+}
+
+// Each record is flushed on its own so the two writers interleave
+static int two_writers(long each) {
+    if (mkdir("two-writers", 0700) != 0 || chdir("two-writers") != 0) {
+        perror("two-writers");
+        return -1;
+    }
+    pid_t pids[2];
+    for (int w = 0; w < 2; w++) {
+        pids[w] = fork();
+        if (pids[w] == 0) {
+            char *argv[] = { w ? "whoami" : "hello", NULL };
+            for (long i = 0; i < each; i++) {
+                AuditTimer timer;
+                audit_timer_start(&timer);
+                audit_finish(&timer, 1, argv, 0);
+                logger_flush();
+            }
+            logger_shutdown();
+            _exit(0);
+        }
+    }
+    for (int w = 0; w < 2; w++) {
+        if (pids[w] > 0) {
+            waitpid(pids[w], NULL, 0);
+        }
+    }
+
+    AuditVerifyResult res;
+    int rc = audit_verify(&res);
+    if (rc == 0) {
+        printf("two writers:         %ld records, %ld checkpoints, %s\n",
+               res.records, res.checkpoints, res.bad_offset < 0 ? "intact" : "BROKEN");
+    } else {
+        perror("audit_verify");
+    }
+    unlink(AUDIT_FILE);
+    unlink(AUDIT_INDEX_FILE);
+    unlink(LOG_FILE);
+    if (chdir("..") == 0) {
+        rmdir("two-writers");
+    }
+    return rc == 0 && res.bad_offset < 0 ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+    long records = argc > 1 ? atol(argv[1]) : 500000;
+    int threads = argc > 2 ? atoi(argv[2]) : 2;
+    if (records <= 0 || threads <= 0) {
+        fprintf(stderr, "Usage: %s [records] [producer-threads]\n", argv[0]);
+        return 1;
+    }
+    per_thread = records / threads;
+
+    char dir[] = "/tmp/bench_audit.XXXXXX";
+    if (!mkdtemp(dir) || chdir(dir) != 0) {
+        perror("mkdtemp");
+        return 1;
+    }
+    // Before this process starts its own log writer, which fork() would not copy
+    int shared_ok = two_writers(3000) == 0;
+
+    pthread_t tids[threads];
+    double *lat[threads];
+    double t0 = now_sec();
+    for (int t = 0; t < threads; t++) {
+        lat[t] = malloc(per_thread * sizeof(double));
+        pthread_create(&tids[t], NULL, producer, lat[t]);
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(tids[t], NULL);
+    }
+    double enqueued = now_sec() - t0;
+    logger_flush();
+    double written = now_sec() - t0;
+
+    long total = per_thread * threads;
+    double *all = malloc(total * sizeof(double));
+    for (int t = 0; t < threads; t++) {
+        memcpy(all + t * per_thread, lat[t], per_thread * sizeof(double));
+        free(lat[t]);
+    }
+    qsort(all, total, sizeof(double), compare_double);
+
+    printf("records:             %ld (%d producers)\n", total, threads);
+    printf("audit_finish p50:    %.2f us\n", all[total / 2] * 1e6);
+    printf("audit_finish p99:    %.2f us\n", all[total * 99 / 100] * 1e6);
+    printf("producers done:      %.3f s\n", enqueued);
+    printf("written + chained:   %.3f s (%.0f records/s)\n", written, total / written);
+    free(all);
+
+    AuditVerifyResult res;
+    double v0 = now_sec();
+    if (audit_verify(&res) != 0) {
+        perror("audit_verify");
+        return 1;
+    }
+    double verify = now_sec() - v0;
+    printf("verify:              %.3f s, %d spans on %d threads, %.1f MB/s, %s\n",
+           verify, res.spans, res.threads, res.size / verify / (1024 * 1024),
+           res.bad_offset < 0 ? "intact" : "BROKEN");
+
+    logger_shutdown();
+    unlink(AUDIT_FILE);
+    unlink(AUDIT_INDEX_FILE);
+    unlink(LOG_FILE);
+    if (chdir("/") == 0) {
+        rmdir(dir);
+    }
+    return shared_ok && res.bad_offset < 0 ? 0 : 1;
+}
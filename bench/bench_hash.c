@@ -0,0 +1,110 @@
+// PATH lookup benchmark: posix_spawnp(), which tries execve() in every PATH
+// directory until one succeeds (what the launcher did before), versus
+// launch_program() with the path cache, which execs the remembered path.
+//
+// Usage: ./bench/bench_hash [iterations] [path-dirs]
+//
+// PATH is set to `path-dirs` empty scratch directories followed by the
+// original PATH, the shape of a PATH grown by toolchains and version
+// managers. Both methods start `true` that many times; the difference is the
+// failed execve() calls in the children.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <spawn.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "launcher.h"
+#include "path_cache.h"
+
+extern char **environ;
+
+// Normally defined in main.c; launch_wait_foreground() writes it
+volatile pid_t foreground_pid = 0;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static pid_t spawn_with_spawnp(char *const argv[]) {
+    pid_t pid;
+    int err = posix_spawnp(&pid, argv[0], NULL, NULL, argv, environ);
+    return err == 0 ? pid : -1;
+}
+
+static pid_t spawn_with_cache(char *const argv[]) {
+    LaunchOptions opts;
+    launch_options_init(&opts);
+    return launch_program(argv, &opts);
+}
+
+static double run(const char *label, pid_t (*spawn)(char *const[]), int iterations) {
+    char *argv[] = { "true", NULL };
+    double start = now_sec();
+    for (int i = 0; i < iterations; i++) {
+        pid_t pid = spawn(argv);
+        if (pid < 0) {
+            perror(label);
+            exit(1);
+        }
+        waitpid(pid, NULL, 0);
+    }
+    double elapsed = now_sec() - start;
+    printf("%-14s %8d spawns in %7.3f s  %8.1f us/spawn\n",
+           label, iterations, elapsed, elapsed * 1e6 / iterations);
+    return elapsed;
+}
+
+int main(int argc, char *argv[]) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 2000;
+    int dirs = argc > 2 ? atoi(argv[2]) : 30;
+    if (iterations < 1 || dirs < 0) {
+        fprintf(stderr, "Usage: %s [iterations] [path-dirs]\n", argv[0]);
+        return 1;
+    }
+
+    char root[] = "/tmp/bench_hash.XXXXXX";
+    if (!mkdtemp(root)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    const char *old_path = getenv("PATH");
+    size_t cap = (size_t)dirs * (sizeof(root) + 16) + strlen(old_path ? old_path : "") + 1;
+    char *path = malloc(cap);
+    if (!path) {
+        perror("malloc");
+        return 1;
+    }
+    size_t len = 0;
+    for (int i = 0; i < dirs; i++) {
+        char dir[PATH_MAX];
+        snprintf(dir, sizeof(dir), "%s/bin%03d", root, i);
+        mkdir(dir, 0755);
+        len += (size_t)snprintf(path + len, cap - len, "%s:", dir);
+    }
+    snprintf(path + len, cap - len, "%s", old_path ? old_path : "/bin:/usr/bin");
+    setenv("PATH", path, 1);
+
+    char resolved[PATH_MAX];
+    path_cache_lookup("true", resolved, sizeof(resolved));
+    printf("PATH: %d empty directories, then the usual ones; true is %s\n", dirs, resolved);
+
+    double plain = run("posix_spawnp", spawn_with_spawnp, iterations);
+    double cached = run("path cache", spawn_with_cache, iterations);
+    printf("Speedup: %.2fx\n", plain / cached);
+
+    for (int i = 0; i < dirs; i++) {
+        char dir[PATH_MAX];
+        snprintf(dir, sizeof(dir), "%s/bin%03d", root, i);
+        rmdir(dir);
+    }
+    rmdir(root);
+    free(path);
+    return 0;
+}
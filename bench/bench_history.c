@@ -0,0 +1,119 @@
+// History benchmark: startup and Ctrl+R search over a large history file.
+//
+// Usage: ./bench/bench_history [entries]
+//
+// Writes `entries` generated command lines (about a third of them repeats,
+// as real history has) to a scratch .securecli_history, then compares
+//   - startup: readline's read_history() of the whole file, which the
+//     prompt used to do, against cmdhist_init() reading only the tail
+//   - the one-time index build on the first Ctrl+R
+//   - fuzzy searches through the index against readline's substring
+//     history_search() over the whole list
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <readline/readline.h>
+#include <readline/history.h>
+#include "cmdhist.h"
+#include "config.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const char *verbs[] = {
+    "exec ls -la", "exec grep -rn", "checksum", "show", "list", "copy",
+    "logquery --since 7d --user", "exec git log --oneline", "run --nice 19 make -C",
+    "exec tail -n 200", "source --profile", "metrics status", "encrypt",
+};
+static const char *objects[] = {
+    "src", "build/release", "notes.txt", "/var/log/syslog", "backup.tar.gz",
+    "alice", "bob", "scripts/deploy.cli", "reports/2024-q3.csv", "README.md",
+};
+
+int main(int argc, char *argv[]) {
+    long entries = argc > 1 ? atol(argv[1]) : 1000000;
+    if (entries < 1) {
+        fprintf(stderr, "Usage: %s [entries]\n", argv[0]);
+        return 1;
+    }
+
+    char dir[] = "/tmp/bench_history.XXXXXX";
+    if (!mkdtemp(dir) || chdir(dir) != 0) {
+        perror("mkdtemp");
+        return 1;
+    }
+    FILE *f = fopen(".securecli_history", "w");
+    if (!f) {
+        perror(".securecli_history");
+        return 1;
+    }
+    srand(42);
+    long nverbs = sizeof(verbs) / sizeof(verbs[0]), nobjects = sizeof(objects) / sizeof(objects[0]);
+    for (long i = 0; i < entries; i++) {
+        // Two thirds of the lines are unique, the rest are repeats
+        long n = rand() % 3 ? i : rand() % 1000;
+        fprintf(f, "%s %s/%ld\n", verbs[n % nverbs], objects[(n / nverbs) % nobjects], n);
+    }
+    fclose(f);
+    history_max_kb = 0;         // measure the file as written, no compaction
+
+    // cmdhist_init() first: timed after read_history(), the first malloc
+    // would pay for consolidating the million entries clear_history() freed
+    double start = now_sec();
+    cmdhist_init(".securecli_history");
+    double tail_load = now_sec() - start;
+    int tail_entries = history_length;
+
+    clear_history();
+    unstifle_history();
+    start = now_sec();
+    read_history(".securecli_history");
+    double readline_load = now_sec() - start;
+    printf("%ld entries\n", entries);
+    printf("  startup, read_history(): %9.2f ms  (%d entries in memory)\n",
+           readline_load * 1e3, history_length);
+    printf("  startup, cmdhist_init(): %9.2f ms  (%d entries in memory)\n",
+           tail_load * 1e3, tail_entries);
+
+    start = now_sec();
+    long count = cmdhist_count();
+    printf("  index build (1st Ctrl+R): %8.2f ms  (%ld lines)\n",
+           (now_sec() - start) * 1e3, count);
+
+    // Fuzzy queries: recent matches, an old one, and two that match nothing,
+    // one whose characters pass many masks and one that no mask passes
+    static const char *queries[] = { "lgq alice", "gitlogREADME", "chkbak/12", "zzz", "jj" };
+    for (size_t q = 0; q < sizeof(queries) / sizeof(queries[0]); q++) {
+        int runs = 20;
+        long found = -1;
+        start = now_sec();
+        for (int r = 0; r < runs; r++) {
+            found = cmdhist_search(queries[q], count - 1);
+        }
+        double t = (now_sec() - start) / runs;
+        printf("  fuzzy \"%s\": %8.3f ms  -> %s\n", queries[q], t * 1e3,
+               found >= 0 ? cmdhist_entry(found) : "(none)");
+    }
+
+    // readline's own Ctrl+R: substring search backwards through its list
+    int runs = 5;
+    start = now_sec();
+    for (int r = 0; r < runs; r++) {
+        history_set_pos(history_length - 1);
+        history_search("zzz", -1);
+    }
+    printf("  readline history_search \"zzz\": %8.3f ms\n", (now_sec() - start) / runs * 1e3);
+
+    cmdhist_close();
+    unlink(".securecli_history");
+    if (chdir("/") == 0) {
+        rmdir(dir);
+    }
+    return 0;
+}
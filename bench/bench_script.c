@@ -0,0 +1,104 @@
+// Script runner benchmark: running a .cli script from the compiled-script
+// cache versus compiling it on every run (what script_execute() did before
+// the cache: read, strip, expand and tokenize each line every time).
+//
+// Usage: ./bench/bench_script [lines] [runs]
+//
+// Works in a temporary directory (the command log goes there too). The
+// script alternates `set` lines with lines that expand a variable, and the
+// cold runs bump the file's mtime before each run to force a recompile.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "script.h"
+#include "signals.h"
+
+// Normally defined in main.c
+volatile pid_t foreground_pid = 0;
+volatile sig_atomic_t in_batch = 0;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double time_runs(const char *path, int runs, int cold) {
+    double start = now_sec();
+    for (int i = 0; i < runs; i++) {
+        if (cold) {
+            struct timespec times[2] = { { 0, UTIME_OMIT }, { i + 1, 0 } };
+            utimensat(AT_FDCWD, path, times, 0);
+        }
+        script_execute(path);
+    }
+    return now_sec() - start;
+}
+
+int main(int argc, char *argv[]) {
+    int lines = argc > 1 ? atoi(argv[1]) : 200;
+    int runs = argc > 2 ? atoi(argv[2]) : 2000;
+    if (lines <= 0 || runs <= 0) {
+        fprintf(stderr, "Usage: %s [lines] [runs]\n", argv[0]);
+        return 1;
+    }
+
+    char dir[] = "/tmp/bench_script.XXXXXX";
+    if (!mkdtemp(dir) || chdir(dir) != 0) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    const char *path = "bench.cli";
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+    fprintf(f, "# benchmark script\n");
+    for (int i = 0; i < lines; i++) {
+        if (i % 2 == 0) {
+            fprintf(f, "set VAR%d value-%d\n", i % 10, i);
+        } else {
+            fprintf(f, "  set COPY%d $VAR%d-$VAR%d\n", i % 10, (i - 1) % 10, (i + 9) % 10);
+        }
+    }
+    fclose(f);
+
+    // Script output is not what is being measured
+    int saved = dup(STDOUT_FILENO);
+    if (!freopen("/dev/null", "w", stdout)) {
+        perror("/dev/null");
+        return 1;
+    }
+
+    script_execute(path);   // warm up the log writer and the page cache
+    double cold = time_runs(path, runs, 1);
+    double warm = time_runs(path, runs, 0);
+
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+
+    printf("%d-line script, %d runs\n", lines, runs);
+    printf("  compile every run: %8.1f us/run\n", cold / runs * 1e6);
+    printf("  cached:            %8.1f us/run  (%.1fx)\n", warm / runs * 1e6, cold / warm);
+
+    // The script and the command log with its rotations
+    DIR *d = opendir(".");
+    for (struct dirent *de; d && (de = readdir(d)) != NULL; ) {
+        if (de->d_name[0] != '.') unlink(de->d_name);
+    }
+    if (d) closedir(d);
+    if (chdir("/") != 0) {
+        perror("chdir");
+    }
+    rmdir(dir);
+    return 0;
+}
@@ -0,0 +1,83 @@
+// Spawn-latency benchmark: fork()+execvp() versus launch_program().
+//
+// Usage: ./bench/bench_spawn [iterations] [parent-heap-MB]
+//
+// The parent first dirties `parent-heap-MB` of memory so that fork() has a
+// realistically large address space to copy page tables for, then starts
+// /bin/true repeatedly with each method and reports spawns per second.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "launcher.h"
+
+// Normally defined in main.c; launch_wait_foreground() writes it
+volatile pid_t foreground_pid = 0;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// The exec path as cmd_exec/cmd_run had it before the launcher
+static pid_t spawn_with_fork(char *const argv[]) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+    return pid;
+}
+
+static pid_t spawn_with_launcher(char *const argv[]) {
+    LaunchOptions opts = { .detach = 0, .limits = NULL };
+    return launch_program(argv, &opts);
+}
+
+static double run(const char *label, pid_t (*spawn)(char *const[]), int iterations) {
+    char *argv[] = { "true", NULL };
+    double start = now_sec();
+    for (int i = 0; i < iterations; i++) {
+        pid_t pid = spawn(argv);
+        if (pid < 0) {
+            perror(label);
+            exit(1);
+        }
+        waitpid(pid, NULL, 0);
+    }
+    double elapsed = now_sec() - start;
+    double rate = iterations / elapsed;
+    printf("%-14s %8d spawns in %7.3f s  %10.1f spawns/s  %8.1f us/spawn\n",
+           label, iterations, elapsed, rate, elapsed * 1e6 / iterations);
+    return rate;
+}
+
+int main(int argc, char *argv[]) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 2000;
+    size_t heap_mb = (argc > 2) ? (size_t)atol(argv[2]) : 256;
+
+    char *heap = NULL;
+    if (heap_mb > 0) {
+        heap = malloc(heap_mb * 1024 * 1024);
+        if (!heap) {
+            perror("malloc");
+            return 1;
+        }
+        memset(heap, 1, heap_mb * 1024 * 1024);
+    }
+
+    printf("Parent heap: %zu MB, iterations: %d\n", heap_mb, iterations);
+    double fork_rate = run("fork+execvp", spawn_with_fork, iterations);
+    double spawn_rate = run("posix_spawn", spawn_with_launcher, iterations);
+    printf("Speedup: %.2fx\n", spawn_rate / fork_rate);
+
+    free(heap);
+    return 0;
+}
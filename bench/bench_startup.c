@@ -0,0 +1,121 @@
+// Cold-start benchmark for batch mode: how long `project -c <cmd>` and
+// `project <script.cli>` take from exec to exit, next to /bin/true as the
+// floor of what any process costs.
+//
+// Usage: ./bench/bench_startup [iterations] [path-to-project]
+//
+// Runs in a scratch directory with its own users.db (admin / "password")
+// and authenticates through SECURECLI_TOKEN, so the audit log and history of
+// the working tree are left alone. Reports mean, median and p99 per mode.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <spawn.h>
+#include <time.h>
+#include <unistd.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+// SHA-256("password")
+#define PASSWORD_HASH "5e884898da28047151d0e56f8dc6292773603d0d6aabbdd62a11ef721d1542d8"
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void write_file(const char *path, const char *text) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        exit(1);
+    }
+    fputs(text, f);
+    fclose(f);
+}
+
+static void run(const char *label, char *const argv[], int iterations, double *samples) {
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+
+    for (int i = 0; i < iterations; i++) {
+        double start = now_us();
+        pid_t pid;
+        int status;
+        if (posix_spawn(&pid, argv[0], &actions, NULL, argv, environ) != 0) {
+            perror(argv[0]);
+            exit(1);
+        }
+        waitpid(pid, &status, 0);
+        samples[i] = now_us() - start;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "%s: exited with status %d\n", label, WEXITSTATUS(status));
+            exit(1);
+        }
+    }
+    posix_spawn_file_actions_destroy(&actions);
+
+    double sum = 0;
+    for (int i = 0; i < iterations; i++) {
+        sum += samples[i];
+    }
+    qsort(samples, iterations, sizeof(double), cmp_double);
+    printf("%-22s mean %8.1f us   p50 %8.1f us   p99 %8.1f us\n", label,
+           sum / iterations, samples[iterations / 2], samples[(int)(iterations * 0.99)]);
+}
+
+int main(int argc, char *argv[]) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 300;
+    const char *project = (argc > 2) ? argv[2] : "./project";
+    if (iterations < 1) {
+        iterations = 1;
+    }
+
+    char binary[PATH_MAX];
+    if (!realpath(project, binary)) {
+        perror(project);
+        return 1;
+    }
+
+    char dir[] = "/tmp/bench_startup.XXXXXX";
+    if (!mkdtemp(dir) || chdir(dir) != 0) {
+        perror("mkdtemp");
+        return 1;
+    }
+    write_file("users.db", "admin " PASSWORD_HASH " admin\n");
+    write_file("startup.cli", "hello\nwhoami\n");
+    setenv("SECURECLI_TOKEN", "admin:password", 1);
+
+    double *samples = malloc(iterations * sizeof(double));
+    if (!samples) {
+        perror("malloc");
+        return 1;
+    }
+
+    char *true_argv[] = { "/bin/true", NULL };
+    char *command_argv[] = { binary, "-c", "hello", NULL };
+    char *script_argv[] = { binary, "startup.cli", NULL };
+
+    printf("Iterations: %d\n", iterations);
+    run("/bin/true", true_argv, iterations, samples);
+    // The token is consumed (unset) by each child, not by us
+    run("project -c hello", command_argv, iterations, samples);
+    run("project startup.cli", script_argv, iterations, samples);
+
+    free(samples);
+    // Leave nothing behind: users.db, the script, and the logs the runs wrote
+    char cmd[PATH_MAX + 16];
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", dir);
+    return system(cmd) == 0 ? 0 : 1;
+}
@@ -0,0 +1,47 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include "cli_output.h"
+
+static __thread FILE *capture = NULL;
+static __thread int status = 0;
+
+FILE *cli_out(void) {
+    return capture ? capture : stdout;
+}
+
+FILE *cli_err(void) {
+    return capture ? capture : stderr;
+}
+
+void cli_set_capture(FILE *stream) {
+    capture = stream;
+}
+
+int cli_printf(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vfprintf(cli_out(), fmt, ap);
+    va_end(ap);
+    return n;
+}
+
+void cli_perror(const char *msg) {
+    int err = errno;
+    char buf[128];
+    // GNU strerror_r returns the message (thread-safe, unlike strerror)
+    fprintf(cli_err(), "%s: %s\n", msg, strerror_r(err, buf, sizeof(buf)));
+    if (status == 0) {
+        status = 1;
+    }
+    errno = err;
+}
+
+void cli_set_status(int value) {
+    status = value;
+}
+
+int cli_status(void) {
+    return status;
+}
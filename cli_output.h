@@ -0,0 +1,27 @@
+#ifndef CLI_OUTPUT_H
+#define CLI_OUTPUT_H
+
+#include <stdio.h>
+
+// Command output goes through these instead of stdout/stderr directly, so a
+// built-in running as a background task can have its output captured.
+// Each thread has its own destination; by default that is stdout/stderr.
+
+// Current thread's output and error streams
+FILE *cli_out(void);
+FILE *cli_err(void);
+
+// Send this thread's output and errors to `stream` (NULL restores stdout/stderr)
+void cli_set_capture(FILE *stream);
+
+// printf/perror equivalents that honour the capture
+int  cli_printf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+void cli_perror(const char *msg);
+
+// Exit status of the command running on this thread, recorded in the audit
+// log. The dispatcher resets it to 0; cli_perror() sets 1 if still 0, and
+// commands that run programs store the program's exit code.
+void cli_set_status(int status);
+int  cli_status(void);
+
+#endif
@@ -0,0 +1,546 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <readline/readline.h>
+#include <readline/history.h>
+#include "cmdhist.h"
+#include "config.h"
+
+#define HISTORY_RECENT  1000        // entries in readline's list for Up/Down
+#define TAIL_CHUNK      65536       // bytes read per step when loading the tail
+#define QUERY_MAX       256
+
+static char  file_path[PATH_MAX];
+static int   file_fd = -1;
+static off_t file_size;             // as far as we know; other sessions append too
+
+// ---------------------------------------------------------------------------
+// File: incremental appends and compaction
+// ---------------------------------------------------------------------------
+
+static int open_file(void) {
+    file_fd = open(file_path, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+    if (file_fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    file_size = fstat(file_fd, &st) == 0 ? st.st_size : 0;
+    return 0;
+}
+
+// Another session may have compacted the file, i.e. renamed a new one over
+// the inode we hold. Reopen so our appends land in the file others read.
+static int replaced(void) {
+    struct stat ours, named;
+    if (fstat(file_fd, &ours) != 0 || stat(file_path, &named) != 0) {
+        return 1;
+    }
+    return ours.st_ino != named.st_ino || ours.st_dev != named.st_dev;
+}
+
+static long limit_bytes(void) {
+    return history_max_kb > 0 ? (long)history_max_kb * 1024 : 0;
+}
+
+// Keep only the newest limit_bytes() of whole lines. Runs under an exclusive
+// lock on the old file, which appending sessions lock shared: they wait, see
+// the file was replaced, and reopen.
+static void compact(void) {
+    long limit = limit_bytes();
+    if (limit == 0 || flock(file_fd, LOCK_EX) != 0) {
+        return;
+    }
+    struct stat st;
+    if (replaced() || fstat(file_fd, &st) != 0 || st.st_size <= limit) {
+        // Someone else got there first
+        flock(file_fd, LOCK_UN);
+        close(file_fd);
+        open_file();
+        return;
+    }
+
+    off_t start = st.st_size - limit;
+    char *buf = malloc((size_t)limit);
+    char tmp[PATH_MAX + 16];
+    snprintf(tmp, sizeof(tmp), "%s.%d", file_path, (int)getpid());
+    ssize_t n = buf ? pread(file_fd, buf, (size_t)limit, start) : -1;
+    if (n > 0) {
+        // Drop the partial line the cut landed in
+        char *keep = memchr(buf, '\n', (size_t)n);
+        keep = keep ? keep + 1 : buf + n;
+        size_t len = (size_t)(buf + n - keep);
+
+        int out = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (out >= 0) {
+            int ok = write(out, keep, len) == (ssize_t)len && fsync(out) == 0;
+            close(out);
+            if (!ok || rename(tmp, file_path) != 0) {
+                unlink(tmp);
+            }
+        }
+    }
+    free(buf);
+
+    flock(file_fd, LOCK_UN);
+    close(file_fd);
+    open_file();
+}
+
+static void append_line(const char *line) {
+    if (file_fd < 0) {
+        return;
+    }
+    for (int tries = 0; tries < 3; tries++) {
+        if (flock(file_fd, LOCK_SH) != 0) {
+            break;
+        }
+        if (!replaced()) {
+            break;
+        }
+        flock(file_fd, LOCK_UN);
+        close(file_fd);
+        if (open_file() != 0) {
+            return;
+        }
+    }
+
+    // One write per entry: O_APPEND keeps concurrent sessions' lines whole
+    struct iovec iov[2] = {
+        { (void *)line, strlen(line) },
+        { "\n", 1 },
+    };
+    ssize_t n = writev(file_fd, iov, 2);
+    flock(file_fd, LOCK_UN);
+    if (n > 0) {
+        file_size += n;
+    }
+
+    long limit = limit_bytes();
+    if (limit > 0 && file_size > limit + limit / 4) {
+        compact();
+    }
+}
+
+// Put the newest HISTORY_RECENT lines into readline's list, reading the file
+// backwards from the end in TAIL_CHUNK steps rather than all of it
+static void load_recent(void) {
+    char *buf = NULL;
+    size_t len = 0;
+    off_t start = file_size;
+    int newlines = 0;
+    while (start > 0 && newlines <= HISTORY_RECENT) {
+        size_t chunk = start > TAIL_CHUNK ? TAIL_CHUNK : (size_t)start;
+        char *grown = malloc(chunk + len + 1);
+        if (!grown) {
+            break;
+        }
+        ssize_t n = pread(file_fd, grown, chunk, start - (off_t)chunk);
+        if (n != (ssize_t)chunk) {
+            free(grown);
+            break;
+        }
+        if (len) {
+            memcpy(grown + chunk, buf, len);
+        }
+        free(buf);
+        buf = grown;
+        len += chunk;
+        start -= (off_t)chunk;
+        for (size_t i = 0; i < chunk; i++) {
+            newlines += buf[i] == '\n';
+        }
+    }
+    if (!buf) {
+        return;
+    }
+    buf[len] = '\0';
+
+    char *p = buf, *end = buf + len;
+    // Skip all but the last HISTORY_RECENT lines. When we stopped mid-file
+    // there are more newlines than that, so the fragment before the first
+    // one is always skipped.
+    for (int skip = newlines - HISTORY_RECENT; skip > 0; skip--) {
+        char *nl = memchr(p, '\n', (size_t)(end - p));
+        if (!nl) {
+            break;
+        }
+        p = nl + 1;
+    }
+    while (p < end) {
+        char *nl = memchr(p, '\n', (size_t)(end - p));
+        if (!nl) {
+            nl = end;
+        }
+        *nl = '\0';
+        if (*p) {
+            add_history(p);
+        }
+        p = nl + 1;
+    }
+    free(buf);
+}
+
+// ---------------------------------------------------------------------------
+// Search index: where each line starts, and a 64-bit mask of the characters
+// it contains. A query's mask rejects almost every line with one AND before
+// any text is looked at.
+// ---------------------------------------------------------------------------
+
+static struct {
+    char     *text;         // lines back to back, NUL-terminated
+    size_t    text_len, text_cap;
+    size_t   *offsets;
+    uint64_t *masks;
+    size_t    count, cap;
+    int       built;
+} ix;
+
+static inline unsigned char fold(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+// Letters and digits get a bit each; everything else shares the rest
+static inline uint64_t char_bit(unsigned char c) {
+    c = fold(c);
+    if (c >= 'a' && c <= 'z') return 1ull << (c - 'a');
+    if (c >= '0' && c <= '9') return 1ull << (26 + c - '0');
+    return 1ull << (36 + c % 28);
+}
+
+static uint64_t char_bits[256];     // char_bit() of every byte, for indexing
+
+static int reserve(size_t want) {
+    if (want <= ix.cap) {
+        return 0;
+    }
+    size_t cap = ix.cap ? ix.cap : 4096;
+    while (cap < want) {
+        cap *= 2;
+    }
+    size_t *offsets = realloc(ix.offsets, cap * sizeof(size_t));
+    if (offsets) ix.offsets = offsets;
+    uint64_t *masks = realloc(ix.masks, cap * sizeof(uint64_t));
+    if (masks) ix.masks = masks;
+    if (!offsets || !masks) {
+        return -1;
+    }
+    ix.cap = cap;
+    return 0;
+}
+
+// Index the line at ix.text + off, ending it at its newline. Returns its length.
+static size_t index_line(size_t off) {
+    unsigned char *start = (unsigned char *)ix.text + off, *p = start;
+    uint64_t mask = 0;
+    for (; *p && *p != '\n'; p++) {
+        mask |= char_bits[*p];
+    }
+    *p = '\0';
+    if (p > start && reserve(ix.count + 1) == 0) {
+        ix.offsets[ix.count] = off;
+        ix.masks[ix.count] = mask;
+        ix.count++;
+    }
+    return (size_t)(p - start);
+}
+
+// Read the whole file once and index it in place: newlines become the NULs
+static void build_index(void) {
+    ix.built = 1;
+    for (int c = 0; c < 256; c++) {
+        char_bits[c] = char_bit((unsigned char)c);
+    }
+    struct stat st;
+    if (file_fd < 0 || fstat(file_fd, &st) != 0) {
+        return;
+    }
+    size_t size = (size_t)st.st_size;
+    ix.text = malloc(size + 1);
+    if (!ix.text) {
+        return;
+    }
+    ix.text_cap = size + 1;
+    ssize_t n = size ? pread(file_fd, ix.text, size, 0) : 0;
+    ix.text_len = n > 0 ? (size_t)n : 0;
+    ix.text[ix.text_len] = '\0';
+
+    // Size the tables once instead of doubling through a million lines
+    size_t lines = 1;
+    for (const char *p = ix.text; (p = memchr(p, '\n', ix.text + ix.text_len - p)) != NULL; p++) {
+        lines++;
+    }
+    reserve(lines);
+
+    for (size_t off = 0; off < ix.text_len; ) {
+        off += index_line(off) + 1;
+    }
+    if (ix.text_len && ix.text[ix.text_len - 1] != '\0') {
+        ix.text_len++;              // unterminated last line: keep its NUL
+    }
+}
+
+static void index_add(const char *line) {
+    size_t len = strlen(line) + 1;
+    if (ix.text_len + len > ix.text_cap) {
+        size_t cap = ix.text_cap ? ix.text_cap * 2 : 65536;
+        while (cap < ix.text_len + len) {
+            cap *= 2;
+        }
+        char *text = realloc(ix.text, cap);
+        if (!text) {
+            return;
+        }
+        ix.text = text;
+        ix.text_cap = cap;
+    }
+    memcpy(ix.text + ix.text_len, line, len);
+    index_line(ix.text_len);
+    ix.text_len += len;
+}
+
+long cmdhist_count(void) {
+    if (!ix.built) {
+        build_index();
+    }
+    return (long)ix.count;
+}
+
+const char *cmdhist_entry(long i) {
+    return (i >= 0 && (size_t)i < ix.count) ? ix.text + ix.offsets[i] : NULL;
+}
+
+// `q` appears in `s` as a subsequence; `q` is already folded if icase
+static int fuzzy_match(const char *s, const char *q, int icase) {
+    for (; *q; q++) {
+        unsigned char want = (unsigned char)*q;
+        for (;;) {
+            unsigned char c = (unsigned char)*s++;
+            if (c == '\0') {
+                return 0;
+            }
+            if ((icase ? fold(c) : c) == want) {
+                break;
+            }
+        }
+    }
+    return 1;
+}
+
+long cmdhist_search(const char *query, long from) {
+    long count = cmdhist_count();
+    if (from >= count) {
+        from = count - 1;
+    }
+
+    char folded[QUERY_MAX];
+    int icase = 1;
+    uint64_t need = 0;
+    size_t qlen = 0;
+    for (const unsigned char *p = (const unsigned char *)query; *p && qlen < sizeof(folded) - 1; p++) {
+        if (*p >= 'A' && *p <= 'Z') {
+            icase = 0;
+        }
+        folded[qlen++] = (char)fold(*p);
+        need |= char_bit(*p);
+    }
+    folded[qlen] = '\0';
+    const char *q = icase ? folded : query;
+
+    const uint64_t *masks = ix.masks;
+    for (long i = from; i >= 0; i--) {
+        uint64_t m = masks[i];
+        if ((m & need) == need && fuzzy_match(ix.text + ix.offsets[i], q, icase)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// ---------------------------------------------------------------------------
+// Ctrl+R: fuzzy reverse search at the prompt. Typing narrows the search from
+// the current match, Ctrl+R steps to an older match, Backspace goes back one
+// step. Enter runs the match; Ctrl+G or Esc restores the line; any other key
+// leaves the match on the line for editing.
+// ---------------------------------------------------------------------------
+
+// A lone Esc, as opposed to the start of an arrow key's escape sequence
+static int lone_escape(void) {
+    struct pollfd pfd = { .fd = fileno(rl_instream ? rl_instream : stdin), .events = POLLIN };
+    if (poll(&pfd, 1, 20) <= 0) {
+        return 1;
+    }
+    // Swallow the sequence (ESC [ ... final byte, or ESC O x)
+    int c = rl_read_key();
+    if (c == '[' || c == 'O') {
+        do {
+            c = rl_read_key();
+        } while (c > 0 && (c < 0x40 || c > 0x7e));
+    }
+    return 0;
+}
+
+// Lines offered so far in one search, so that a command entered a thousand
+// times is offered once rather than for a thousand Ctrl+R presses
+typedef struct {
+    long  *v;
+    size_t n, cap;
+} Offered;
+
+static int offered_before(const Offered *o, long i) {
+    const char *line = cmdhist_entry(i);
+    for (size_t k = 0; k < o->n; k++) {
+        if (o->v[k] != i && strcmp(cmdhist_entry(o->v[k]), line) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Newest match at or before `from` that is not a repeat of one offered
+static long next_match(Offered *o, const char *query, long from) {
+    long i = cmdhist_search(query, from);
+    while (i >= 0 && offered_before(o, i)) {
+        i = cmdhist_search(query, i - 1);
+    }
+    if (i >= 0 && o->n == o->cap) {
+        size_t cap = o->cap ? o->cap * 2 : 16;
+        long *v = realloc(o->v, cap * sizeof(long));
+        if (!v) {
+            return i;
+        }
+        o->v = v;
+        o->cap = cap;
+    }
+    if (i >= 0) {
+        o->v[o->n++] = i;
+    }
+    return i;
+}
+
+static int fuzzy_search(int count, int key) {
+    (void)count; (void)key;
+    char *saved_line = rl_copy_text(0, rl_end);
+    int saved_point = rl_point;
+
+    char query[QUERY_MAX] = "";
+    long matches[QUERY_MAX];        // state before each query character
+    char failures[QUERY_MAX];
+    size_t qlen = 0;
+    long match = -1;
+    int failed = 0;
+    Offered offered = { NULL, 0, 0 };
+
+    rl_save_prompt();
+    for (;;) {
+        rl_message("(%sfuzzy-search)`%s': ", failed ? "failed " : "", query);
+        if (match >= 0) {
+            rl_replace_line(cmdhist_entry(match), 0);
+            rl_point = rl_end;
+        }
+        rl_redisplay();
+
+        int c = rl_read_key();
+        if (c == CTRL('R')) {
+            long older = (qlen && match > 0) ? next_match(&offered, query, match - 1) : -1;
+            if (older >= 0) {
+                match = older;
+                failed = 0;
+            } else {
+                failed = qlen > 0;
+                rl_ding();
+            }
+        } else if (c == 127 || c == CTRL('H')) {
+            if (qlen) {
+                query[--qlen] = '\0';
+                match = matches[qlen];
+                failed = failures[qlen];
+                if (match < 0) {
+                    rl_replace_line(saved_line, 0);
+                    rl_point = saved_point;
+                }
+            }
+        } else if (c == CTRL('G') || (c == ESC && lone_escape())) {
+            rl_replace_line(saved_line, 0);
+            rl_point = saved_point;
+            break;
+        } else if (c == ESC) {
+            break;                  // arrow key: edit the match
+        } else if (c >= 32 && c != 127) {
+            if (qlen == QUERY_MAX - 1) {
+                rl_ding();
+                continue;
+            }
+            matches[qlen] = match;
+            failures[qlen] = (char)failed;
+            query[qlen++] = (char)c;
+            query[qlen] = '\0';
+            if (!failed) {
+                // Continue from the current match, like readline's i-search
+                long found = next_match(&offered, query, match >= 0 ? match : cmdhist_count() - 1);
+                if (found >= 0) {
+                    match = found;
+                } else {
+                    failed = 1;
+                    rl_ding();
+                }
+            }
+        } else {
+            rl_execute_next(c);     // Enter, Tab, Ctrl+A, ...: act on the match
+            break;
+        }
+    }
+    rl_restore_prompt();
+    rl_clear_message();
+    free(offered.v);
+    free(saved_line);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+
+void cmdhist_init(const char *path) {
+    // Absolute, so compaction and reopening still work after a cd
+    char cwd[PATH_MAX];
+    int n = -1;
+    if (path[0] != '/' && getcwd(cwd, sizeof(cwd))) {
+        n = snprintf(file_path, sizeof(file_path), "%s/%s", cwd, path);
+    }
+    if (n < 0 || (size_t)n >= sizeof(file_path)) {
+        snprintf(file_path, sizeof(file_path), "%s", path);
+    }
+
+    using_history();
+    stifle_history(HISTORY_RECENT);
+    rl_bind_key(CTRL('R'), fuzzy_search);
+    if (open_file() != 0) {
+        return;
+    }
+    long limit = limit_bytes();
+    if (limit > 0 && file_size > limit + limit / 4) {
+        compact();
+    }
+    load_recent();
+}
+
+void cmdhist_add(const char *line) {
+    add_history(line);
+    append_line(line);
+    if (ix.built) {
+        index_add(line);
+    }
+}
+
+void cmdhist_close(void) {
+    if (file_fd >= 0) {
+        close(file_fd);
+        file_fd = -1;
+    }
+}
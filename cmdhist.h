@@ -0,0 +1,31 @@
+#ifndef CMDHIST_H
+#define CMDHIST_H
+
+// Command history for the interactive prompt (.securecli_history).
+//
+// Lines are appended to the file as they are entered, so a crash loses
+// nothing, and the file is compacted to its newest history_max_kb once it
+// outgrows that by a quarter. Startup reads only the tail of the file into
+// readline's list for Up/Down; the whole file is read the first time Ctrl+R
+// runs a fuzzy search over it.
+
+// Open (creating) the history file, load its newest entries into readline
+// and bind Ctrl+R to the fuzzy reverse search
+void cmdhist_init(const char *path);
+
+// Record an entered line: readline's list, the file, and the search index
+void cmdhist_add(const char *line);
+
+void cmdhist_close(void);
+
+// Search index. Entries are numbered oldest first. Building it on first use
+// is the only time the whole file is read.
+long cmdhist_count(void);
+const char *cmdhist_entry(long i);
+
+// Newest entry at or before index `from` that contains the characters of
+// `query` in order (smart case: case-insensitive unless the query has an
+// upper-case letter). Returns its index, or -1 if none does.
+long cmdhist_search(const char *query, long from);
+
+#endif
@@ -0,0 +1,513 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "collectors.h"
+
+// Read a small /proc file into buf (NUL-terminated); returns its length or -1
+static ssize_t read_small(int dirfd, const char *path, char *buf, size_t size) {
+    int fd = openat(dirfd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    ssize_t n = read(fd, buf, size - 1);
+    close(fd);
+    if (n < 0) {
+        return -1;
+    }
+    buf[n] = '\0';
+    return n;
+}
+
+// -------------------- Memory --------------------
+
+int meminfo_read(MemInfo *m) {
+    char buf[4096];
+    memset(m, 0, sizeof(*m));
+    if (read_small(AT_FDCWD, "/proc/meminfo", buf, sizeof(buf)) < 0) {
+        return -1;
+    }
+
+    // The three fields we need are the first three lines
+    for (char *line = buf; line && *line; ) {
+        char *next = strchr(line, '\n');
+        if (next) *next++ = '\0';
+        sscanf(line, "MemTotal: %ld kB", &m->total_kb);
+        sscanf(line, "MemFree: %ld kB", &m->free_kb);
+        if (sscanf(line, "MemAvailable: %ld kB", &m->available_kb) == 1) break;
+        line = next;
+    }
+    return m->total_kb > 0 ? 0 : -1;
+}
+
+// -------------------- Processes --------------------
+
+int proc_sampler_init(ProcSampler *s) {
+    memset(s, 0, sizeof(*s));
+    s->proc_dir = opendir("/proc");
+    if (!s->proc_dir) {
+        return -1;
+    }
+    s->hz = sysconf(_SC_CLK_TCK);
+    s->page_kb = sysconf(_SC_PAGESIZE) / 1024;
+    if (s->hz <= 0) s->hz = 100;
+    if (s->page_kb <= 0) s->page_kb = 4;
+    return 0;
+}
+
+void proc_sampler_free(ProcSampler *s) {
+    if (s->proc_dir) closedir(s->proc_dir);
+    free(s->cur);
+    free(s->prev);
+    free(s->heap);
+    memset(s, 0, sizeof(*s));
+}
+
+// Parse the fields we use from /proc/[pid]/stat. The command name is in
+// parentheses and may itself contain spaces or parentheses.
+static int parse_stat(char *buf, char *comm, unsigned long long *ticks,
+                      unsigned long long *start, long *rss) {
+    char *open = strchr(buf, '(');
+    char *close = strrchr(buf, ')');
+    if (!open || !close || close < open) {
+        return -1;
+    }
+    size_t len = (size_t)(close - open - 1);
+    if (len >= PROC_COMM_LEN) len = PROC_COMM_LEN - 1;
+    memcpy(comm, open + 1, len);
+    comm[len] = '\0';
+
+    // Fields after the name, numbered as in proc(5): 3 = state
+    char *p = close + 2;
+    unsigned long long utime = 0, stime = 0;
+    for (int field = 3; field <= 24 && *p; field++) {
+        char *end;
+        unsigned long long v = strtoull(p, &end, 10);
+        switch (field) {
+            case 14: utime = v; break;
+            case 15: stime = v; break;
+            case 22: *start = v; break;
+            case 24: *rss = (long)v; break;
+        }
+        p = end;
+        while (*p == ' ') p++;
+        if (field == 3) {            // state is a letter, not a number
+            while (*p && *p != ' ') p++;
+            while (*p == ' ') p++;
+        }
+    }
+    *ticks = utime + stime;
+    return 0;
+}
+
+static int compare_ticks_pid(const void *a, const void *b) {
+    pid_t x = ((const ProcTicks *)a)->pid, y = ((const ProcTicks *)b)->pid;
+    return (x > y) - (x < y);
+}
+
+static int busier(const ProcStat *a, const ProcStat *b) {
+    if (a->cpu != b->cpu) return a->cpu > b->cpu;
+    return a->mem > b->mem;
+}
+
+// Min-heap on busyness: the root is the least busy of the current top N
+static void heap_sift_down(ProcStat *h, int n, int i) {
+    for (;;) {
+        int l = 2 * i + 1, r = l + 1, m = i;
+        if (l < n && busier(&h[m], &h[l])) m = l;
+        if (r < n && busier(&h[m], &h[r])) m = r;
+        if (m == i) return;
+        ProcStat t = h[i]; h[i] = h[m]; h[m] = t;
+        i = m;
+    }
+}
+
+static void heap_sift_up(ProcStat *h, int i) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!busier(&h[parent], &h[i])) return;
+        ProcStat t = h[i]; h[i] = h[parent]; h[parent] = t;
+        i = parent;
+    }
+}
+
+static int grow_ticks(ProcTicks **buf, size_t *cap, size_t need) {
+    if (need <= *cap) return 0;
+    size_t new_cap = *cap ? *cap * 2 : 1024;
+    while (new_cap < need) new_cap *= 2;
+    ProcTicks *grown = realloc(*buf, new_cap * sizeof(ProcTicks));
+    if (!grown) return -1;
+    *buf = grown;
+    *cap = new_cap;
+    return 0;
+}
+
+int proc_sampler_sample(ProcSampler *s, ProcStat *top, int max) {
+    if (!s->proc_dir) {
+        return -1;
+    }
+    if (max > s->heap_cap) {
+        ProcStat *grown = realloc(s->heap, max * sizeof(ProcStat));
+        if (!grown) return -1;
+        s->heap = grown;
+        s->heap_cap = max;
+    }
+
+    MemInfo mem;
+    long mem_total_kb = (meminfo_read(&mem) == 0) ? mem.total_kb : 0;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double elapsed = (s->nprev > 0)
+        ? (now.tv_sec - s->last.tv_sec) + (now.tv_nsec - s->last.tv_nsec) / 1e9
+        : 0;
+    struct timespec boot;
+    clock_gettime(CLOCK_BOOTTIME, &boot);   // same clock as the start times
+    double uptime_ticks = (boot.tv_sec + boot.tv_nsec / 1e9) * s->hz;
+
+    int dirfd_proc = dirfd(s->proc_dir);
+    rewinddir(s->proc_dir);
+    s->ncur = 0;
+    int sorted = 1;
+    int nheap = 0;
+    size_t j = 0;   // merge cursor into prev (sorted by PID)
+
+    struct dirent *ent;
+    while ((ent = readdir(s->proc_dir)) != NULL) {
+        if (!isdigit((unsigned char)ent->d_name[0])) continue;
+
+        char path[sizeof(ent->d_name) + 8], buf[1024];
+        snprintf(path, sizeof(path), "%s/stat", ent->d_name);
+        if (read_small(dirfd_proc, path, buf, sizeof(buf)) <= 0) continue;   // exited
+
+        ProcStat st;
+        unsigned long long ticks = 0, start = 0;
+        long rss = 0;
+        if (parse_stat(buf, st.comm, &ticks, &start, &rss) != 0) continue;
+        st.pid = (pid_t)atoi(ent->d_name);
+
+        if (grow_ticks(&s->cur, &s->cap_cur, s->ncur + 1) != 0) break;
+        ProcTicks *pt = &s->cur[s->ncur++];
+        pt->pid = st.pid;
+        pt->start = start;
+        pt->ticks = ticks;
+        if (s->ncur > 1 && pt[-1].pid > pt->pid) sorted = 0;
+
+        // /proc lists PIDs in ascending order, so this is a merge join
+        while (j < s->nprev && s->prev[j].pid < st.pid) j++;
+        const ProcTicks *old = (j < s->nprev && s->prev[j].pid == st.pid &&
+                                s->prev[j].start == start) ? &s->prev[j] : NULL;
+        if (old && elapsed > 0) {
+            st.cpu = (float)((ticks - old->ticks) * 100.0 / (elapsed * s->hz));
+        } else {
+            double age = uptime_ticks - (double)start;
+            st.cpu = age > 0 ? (float)(ticks * 100.0 / age) : 0;
+        }
+        st.mem = mem_total_kb > 0 ? (float)(rss * s->page_kb * 100.0 / mem_total_kb) : 0;
+
+        if (nheap < max) {
+            s->heap[nheap] = st;
+            heap_sift_up(s->heap, nheap++);
+        } else if (max > 0 && busier(&st, &s->heap[0])) {
+            s->heap[0] = st;
+            heap_sift_down(s->heap, nheap, 0);
+        }
+    }
+    if (!sorted) {
+        qsort(s->cur, s->ncur, sizeof(ProcTicks), compare_ticks_pid);
+    }
+
+    // This sample becomes the baseline for the next one
+    ProcTicks *tmp_buf = s->prev; s->prev = s->cur; s->cur = tmp_buf;
+    size_t tmp_cap = s->cap_prev; s->cap_prev = s->cap_cur; s->cap_cur = tmp_cap;
+    s->nprev = s->ncur;
+    s->ncur = 0;
+    s->last = now;
+    s->total = (int)s->nprev;
+
+    // Pop the heap into top[], busiest first
+    for (int n = nheap; n > 0; n--) {
+        top[n - 1] = s->heap[0];
+        s->heap[0] = s->heap[n - 1];
+        heap_sift_down(s->heap, n - 1, 0);
+    }
+    return nheap;
+}
+
+// Read a whole /proc file into a reusable, growing buffer (NUL-terminated)
+static ssize_t read_whole(const char *path, char **buf, size_t *size) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    size_t len = 0;
+    for (;;) {
+        if (*size - len < 4096) {
+            size_t new_size = *size ? *size * 2 : 16384;
+            char *grown = realloc(*buf, new_size);
+            if (!grown) {
+                close(fd);
+                return -1;
+            }
+            *buf = grown;
+            *size = new_size;
+        }
+        ssize_t n = read(fd, *buf + len, *size - len - 1);
+        if (n < 0) {
+            close(fd);
+            return -1;
+        }
+        if (n == 0) break;
+        len += (size_t)n;
+    }
+    close(fd);
+    (*buf)[len] = '\0';
+    return (ssize_t)len;
+}
+
+static double seconds_since(struct timespec *last, const struct timespec *now) {
+    double elapsed = (last->tv_sec || last->tv_nsec)
+        ? (now->tv_sec - last->tv_sec) + (now->tv_nsec - last->tv_nsec) / 1e9
+        : 0;
+    *last = *now;
+    return elapsed;
+}
+
+// -------------------- CPU --------------------
+
+int cpu_sampler_init(CpuSampler *s) {
+    memset(s, 0, sizeof(*s));
+    if (read_whole("/proc/stat", &s->buf, &s->buf_size) < 0) {
+        return -1;
+    }
+    // Count the per-core lines that follow the aggregate "cpu " line
+    for (char *line = s->buf; line; line = strchr(line, '\n')) {
+        if (*line == '\n') line++;
+        if (strncmp(line, "cpu", 3) != 0) break;
+        if (isdigit((unsigned char)line[3])) s->ncpu++;
+    }
+    size_t n = (size_t)s->ncpu + 1;
+    s->busy = calloc(n, sizeof(*s->busy));
+    s->total = calloc(n, sizeof(*s->total));
+    s->util = calloc(n, sizeof(*s->util));
+    if (!s->busy || !s->total || !s->util) {
+        cpu_sampler_free(s);
+        return -1;
+    }
+    cpu_sampler_sample(s);   // baseline
+    return 0;
+}
+
+int cpu_sampler_sample(CpuSampler *s) {
+    if (!s->util || read_whole("/proc/stat", &s->buf, &s->buf_size) < 0) {
+        return -1;
+    }
+    for (char *line = s->buf; line && strncmp(line, "cpu", 3) == 0; ) {
+        int idx = 0;
+        char *p = line + 3;
+        if (isdigit((unsigned char)*p)) {
+            idx = (int)strtol(p, &p, 10) + 1;   // offline cores leave gaps
+        }
+        // user nice system idle iowait irq softirq steal (guest is in user)
+        unsigned long long v[8] = {0};
+        for (int i = 0; i < 8; i++) {
+            v[i] = strtoull(p, &p, 10);
+        }
+        if (idx <= s->ncpu) {
+            unsigned long long total = 0;
+            for (int i = 0; i < 8; i++) total += v[i];
+            unsigned long long busy = total - v[3] - v[4];
+            unsigned long long dt = total - s->total[idx];
+            s->util[idx] = (s->total[idx] && dt) ? (float)((busy - s->busy[idx]) * 100.0 / dt) : 0;
+            s->busy[idx] = busy;
+            s->total[idx] = total;
+        }
+        line = strchr(p, '\n');
+        if (line) line++;
+    }
+    return 0;
+}
+
+void cpu_sampler_free(CpuSampler *s) {
+    free(s->busy);
+    free(s->total);
+    free(s->util);
+    free(s->buf);
+    memset(s, 0, sizeof(*s));
+}
+
+// -------------------- Disks and NICs --------------------
+
+void dev_sampler_init(DevSampler *s) {
+    memset(s, 0, sizeof(*s));
+}
+
+void dev_sampler_free(DevSampler *s) {
+    free(s->dev);
+    free(s->buf);
+    memset(s, 0, sizeof(*s));
+}
+
+static DevStat *find_device(DevSampler *s, const char *name, int *is_new) {
+    for (int i = 0; i < s->ndev; i++) {
+        if (strcmp(s->dev[i].name, name) == 0) {
+            *is_new = 0;
+            return &s->dev[i];
+        }
+    }
+    if (s->ndev == s->cap) {
+        int cap = s->cap ? s->cap * 2 : 16;
+        DevStat *grown = realloc(s->dev, (size_t)cap * sizeof(DevStat));
+        if (!grown) return NULL;
+        s->dev = grown;
+        s->cap = cap;
+    }
+    DevStat *d = &s->dev[s->ndev++];
+    memset(d, 0, sizeof(*d));
+    snprintf(d->name, sizeof(d->name), "%s", name);
+    *is_new = 1;
+    return d;
+}
+
+static void update_device(DevStat *d, const uint64_t now[DEV_COUNTERS], double elapsed, int is_new) {
+    for (int i = 0; i < DEV_COUNTERS; i++) {
+        d->rate[i] = (!is_new && elapsed > 0 && now[i] >= d->prev[i])
+            ? (now[i] - d->prev[i]) / elapsed : 0;
+        d->prev[i] = now[i];
+    }
+    d->present = 1;
+}
+
+static void sum_devices(DevSampler *s) {
+    memset(s->total, 0, sizeof(s->total));
+    for (int i = 0; i < s->ndev; i++) {
+        if (!s->dev[i].counted || !s->dev[i].present) continue;
+        for (int c = 0; c < DEV_COUNTERS; c++) {
+            s->total[c] += s->dev[i].rate[c];
+        }
+    }
+}
+
+static void begin_sample(DevSampler *s) {
+    for (int i = 0; i < s->ndev; i++) {
+        s->dev[i].present = 0;
+    }
+}
+
+// Whole disks have a /sys/block entry; partitions do not
+static int is_whole_disk(const char *name) {
+    char path[64 + DEV_NAME_LEN];
+    if (strncmp(name, "loop", 4) == 0 || strncmp(name, "ram", 3) == 0 ||
+        strncmp(name, "zram", 4) == 0) {
+        return 0;
+    }
+    snprintf(path, sizeof(path), "/sys/block/%s", name);
+    return access(path, F_OK) == 0;
+}
+
+int disk_sampler_sample(DevSampler *s) {
+    if (read_whole("/proc/diskstats", &s->buf, &s->buf_size) < 0) {
+        return -1;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double elapsed = seconds_since(&s->last, &now);
+    begin_sample(s);
+
+    for (char *line = s->buf; line && *line; ) {
+        char *next = strchr(line, '\n');
+        if (next) *next++ = '\0';
+        char name[DEV_NAME_LEN];
+        unsigned long long reads, sectors_read, writes, sectors_written;
+        if (sscanf(line, "%*u %*u %31s %llu %*u %llu %*u %llu %*u %llu",
+                   name, &reads, &sectors_read, &writes, &sectors_written) == 5) {
+            int is_new;
+            DevStat *d = find_device(s, name, &is_new);
+            if (d) {
+                if (is_new) d->counted = is_whole_disk(name);
+                uint64_t v[DEV_COUNTERS] = { sectors_read * 512, sectors_written * 512, reads, writes };
+                update_device(d, v, elapsed, is_new);
+            }
+        }
+        line = next;
+    }
+    sum_devices(s);
+    return 0;
+}
+
+int net_sampler_sample(DevSampler *s) {
+    if (read_whole("/proc/net/dev", &s->buf, &s->buf_size) < 0) {
+        return -1;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double elapsed = seconds_since(&s->last, &now);
+    begin_sample(s);
+
+    for (char *line = s->buf; line && *line; ) {
+        char *next = strchr(line, '\n');
+        if (next) *next++ = '\0';
+        char *colon = strchr(line, ':');   // the two header lines have none
+        if (colon) {
+            *colon = '\0';
+            while (*line == ' ') line++;
+            unsigned long long rx_bytes, rx_packets, tx_bytes, tx_packets;
+            if (sscanf(colon + 1, "%llu %llu %*u %*u %*u %*u %*u %*u %llu %llu",
+                       &rx_bytes, &rx_packets, &tx_bytes, &tx_packets) == 4) {
+                int is_new;
+                DevStat *d = find_device(s, line, &is_new);
+                if (d) {
+                    if (is_new) d->counted = strcmp(line, "lo") != 0;
+                    uint64_t v[DEV_COUNTERS] = { rx_bytes, tx_bytes, rx_packets, tx_packets };
+                    update_device(d, v, elapsed, is_new);
+                }
+            }
+        }
+        line = next;
+    }
+    sum_devices(s);
+    return 0;
+}
+
+// -------------------- History --------------------
+
+int history_init(History *h, int capacity) {
+    memset(h, 0, sizeof(*h));
+    h->values = calloc((size_t)capacity, sizeof(float));
+    if (!h->values) {
+        return -1;
+    }
+    h->capacity = capacity;
+    return 0;
+}
+
+void history_push(History *h, float value) {
+    if (!h->values) return;
+    h->values[h->head] = value;
+    h->head = (h->head + 1) % h->capacity;
+    if (h->count < h->capacity) h->count++;
+}
+
+void history_clear(History *h) {
+    h->head = h->count = 0;
+}
+
+float history_at(const History *h, int i) {
+    int oldest = (h->head - h->count + h->capacity) % h->capacity;
+    return h->values[(oldest + i) % h->capacity];
+}
+
+float history_max(const History *h) {
+    float max = 0;
+    for (int i = 0; i < h->count; i++) {
+        if (h->values[i] > max) max = h->values[i];
+    }
+    return max;
+}
+
+void history_free(History *h) {
+    free(h->values);
+    memset(h, 0, sizeof(*h));
+}
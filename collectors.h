@@ -0,0 +1,126 @@
+#ifndef COLLECTORS_H
+#define COLLECTORS_H
+
+#include <stdint.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <time.h>
+
+// System metric collectors shared by the dashboard and other consumers.
+// Each sampler keeps its own state, so independent users (e.g. the
+// dashboard and an exporter thread) each own one.
+
+// -------------------- Processes (/proc/[pid]/stat) --------------------
+
+#define PROC_COMM_LEN 16
+
+typedef struct {
+    pid_t pid;
+    float cpu;                    // % of one CPU since the previous sample
+    float mem;                    // resident set as % of physical memory
+    char  comm[PROC_COMM_LEN];
+} ProcStat;
+
+// Per-process CPU ticks from one sample, sorted by PID
+typedef struct {
+    pid_t              pid;
+    unsigned long long start;     // start time in ticks; detects PID reuse
+    unsigned long long ticks;     // utime + stime
+} ProcTicks;
+
+typedef struct {
+    DIR       *proc_dir;          // rewound each sample, so its buffer is reused
+    ProcTicks *cur, *prev;        // swapped each sample; grown, never shrunk
+    size_t     ncur, nprev, cap_cur, cap_prev;
+    ProcStat  *heap;              // top-N selection scratch
+    int        heap_cap;
+    struct timespec last;         // CLOCK_MONOTONIC of the previous sample
+    long       hz;                // clock ticks per second
+    long       page_kb;
+    int        total;             // processes seen by the last sample
+} ProcSampler;
+
+int  proc_sampler_init(ProcSampler *s);
+
+// Scan /proc and store the `max` busiest processes in top[], busiest first.
+// Processes new since the previous sample report their lifetime average,
+// like ps. Returns the number stored, or -1 if /proc is unreadable.
+int  proc_sampler_sample(ProcSampler *s, ProcStat *top, int max);
+
+void proc_sampler_free(ProcSampler *s);
+
+// -------------------- Memory (/proc/meminfo) --------------------
+
+typedef struct {
+    long total_kb;
+    long free_kb;
+    long available_kb;
+} MemInfo;
+
+int meminfo_read(MemInfo *m);
+
+// -------------------- CPU (/proc/stat) --------------------
+
+typedef struct {
+    int    ncpu;                  // cores; index 0 of each array is all CPUs
+    unsigned long long *busy;     // previous sample
+    unsigned long long *total;
+    float *util;                  // % busy since the previous sample
+    char  *buf;                   // file buffer, reused
+    size_t buf_size;
+} CpuSampler;
+
+int  cpu_sampler_init(CpuSampler *s);
+int  cpu_sampler_sample(CpuSampler *s);
+void cpu_sampler_free(CpuSampler *s);
+
+// -------------------- Disks and NICs --------------------
+
+// Rates for /proc/diskstats (whole disks; no partitions, loop or RAM disks)
+enum { DISK_READ_BYTES, DISK_WRITE_BYTES, DISK_READ_OPS, DISK_WRITE_OPS };
+// Rates for /proc/net/dev (all interfaces except lo)
+enum { NET_RX_BYTES, NET_TX_BYTES, NET_RX_PACKETS, NET_TX_PACKETS };
+
+#define DEV_NAME_LEN 32
+#define DEV_COUNTERS 4
+
+typedef struct {
+    char     name[DEV_NAME_LEN];
+    int      counted;             // a whole disk / non-loopback NIC
+    int      present;             // seen by the last sample
+    uint64_t prev[DEV_COUNTERS];
+    double   rate[DEV_COUNTERS];  // per second since the previous sample
+} DevStat;
+
+typedef struct {
+    DevStat *dev;
+    int      ndev, cap;
+    double   total[DEV_COUNTERS]; // sum of rate[] over counted devices
+    struct timespec last;
+    char    *buf;
+    size_t   buf_size;
+} DevSampler;
+
+void dev_sampler_init(DevSampler *s);
+int  disk_sampler_sample(DevSampler *s);
+int  net_sampler_sample(DevSampler *s);
+void dev_sampler_free(DevSampler *s);
+
+// -------------------- History --------------------
+
+// Fixed-size ring of the most recent samples, allocated once
+typedef struct {
+    float *values;
+    int    capacity;
+    int    head;                  // next slot to write
+    int    count;
+} History;
+
+int   history_init(History *h, int capacity);
+void  history_push(History *h, float value);
+void  history_clear(History *h);
+float history_at(const History *h, int i);   // 0 = oldest
+float history_max(const History *h);
+void  history_free(History *h);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef COMMAND_HASH_H
+#define COMMAND_HASH_H
+
+#include <stdint.h>
+
+// Hash behind the command registry's perfect-hash table. Shared by
+// registry.c and tools/gen_commands.c, which searches for a seed under which
+// no two command names land in the same slot; changing it only takes a
+// rebuild. Include from one translation unit per program.
+static uint32_t command_hash(const char *name, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;      // FNV-1a ...
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        h = (h ^ *p) * 16777619u;
+    }
+    h ^= h >> 16;                         // ... with a final mix so the low bits
+    h *= 0x85ebca6bu;                     // used as the slot depend on every byte
+    h ^= h >> 13;
+    return h;
+}
+
+#endif
@@ -5,6 +5,7 @@
 #include <sys/wait.h>
 #include <signal.h>
 #include <stdbool.h>
+#include <errno.h>
 #include <ctype.h>
 #include <termios.h> // Terminal I/O control - used to disable echo when reading passwords (tcgetattr, tcsetattr, ECHO flag)
 #include "terminal.h"
@@ -14,6 +15,18 @@
 #include "crypto.h"
 #include "dashboard.h"
 #include "script.h"
+#include "resource_limits.h"
+#include "launcher.h"
+#include "pipeline.h"
+#include "cli_output.h"
+#include "tasks.h"
+#include "audit.h"
+#include "config.h"
+#include "metrics.h"
+#include "registry.h"
+#include "profiler.h"
+#include <stdint.h>
+#include <time.h>
 #include <ncurses.h>
 #include <unistd.h>
 
@@ -38,99 +51,94 @@ bool is_input_safe(const char *input) {
 // hello
 void cmd_hello(int argc, char *argv[]) {
     (void)argc; (void)argv;
-    printf("Hello from SecureSysCLI! 👋\n");
+    cli_printf("Hello from SecureSysCLI! 👋\n");
     log_command("hello");
 }
 
-// help
+// help [command]
 void cmd_help(int argc, char *argv[]) {
-    (void)argc; (void)argv;
-    printf("Available commands:\n");
-    printf("  hello                - Print greeting\n");
-    printf("  help                 - Show this help message\n");
-    printf("  clear                - Clear the terminal screen\n");
-    printf("  exec <program> [args]- Execute a system program securely\n");
-    printf("  list [dir]           - List files with permissions (default: .)\n");
-    printf("  create <filename>    - Create an empty file\n");
-    printf("  copy <src> <dst>     - Copy a file\n");
-    printf("  delete <file>        - Delete a file (admin only)\n");
-    printf("  close                - Exit and close the terminal window\n");
-    printf("  write <file> <text>  - Write text to a file\n");
-    printf("  show <file>          - Display file contents\n");
-    printf("  run <program> [&]    - Run a program (background with &)\n");
-    printf("  pslist               - Show background jobs\n");
-    printf("  fgproc <jobid>       - Bring background job to foreground\n");
-    printf("  bgproc <jobid>       - Resume stopped job in background\n");
-    printf("  killproc <pid>       - Kill a process by PID (admin only)\n");
-    printf("  whoami               - Show current user and role\n");
-    printf("  encrypt <in> <out>   - Encrypt a file with password\n");
-    printf("  decrypt <in> <out>    - Decrypt a file with password\n");
-    printf("  checksum <file>       - Compute SHA-256 checksum of a file\n");
-    printf("  dashboard            - Launch ncurses dashboard\n");
-    printf("  exit / quit          - Exit the CLI\n");
+    if (argc > 1) {
+        const CommandInfo *cmd = registry_find(argv[1]);
+        if (!cmd) {
+            cli_printf("No such command: %s\n", argv[1]);
+            cli_set_status(1);
+            return;
+        }
+        cli_printf("Usage: %s\n  %s\n", cmd->usage, cmd->summary);
+        log_command("help");
+        return;
+    }
+
+    cli_printf("Available commands:\n");
+    for (int i = 0; i < registry_count(); i++) {
+        const CommandInfo *cmd = registry_at(i);
+        cli_printf("  %-20s - %s\n", cmd->usage, cmd->summary);
+    }
+    cli_printf("  %-20s - %s\n", "<builtin> ... &", "Run a built-in (copy, checksum, encrypt, ...) in the background");
+    cli_printf("  %-20s - %s\n", "exit / quit", "Exit the CLI");
     
     log_command("help");
 }
 
 // ---------------------------------------------------------------------------
-// 🔹 exec <program> [args] — Secure fork/exec Implementation
+// 🔹 exec <program> [args] — Secure spawn Implementation
 // ---------------------------------------------------------------------------
 
 void cmd_exec(int argc, char *argv[]) {
     if (argc < 2) {
-        printf("Usage: exec <program> [args...]\n");
-        printf("Example: exec ls -la\n");
+        cli_printf("Usage: exec " RESOURCE_LIMITS_USAGE " <program> [args...] [| <program> [args...]]...\n");
+        cli_printf("Example: exec --nice 10 --cpus 2-3 ls -la | grep cli\n");
         return;
     }
 
-    // Sanitize all arguments
-    for (int i = 1; i < argc; i++) {
-        if (!is_input_safe(argv[i])) {
-            printf("⚠️  Unsafe characters detected in argument: %s\n", argv[i]);
-            return;
-        }
+    ResourceLimits limits;
+    resource_limits_init(&limits);
+    int first = resource_limits_parse(&limits, argc, argv, 1);
+    if (first < 0) {
+        return;
+    }
+    if (first >= argc) {
+        cli_printf("Usage: exec " RESOURCE_LIMITS_USAGE " <program> [args...]\n");
+        return;
+    }
+
+    // Build the log string before the pipeline parser splits argv
+    char full_cmd[512] = {0};
+    size_t len = 0;
+    for (int i = first; i < argc && len < sizeof(full_cmd); i++) {
+        len += snprintf(full_cmd + len, sizeof(full_cmd) - len, "%s%s",
+                        argv[i], (i < argc - 1) ? " " : "");
     }
 
-    pid_t pid = fork();
-    if (pid < 0) {
-        perror("fork failed");
+    // Split at standalone "|" tokens, then sanitize all arguments
+    Pipeline pl;
+    if (pipeline_parse(&pl, argc, argv, first) != 0 || !pipeline_is_safe(&pl)) {
         return;
     }
 
-    if (pid == 0) {
-        // Child process - restore default signal handlers
-        signal(SIGINT, SIG_DFL);
-        signal(SIGTERM, SIG_DFL);
-        execvp(argv[1], &argv[1]);
-        perror("execvp failed");
-        _exit(1);
-    } else {
-        // Parent waits for child to finish
-        // Set global variable so signal handler can forward SIGINT
-        foreground_pid = pid;
-        
-        int status;
-        waitpid(pid, &status, 0);
-        
-        // Clear foreground PID after process completes
-        foreground_pid = 0;
-
-        if (WIFEXITED(status)) {
-            printf("Process exited with status: %d\n", WEXITSTATUS(status));
-        } else if (WIFSIGNALED(status)) {
-            printf("\nProcess killed by signal: %d\n", WTERMSIG(status));
-        } else {
-            printf("Process ended abnormally.\n");
-        }
+    LaunchOptions opts;
+    launch_options_init(&opts);
+    opts.limits = &limits;
+    pid_t pids[MAX_PIPELINE_STAGES];
+    if (pipeline_launch(&pl, &opts, pids) != 0) {
+        return;
+    }
 
-        // Log the command string
-        char full_cmd[512] = {0};
-        for (int i = 1; i < argc; i++) {
-            strcat(full_cmd, argv[i]);
-            if (i < argc - 1) strcat(full_cmd, " ");
-        }
-        log_command(full_cmd);
+    // Parent waits for every stage; the last one's status is reported
+    int status = pipeline_wait_foreground(pids, pl.count);
+
+    if (status < 0) {
+        cli_perror("waitpid");
+    } else if (WIFEXITED(status)) {
+        cli_printf("Process exited with status: %d\n", WEXITSTATUS(status));
+    } else if (WIFSIGNALED(status)) {
+        cli_printf("\nProcess killed by signal: %d\n", WTERMSIG(status));
+    } else {
+        cli_printf("Process ended abnormally.\n");
     }
+
+    // Log the command string
+    log_command(full_cmd);
 }
 
 // ---------------------------------------------------------------------------
@@ -152,8 +160,8 @@ void cmd_close(int argc, char *argv[]) {
     (void)argv;
 
     log_command("close");
-    printf("Closing SecureSysCLI...\n");
-    fflush(stdout);
+    cli_printf("Closing SecureSysCLI...\n");
+    fflush(cli_out());
 
     const char *launched = getenv("SECURECLI_LAUNCHED");
     if (launched && strcmp(launched, "1") == 0) {
@@ -162,8 +170,8 @@ void cmd_close(int argc, char *argv[]) {
             kill(parent, SIGTERM);
         }
     } else {
-        printf("(Unable to close terminal automatically in this environment.)\n");
-        fflush(stdout);
+        cli_printf("(Unable to close terminal automatically in this environment.)\n");
+        fflush(cli_out());
     }
 
     exit(0);
@@ -176,9 +184,9 @@ void cmd_close(int argc, char *argv[]) {
 void cmd_whoami(int argc, char *argv[]) {
     (void)argc; (void)argv;
     if (current_user) {
-        printf("You are %s (%s)\n", current_user->username, current_user->role);
+        cli_printf("You are %s (%s)\n", current_user->username, current_user->role);
     } else {
-        printf("No user logged in.\n");
+        cli_printf("No user logged in.\n");
     }
     log_command("whoami");
 }
@@ -210,7 +218,17 @@ static void read_crypto_password(char *password, size_t max_len) {
     
     // Restore terminal settings
     tcsetattr(STDIN_FILENO, TCSANOW, &old_term);
-    printf("\n");  // Print newline after password input
+    cli_printf("\n");  // Print newline after password input
+}
+
+// Prompt for the crypto password; a background task uses the one read up front
+void prompt_crypto_password(char *password, size_t max_len) {
+    if (task_take_secret(password, max_len)) {
+        return;
+    }
+    cli_printf("Enter password: ");
+    fflush(cli_out());
+    read_crypto_password(password, max_len);
 }
 
 // ---------------------------------------------------------------------------
@@ -218,25 +236,23 @@ static void read_crypto_password(char *password, size_t max_len) {
 // ---------------------------------------------------------------------------
 void cmd_encrypt(int argc, char *argv[]) {
     if (argc < 3) {
-        printf("Usage: encrypt <input> <output>\n");
+        cli_printf("Usage: encrypt <input> <output>\n");
         return;
     }
 
     char pass[128];
-    printf("Enter password: ");
-    fflush(stdout);
-    read_crypto_password(pass, sizeof(pass));
+    prompt_crypto_password(pass, sizeof(pass));
 
     if (strlen(pass) == 0) {
-        printf("Password cannot be empty\n");
+        cli_printf("Password cannot be empty\n");
         return;
     }
 
     if (encrypt_file(argv[1], argv[2], pass)) {
-        printf("Encrypted %s -> %s\n", argv[1], argv[2]);
+        cli_printf("Encrypted %s -> %s\n", argv[1], argv[2]);
         log_command("encrypt");
     } else {
-        printf("Encryption failed\n");
+        cli_printf("Encryption failed\n");
     }
     
     // Clear password from memory
@@ -248,25 +264,23 @@ void cmd_encrypt(int argc, char *argv[]) {
 // ---------------------------------------------------------------------------
 void cmd_decrypt(int argc, char *argv[]) {
     if (argc < 3) {
-        printf("Usage: decrypt <input> <output>\n");
+        cli_printf("Usage: decrypt <input> <output>\n");
         return;
     }
 
     char pass[128];
-    printf("Enter password: ");
-    fflush(stdout);
-    read_crypto_password(pass, sizeof(pass));
+    prompt_crypto_password(pass, sizeof(pass));
 
     if (strlen(pass) == 0) {
-        printf("Password cannot be empty\n");
+        cli_printf("Password cannot be empty\n");
         return;
     }
 
     if (decrypt_file(argv[1], argv[2], pass)) {
-        printf("Decrypted %s -> %s\n", argv[1], argv[2]);
+        cli_printf("Decrypted %s -> %s\n", argv[1], argv[2]);
         log_command("decrypt");
     } else {
-        printf("Decryption failed\n");
+        cli_printf("Decryption failed\n");
     }
     
     // Clear password from memory
@@ -278,16 +292,16 @@ void cmd_decrypt(int argc, char *argv[]) {
 // ---------------------------------------------------------------------------
 void cmd_checksum(int argc, char *argv[]) {
     if (argc < 2) {
-        printf("Usage: checksum <file>\n");
+        cli_printf("Usage: checksum <file>\n");
         return;
     }
 
     char hex[65];
     if (sha256_file_hex(argv[1], hex)) {
-        printf("%s  %s\n", hex, argv[1]);
+        cli_printf("%s  %s\n", hex, argv[1]);
         log_command("checksum");
     } else {
-        printf("Checksum failed\n");
+        cli_printf("Checksum failed\n");
     }
 }
 
@@ -296,50 +310,409 @@ void cmd_checksum(int argc, char *argv[]) {
 // dashboard - Launch ncurses dashboard
 // ---------------------------------------------------------------------------
 
+#define DASHBOARD_MIN_INTERVAL_MS 100
+
+static long elapsed_ms(const struct timespec *since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1000 + (now.tv_nsec - since->tv_nsec) / 1000000;
+}
+
+static void dashboard_usage(void) {
+    cli_printf("Usage: dashboard [--interval MS] [--record FILE]\n");
+    cli_printf("       dashboard --replay FILE [--speed N]\n");
+    cli_set_status(2);
+}
+
 void cmd_dashboard(int argc, char *argv[]) {
-    (void)argc; (void)argv;
-    
+    int interval = dashboard_refresh_ms;
+    const char *record = NULL, *replay = NULL;
+    double speed = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            interval = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay = argv[++i];
+        } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            speed = atof(argv[++i]);
+        } else {
+            dashboard_usage();
+            return;
+        }
+    }
+    if (record && replay) {
+        dashboard_usage();
+        return;
+    }
+    if (interval < DASHBOARD_MIN_INTERVAL_MS) {
+        interval = DASHBOARD_MIN_INTERVAL_MS;
+    }
+
+    if (replay) {
+        if (dashboard_replay(replay, speed > 0 ? speed : 1) != 0) {
+            if (errno == EINVAL) {
+                cli_printf("dashboard: %s is not a dashboard recording\n", replay);
+                cli_set_status(1);
+            } else {
+                cli_perror(replay);
+            }
+            return;
+        }
+        cli_printf("Replay closed.\n");
+        log_command("dashboard --replay");
+        return;
+    }
+    if (record && dashboard_record(record, interval) != 0) {
+        cli_perror(record);
+        return;
+    }
+
     if (dashboard_init() != 0) {
-        printf("Failed to initialize dashboard. Is ncurses installed?\n");
+        cli_printf("Failed to initialize dashboard. Is ncurses installed?\n");
         return;
     }
 
-    // Set non-blocking input with timeout
-    timeout(1000); // 1000ms (1 second) timeout
-    
-    int ch;
+    // Sample on a fixed cadence; keys wait at most until the next tick
+    struct timespec last_tick;
+    clock_gettime(CLOCK_MONOTONIC, &last_tick);
     while (1) {
-        dashboard_update();
-        ch = getch();
-        
+        long remaining = interval - elapsed_ms(&last_tick);
+        if (remaining <= 0) {
+            clock_gettime(CLOCK_MONOTONIC, &last_tick);
+            dashboard_update();
+            remaining = interval;
+        }
+        timeout((int)remaining);
+        int ch = getch();
+
         if (ch == 'q' || ch == 'Q') {
             break;
         } else if (ch == 'r' || ch == 'R' || ch == KEY_RESIZE) {
-            dashboard_update();
-        } else if (ch == ERR) {
-            // Timeout - continue loop to update display
-            continue;
+            clock_gettime(CLOCK_MONOTONIC, &last_tick);
+            dashboard_redraw();
         }
     }
 
     dashboard_cleanup();
-    printf("Dashboard closed.\n");
+    cli_printf("Dashboard closed.\n");
     log_command("dashboard");
 }
 
+// ---------------------------------------------------------------------------
+// metrics - Prometheus exposition of the dashboard's collectors
+// ---------------------------------------------------------------------------
+
+// Window of the one-off `metrics` sample (CPU figures need two samples)
+#define METRICS_PRINT_WINDOW_MS 250
+
+static void metrics_usage(void) {
+    cli_printf("Usage: metrics                          - print one exposition\n");
+    cli_printf("       metrics serve --http PORT | --socket PATH | --textfile PATH [--interval MS]\n");
+    cli_printf("       metrics stop | status\n");
+    cli_set_status(2);
+}
+
+static void metrics_serve_cmd(int argc, char *argv[]) {
+    MetricsTarget target = METRICS_HTTP;
+    const char *where = NULL;
+    int interval = metrics_interval_ms;
+    for (int i = 2; i < argc; i++) {
+        if (i + 1 >= argc) {
+            metrics_usage();
+            return;
+        }
+        if (strcmp(argv[i], "--http") == 0) {
+            target = METRICS_HTTP;
+            where = argv[++i];
+        } else if (strcmp(argv[i], "--socket") == 0) {
+            target = METRICS_SOCKET;
+            where = argv[++i];
+        } else if (strcmp(argv[i], "--textfile") == 0) {
+            target = METRICS_TEXTFILE;
+            where = argv[++i];
+        } else if (strcmp(argv[i], "--interval") == 0) {
+            interval = atoi(argv[++i]);
+        } else {
+            metrics_usage();
+            return;
+        }
+    }
+    if (!where) {
+        metrics_usage();
+        return;
+    }
+    if (interval < DASHBOARD_MIN_INTERVAL_MS) {
+        interval = DASHBOARD_MIN_INTERVAL_MS;
+    }
+
+    char status[512];
+    if (metrics_status(status, sizeof(status))) {
+        cli_printf("Metrics exporter already %s (metrics stop first)\n", status);
+        cli_set_status(1);
+        return;
+    }
+    if (metrics_serve(target, where, interval) != 0) {
+        cli_perror("metrics serve");
+        return;
+    }
+    metrics_status(status, sizeof(status));
+    cli_printf("Metrics exporter %s\n", status);
+
+    // A batch run has no prompt to keep the exporter alive behind; exiting
+    // would stop it at once, so serve until told to stop instead
+    if (in_batch) {
+        cli_printf("Serving until interrupted (Ctrl+C or SIGTERM)\n");
+        fflush(cli_out());
+        metrics_run_foreground();
+        cli_printf("Metrics exporter stopped\n");
+    }
+}
+
+void cmd_metrics(int argc, char *argv[]) {
+    const char *sub = argc > 1 ? argv[1] : NULL;
+
+    if (!sub) {
+        if (metrics_print(cli_out(), METRICS_PRINT_WINDOW_MS) != 0) {
+            cli_perror("metrics: /proc");
+        }
+        return;
+    }
+
+    if (strcmp(sub, "status") == 0) {
+        char status[512];
+        if (metrics_status(status, sizeof(status))) {
+            cli_printf("Metrics exporter %s\n", status);
+        } else {
+            cli_printf("Metrics exporter not running\n");
+        }
+        return;
+    }
+    if (strcmp(sub, "serve") != 0 && strcmp(sub, "stop") != 0) {
+        metrics_usage();
+        return;
+    }
+
+    // Opening a listener or writing files on the host's behalf is an admin action
+    if (!is_admin()) {
+        cli_printf("🚫  Permission denied: only admin can %s the metrics exporter.\n", sub);
+        log_command("UNAUTHORIZED metrics attempt");
+        cli_set_status(1);
+        return;
+    }
+    if (strcmp(sub, "stop") == 0) {
+        char status[512];
+        if (!metrics_status(status, sizeof(status))) {
+            cli_printf("Metrics exporter not running\n");
+            cli_set_status(1);
+            return;
+        }
+        metrics_stop();
+        cli_printf("Metrics exporter stopped\n");
+    } else {
+        metrics_serve_cmd(argc, argv);
+    }
+    log_command(sub[1] == 't' ? "metrics stop" : "metrics serve");
+}
+
 // ---------------------------------------------------------------------------
 // source - Execute a .cli script file
 // ---------------------------------------------------------------------------
 
 void cmd_source(int argc, char *argv[]) {
-    if (argc < 2) {
-        printf("Usage: source <script.cli>\n");
-        printf("Example: source setup.cli\n");
+    int profile = 0, i;
+    const char *folded = NULL;
+    for (i = 1; i < argc - 1; i++) {
+        if (strcmp(argv[i], "--profile") == 0) {
+            profile = 1;
+        } else if (strcmp(argv[i], "--folded") == 0 && i + 2 < argc) {
+            profile = 1;
+            folded = argv[++i];
+        } else {
+            break;
+        }
+    }
+    if (i != argc - 1) {
+        cli_printf("Usage: source [--profile] [--folded FILE] <script.cli>\n");
+        cli_printf("Example: source --profile --folded setup.folded setup.cli\n");
+        cli_set_status(2);
         return;
     }
 
-    if (script_execute(argv[1]) != 0) {
-        printf("Failed to execute script: %s\n", argv[1]);
+    // Only one profile at a time; a nested `source --profile` is already
+    // part of the outer one
+    ProfileFrame root;
+    int profiling = profile && profile_begin(&root) == 0;
+    if (profile && !profiling && !profile_current()) {
+        fprintf(cli_err(), "source: another profile is being recorded; running without --profile\n");
+    }
+
+    int failed = script_execute(argv[i]) != 0;
+    if (failed) {
+        cli_printf("Failed to execute script: %s\n", argv[i]);
+    }
+    if (profiling && profile_end(&root, folded) != 0) {
+        failed = 1;
+    }
+    if (failed) {
+        cli_set_status(1);
     }
     log_command("source");
 }
+
+// ---------------------------------------------------------------------------
+// logquery - Search the structured audit log
+// ---------------------------------------------------------------------------
+
+// Accepts 2024-01-15, 2024-01-15T14:30[:45] (local time), @<epoch>,
+// "now", or a relative age such as 90s, 30m, 12h, 7d
+static int parse_query_time(const char *arg, int64_t *out_us) {
+    time_t now = time(NULL);
+    char *end;
+
+    if (strcmp(arg, "now") == 0) {
+        *out_us = (int64_t)now * 1000000;
+        return 0;
+    }
+    if (arg[0] == '@') {
+        long long epoch = strtoll(arg + 1, &end, 10);
+        if (end == arg + 1 || *end != '\0') return -1;
+        *out_us = (int64_t)epoch * 1000000;
+        return 0;
+    }
+
+    long long amount = strtoll(arg, &end, 10);
+    if (end != arg && amount >= 0 && end[0] != '\0' && end[1] == '\0') {
+        long long unit = 0;
+        switch (*end) {
+            case 's': unit = 1; break;
+            case 'm': unit = 60; break;
+            case 'h': unit = 3600; break;
+            case 'd': unit = 86400; break;
+        }
+        if (unit) {
+            *out_us = ((int64_t)now - amount * unit) * 1000000;
+            return 0;
+        }
+    }
+
+    static const char *formats[] = { "%Y-%m-%dT%H:%M:%S", "%Y-%m-%dT%H:%M", "%Y-%m-%d", NULL };
+    for (int i = 0; formats[i]; i++) {
+        struct tm tm;
+        memset(&tm, 0, sizeof(tm));
+        const char *rest = strptime(arg, formats[i], &tm);
+        if (rest && *rest == '\0') {
+            tm.tm_isdst = -1;
+            time_t t = mktime(&tm);
+            if (t == (time_t)-1) return -1;
+            *out_us = (int64_t)t * 1000000;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static void print_audit_record(const AuditRecord *rec, const char *argv, void *ctx) {
+    (void)ctx;
+    time_t secs = (time_t)(rec->start_us / 1000000);
+    struct tm tm_info;
+    char when[32];
+    localtime_r(&secs, &tm_info);
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &tm_info);
+
+    FILE *out = cli_out();
+    fprintf(out, "[%s] %-12.*s status=%-3d %9.1f ms  ", when,
+            (int)sizeof(rec->user), rec->user, rec->status, rec->duration_us / 1000.0);
+    const char *arg = argv;
+    for (int i = 0; i < rec->argc; i++) {
+        fprintf(out, "%s%s", i ? " " : "", arg);
+        arg += strlen(arg) + 1;
+    }
+    fputc('\n', out);
+}
+
+void cmd_logquery(int argc, char *argv[]) {
+    AuditFilter filter = { INT64_MIN, INT64_MAX, NULL, NULL };
+
+    for (int i = 1; i < argc; i += 2) {
+        const char *opt = argv[i];
+        const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+        int bad = (val == NULL);
+
+        if (!bad && strcmp(opt, "--since") == 0) {
+            bad = parse_query_time(val, &filter.since_us);
+        } else if (!bad && strcmp(opt, "--until") == 0) {
+            bad = parse_query_time(val, &filter.until_us);
+        } else if (!bad && strcmp(opt, "--user") == 0) {
+            filter.user = val;
+        } else if (!bad && strcmp(opt, "--cmd") == 0) {
+            filter.cmd = val;
+        } else {
+            bad = 1;
+        }
+
+        if (bad) {
+            cli_printf("Usage: logquery [--since TIME] [--until TIME] [--user NAME] [--cmd NAME]\n");
+            cli_printf("TIME: 2024-01-15, 2024-01-15T14:30[:45], @<epoch>, now, or an age like 30m, 12h, 7d\n");
+            cli_set_status(2);
+            return;
+        }
+    }
+
+    // Regular users may only read their own audit trail
+    if (!is_admin()) {
+        const char *self = current_user ? current_user->username : "";
+        if (filter.user && strcmp(filter.user, self) != 0) {
+            cli_printf("🚫  Permission denied: only admin can query other users.\n");
+            log_command("UNAUTHORIZED logquery attempt");
+            cli_set_status(1);
+            return;
+        }
+        filter.user = self;
+    }
+
+    long matches = audit_query(&filter, print_audit_record, NULL);
+    if (matches < 0) {
+        cli_perror("logquery: " AUDIT_FILE);
+        return;
+    }
+    cli_printf("%ld record(s)\n", matches);
+    log_command("logquery");
+}
+
+// ---------------------------------------------------------------------------
+// logverify - Check the audit log's hash chain
+// ---------------------------------------------------------------------------
+
+void cmd_logverify(int argc, char *argv[]) {
+    (void)argc; (void)argv;
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    AuditVerifyResult res;
+    if (audit_verify(&res) != 0) {
+        cli_perror("logverify: " AUDIT_FILE);
+        return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double ms = (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+
+    if (res.bad_offset >= 0) {
+        cli_printf("❌ Audit chain broken at byte offset %ld of %.1f MB\n",
+                   res.bad_offset, res.size / (1024.0 * 1024.0));
+        log_command("logverify FAILED");
+        cli_set_status(1);
+        return;
+    }
+
+    char head[2 * AUDIT_DIGEST_LEN + 1];
+    for (int i = 0; i < AUDIT_DIGEST_LEN; i++) {
+        snprintf(head + 2 * i, 3, "%02x", res.head[i]);
+    }
+    cli_printf("✅ Audit chain intact: %ld records, %ld checkpoints, %.1f MB\n",
+               res.records, res.checkpoints, res.size / (1024.0 * 1024.0));
+    cli_printf("   %d span(s) verified on %d thread(s) in %.1f ms\n", res.spans, res.threads, ms);
+    cli_printf("   Chain head: %s\n", res.records ? head : "(empty log)");
+    log_command("logverify");
+}
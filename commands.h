@@ -1,6 +1,15 @@
 #ifndef COMMANDS_H
 #define COMMANDS_H
 
+#include <stdbool.h>
+
+// Returns false if input contains shell metacharacters
+bool is_input_safe(const char *input);
+
+// Prompt for a password without echo (used by encrypt/decrypt).
+// Inside a background task the password read before queueing is used.
+void prompt_crypto_password(char *password, size_t max_len);
+
 // General command functions
 void cmd_hello(int argc, char *argv[]);
 void cmd_help(int argc, char *argv[]);
@@ -12,7 +21,10 @@ void cmd_encrypt(int argc, char *argv[]);
 void cmd_decrypt(int argc, char *argv[]);
 void cmd_checksum(int argc, char *argv[]);
 void cmd_dashboard(int argc, char *argv[]);
+void cmd_metrics(int argc, char *argv[]);
 void cmd_source(int argc, char *argv[]);
+void cmd_logquery(int argc, char *argv[]);
+void cmd_logverify(int argc, char *argv[]);
 
 #endif
 
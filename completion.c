@@ -0,0 +1,720 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include <readline/readline.h>
+#include "completion.h"
+#include "registry.h"
+#include "lexer.h"
+#include "jobs.h"
+#include "script.h"
+
+#define DIR_CACHE_SIZE 32
+
+// Changes that add, remove or rename an entry, or may change whether it is
+// an executable (for the PATH programs)
+#define WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB | \
+                    IN_DELETE_SELF | IN_MOVE_SELF)
+
+// ---------------------------------------------------------------------------
+// Match lists
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    char **v;
+    int    n, cap;
+} Matches;
+
+static int matches_add(Matches *m, const char *prefix, const char *s, size_t len) {
+    if (m->n + 2 > m->cap) {
+        int cap = m->cap ? m->cap * 2 : 64;
+        char **grown = realloc(m->v, (size_t)cap * sizeof(char *));
+        if (!grown) {
+            return -1;
+        }
+        m->v = grown;
+        m->cap = cap;
+    }
+    size_t plen = strlen(prefix);
+    char *copy = malloc(plen + len + 1);
+    if (!copy) {
+        return -1;
+    }
+    memcpy(copy, prefix, plen);
+    memcpy(copy + plen, s, len);
+    copy[plen + len] = '\0';
+    m->v[m->n++] = copy;
+    m->v[m->n] = NULL;
+    return 0;
+}
+
+static void matches_free(Matches *m) {
+    for (int i = 0; i < m->n; i++) {
+        free(m->v[i]);
+    }
+    free(m->v);
+    memset(m, 0, sizeof(*m));
+}
+
+// ---------------------------------------------------------------------------
+// Tries: command names, and programs on PATH
+//
+// First-child/next-sibling nodes in one array, siblings kept in byte order,
+// so a walk below the prefix's node yields its completions already sorted.
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    int           child, next;  // -1 if none
+    unsigned char c;
+    unsigned char word;         // a word ends here
+} TrieNode;
+
+typedef struct {
+    TrieNode *nodes;            // nodes[0] is the root once anything is inserted
+    int       n, cap;
+} Trie;
+
+static int trie_node(Trie *t, unsigned char c) {
+    if (t->n == t->cap) {
+        int cap = t->cap ? t->cap * 2 : 256;
+        TrieNode *grown = realloc(t->nodes, (size_t)cap * sizeof(TrieNode));
+        if (!grown) {
+            return -1;
+        }
+        t->nodes = grown;
+        t->cap = cap;
+    }
+    t->nodes[t->n] = (TrieNode){ -1, -1, c, 0 };
+    return t->n++;
+}
+
+static int trie_insert(Trie *t, const char *word) {
+    if (t->n == 0 && trie_node(t, 0) < 0) {
+        return -1;
+    }
+    int at = 0;
+    for (const unsigned char *p = (const unsigned char *)word; *p; p++) {
+        int prev = -1, cur = t->nodes[at].child;
+        while (cur >= 0 && t->nodes[cur].c < *p) {
+            prev = cur;
+            cur = t->nodes[cur].next;
+        }
+        if (cur < 0 || t->nodes[cur].c != *p) {
+            int added = trie_node(t, *p);
+            if (added < 0) {
+                return -1;
+            }
+            t->nodes[added].next = cur;
+            if (prev < 0) {
+                t->nodes[at].child = added;
+            } else {
+                t->nodes[prev].next = added;
+            }
+            cur = added;
+        }
+        at = cur;
+    }
+    t->nodes[at].word = 1;
+    return 0;
+}
+
+static int trie_walk(const Trie *t, int at, char *buf, size_t len, Matches *out) {
+    if (t->nodes[at].word && matches_add(out, "", buf, len) != 0) {
+        return -1;
+    }
+    for (int c = t->nodes[at].child; c >= 0; c = t->nodes[c].next) {
+        if (len + 1 < NAME_MAX + 1) {
+            buf[len] = (char)t->nodes[c].c;
+            if (trie_walk(t, c, buf, len + 1, out) != 0) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Add every word starting with `prefix` to out, in order
+static int trie_collect(const Trie *t, const char *prefix, Matches *out) {
+    size_t len = strlen(prefix);
+    if (t->n == 0 || len > NAME_MAX) {
+        return 0;
+    }
+    int at = 0;
+    for (const unsigned char *p = (const unsigned char *)prefix; *p; p++) {
+        int c = t->nodes[at].child;
+        while (c >= 0 && t->nodes[c].c != *p) {
+            c = t->nodes[c].next;
+        }
+        if (c < 0) {
+            return 0;
+        }
+        at = c;
+    }
+    char buf[NAME_MAX + 1];
+    memcpy(buf, prefix, len);
+    return trie_walk(t, at, buf, len, out);
+}
+
+static void trie_clear(Trie *t) {
+    free(t->nodes);
+    memset(t, 0, sizeof(*t));
+}
+
+// ---------------------------------------------------------------------------
+// Directory cache
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const char *name;
+    int         is_dir;         // from d_type; 0 when the type was not reported
+} DirEntry;
+
+typedef struct {
+    char           *path;       // NULL = free slot
+    int             wd;         // inotify watch, or -1: revalidated by mtime
+    struct timespec mtime;
+    int             stale;
+    unsigned long   serial;     // changes on every (re)load
+    unsigned long   last_used;
+    DirEntry       *entries;    // sorted by name
+    int             count;
+    char           *pool;       // the names
+} CachedDir;
+
+static CachedDir dirs[DIR_CACHE_SIZE];
+static unsigned long dir_clock, dir_serial;
+static int inotify_fd = -1;
+
+// Mark the directories whose watches fired since the last completion
+static void drain_events(void) {
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t n;
+    while (inotify_fd >= 0 && (n = read(inotify_fd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + n; ) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            for (int i = 0; i < DIR_CACHE_SIZE; i++) {
+                if (!dirs[i].path) {
+                    continue;
+                }
+                if (ev->mask & IN_Q_OVERFLOW) {
+                    dirs[i].stale = 1;
+                } else if (dirs[i].wd == ev->wd) {
+                    dirs[i].stale = 1;
+                    if (ev->mask & IN_IGNORED) {
+                        dirs[i].wd = -1;    // watch gone (directory removed)
+                    }
+                }
+            }
+            p += sizeof(*ev) + ev->len;
+        }
+    }
+}
+
+static int compare_entries(const void *a, const void *b) {
+    return strcmp(((const DirEntry *)a)->name, ((const DirEntry *)b)->name);
+}
+
+// Read `path` into d, replacing what it held
+static int dir_load(CachedDir *d, const char *path) {
+    if (inotify_fd < 0) {
+        inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    }
+    // Watch before reading, so a change made while we read is not missed
+    if (d->wd < 0 && inotify_fd >= 0) {
+        d->wd = inotify_add_watch(inotify_fd, path, WATCH_MASK | IN_ONLYDIR);
+    }
+
+    DIR *dir = opendir(path);
+    if (!dir) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(dirfd(dir), &st) != 0) {
+        closedir(dir);
+        return -1;
+    }
+
+    // Names back to back in the pool; offsets and types alongside
+    char *pool = NULL;
+    size_t pool_len = 0, pool_cap = 0;
+    size_t *offs = NULL;
+    unsigned char *types = NULL;
+    int count = 0, cap = 0, rc = 0;
+    for (struct dirent *de; rc == 0 && (de = readdir(dir)) != NULL; ) {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) {
+            continue;
+        }
+        size_t len = strlen(de->d_name) + 1;
+        if (pool_len + len > pool_cap) {
+            size_t grown_cap = pool_cap ? pool_cap * 2 : 4096;
+            while (grown_cap < pool_len + len) grown_cap *= 2;
+            char *grown = realloc(pool, grown_cap);
+            if (!grown) {
+                rc = -1;
+                break;
+            }
+            pool = grown;
+            pool_cap = grown_cap;
+        }
+        if (count == cap) {
+            cap = cap ? cap * 2 : 256;
+            size_t *o = realloc(offs, (size_t)cap * sizeof(size_t));
+            if (o) offs = o;
+            unsigned char *t = realloc(types, (size_t)cap);
+            if (t) types = t;
+            if (!o || !t) {
+                rc = -1;
+                break;
+            }
+        }
+        memcpy(pool + pool_len, de->d_name, len);
+        offs[count] = pool_len;
+        types[count++] = de->d_type;
+        pool_len += len;
+    }
+    closedir(dir);
+
+    DirEntry *entries = rc == 0 ? malloc((size_t)(count ? count : 1) * sizeof(DirEntry)) : NULL;
+    if (!entries) {
+        free(pool);
+        free(offs);
+        free(types);
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        entries[i].name = pool + offs[i];
+        entries[i].is_dir = types[i] == DT_DIR;
+    }
+    free(offs);
+    free(types);
+    qsort(entries, (size_t)count, sizeof(DirEntry), compare_entries);
+
+    free(d->entries);
+    free(d->pool);
+    d->entries = entries;
+    d->count = count;
+    d->pool = pool;
+    d->mtime = st.st_mtim;
+    d->stale = 0;
+    d->serial = ++dir_serial;
+    return 0;
+}
+
+static void dir_evict(CachedDir *d) {
+    if (d->wd >= 0) {
+        // Two paths to one directory share a watch: keep it if still used
+        int shared = 0;
+        for (int i = 0; i < DIR_CACHE_SIZE; i++) {
+            shared |= &dirs[i] != d && dirs[i].path && dirs[i].wd == d->wd;
+        }
+        if (!shared) {
+            inotify_rm_watch(inotify_fd, d->wd);
+        }
+    }
+    free(d->path);
+    free(d->entries);
+    free(d->pool);
+    memset(d, 0, sizeof(*d));
+    d->wd = -1;
+}
+
+// The listing of `path`, read now only if it is not cached or has changed
+static CachedDir *dir_get(const char *path) {
+    CachedDir *d = NULL, *victim = NULL;
+    for (int i = 0; i < DIR_CACHE_SIZE && !d; i++) {
+        if (dirs[i].path && strcmp(dirs[i].path, path) == 0) {
+            d = &dirs[i];
+        } else if (!victim || (victim->path && (!dirs[i].path ||
+                                                dirs[i].last_used < victim->last_used))) {
+            victim = &dirs[i];
+        }
+    }
+
+    if (d && !d->stale && d->wd < 0) {
+        struct stat st;
+        d->stale = stat(path, &st) != 0 || st.st_mtim.tv_sec != d->mtime.tv_sec ||
+                   st.st_mtim.tv_nsec != d->mtime.tv_nsec;
+    }
+    if (!d) {
+        if (victim->path) {
+            dir_evict(victim);
+        }
+        d = victim;
+        d->wd = -1;
+        if (!(d->path = strdup(path))) {
+            return NULL;
+        }
+        d->stale = 1;
+    }
+    if (d->stale && dir_load(d, path) != 0) {
+        dir_evict(d);
+        return NULL;
+    }
+    d->last_used = ++dir_clock;
+    return d;
+}
+
+// Index of the first entry not sorting before `prefix`
+static int dir_lower_bound(const CachedDir *d, const char *prefix) {
+    int lo = 0, hi = d->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (strcmp(d->entries[mid].name, prefix) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// File names completing `word`, which may include a directory part and a
+// leading ~/ (kept as typed in the matches)
+static int complete_files(const char *word, Matches *out) {
+    const char *slash = strrchr(word, '/');
+    const char *prefix = slash ? slash + 1 : word;
+    char dir[PATH_MAX], typed[PATH_MAX];
+    size_t dir_len = slash ? (size_t)(slash - word) + 1 : 0;
+    if (dir_len >= sizeof(typed)) {
+        return 0;
+    }
+    memcpy(typed, word, dir_len);
+    typed[dir_len] = '\0';
+
+    if (!slash) {
+        strcpy(dir, ".");
+    } else if (strncmp(typed, "~/", 2) == 0 && getenv("HOME")) {
+        if ((size_t)snprintf(dir, sizeof(dir), "%s%s", getenv("HOME"), typed + 1) >= sizeof(dir)) {
+            return 0;
+        }
+    } else {
+        strcpy(dir, dir_len == 1 ? "/" : typed);
+    }
+
+    CachedDir *d = dir_get(dir);
+    if (!d) {
+        return 0;
+    }
+    size_t plen = strlen(prefix);
+    for (int i = dir_lower_bound(d, prefix);
+         i < d->count && strncmp(d->entries[i].name, prefix, plen) == 0; i++) {
+        if (matches_add(out, typed, d->entries[i].name, strlen(d->entries[i].name)) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Programs on PATH
+// ---------------------------------------------------------------------------
+
+static Trie commands;           // registry names
+static Trie programs;           // executables in the PATH directories
+static char *programs_path;     // PATH the trie was built from
+static unsigned long *programs_serials;     // each PATH directory's listing then
+static int programs_ndirs;
+
+static int is_program(int dfd, const DirEntry *e) {
+    if (e->is_dir) {
+        return 0;
+    }
+    struct stat st;
+    return fstatat(dfd, e->name, &st, 0) == 0 && S_ISREG(st.st_mode) &&
+           faccessat(dfd, e->name, X_OK, AT_EACCESS) == 0;
+}
+
+// Rebuild the programs trie if PATH changed or one of its directories did
+static int refresh_programs(void) {
+    const char *path = getenv("PATH");
+    if (!path) {
+        path = "";
+    }
+    char *copy = strdup(path);
+    if (!copy) {
+        return -1;
+    }
+
+    // Splitting on ':' by hand: an empty entry means the current directory
+    int ndirs = 1;
+    for (const char *p = copy; *p; p++) {
+        ndirs += *p == ':';
+    }
+    unsigned long *serials = calloc((size_t)ndirs, sizeof(unsigned long));
+    if (!serials) {
+        free(copy);
+        return -1;
+    }
+    int changed = !programs_path || strcmp(programs_path, path) != 0;
+    char *entry = copy;
+    for (int i = 0; i < ndirs; i++) {
+        char *colon = strchr(entry, ':');
+        if (colon) *colon = '\0';
+        CachedDir *d = dir_get(*entry ? entry : ".");
+        serials[i] = d ? d->serial : 0;
+        changed |= i >= programs_ndirs || serials[i] != programs_serials[i];
+        entry = colon ? colon + 1 : entry + strlen(entry);
+    }
+
+    if (changed) {
+        trie_clear(&programs);
+        entry = strcpy(copy, path);
+        for (int i = 0; i < ndirs; i++) {
+            char *colon = strchr(entry, ':');
+            if (colon) *colon = '\0';
+            const char *dir = *entry ? entry : ".";
+            CachedDir *d = dir_get(dir);
+            int dfd = d ? open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC) : -1;
+            for (int j = 0; dfd >= 0 && j < d->count; j++) {
+                if (is_program(dfd, &d->entries[j])) {
+                    trie_insert(&programs, d->entries[j].name);
+                }
+            }
+            if (dfd >= 0) {
+                close(dfd);
+            }
+            entry = colon ? colon + 1 : entry + strlen(entry);
+        }
+        free(programs_path);
+        free(programs_serials);
+        programs_path = strdup(path);
+        programs_serials = serials;
+        programs_ndirs = ndirs;
+    } else {
+        free(serials);
+    }
+    free(copy);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// What to complete
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const char *prefix;
+    size_t      len;
+    Matches    *out;
+} VariableQuery;
+
+static void add_variable(const char *name, void *arg) {
+    VariableQuery *q = arg;
+    if (strncmp(name, q->prefix, q->len) == 0) {
+        matches_add(q->out, "$", name, strlen(name));
+    }
+}
+
+// Options and subcommands from the registry (options only once "-" is typed)
+static int complete_words(const char *words, const char *word, Matches *out) {
+    size_t len = strlen(word);
+    while (words && *words) {
+        const char *w = words;
+        size_t n = strcspn(w, " ");
+        words = w + n + strspn(w + n, " ");
+        if ((w[0] != '-' || word[0] == '-') && n >= len && strncmp(w, word, len) == 0 &&
+            matches_add(out, "", w, n) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int complete_jobs(CompleteHint hint, const char *word, Matches *out) {
+    size_t len = strlen(word);
+    for (const Job *job = job_first(); job; job = job->next) {
+        if (hint == COMPLETE_PIDS && job->task) {
+            continue;       // built-in tasks have no process
+        }
+        char id[16];
+        snprintf(id, sizeof(id), "%d", hint == COMPLETE_JOBS ? job->id : (int)job->pid);
+        if (strncmp(id, word, len) == 0 && matches_add(out, "", id, strlen(id)) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// For COMPLETE_PROGRAM: is the next argument a program name (first
+// non-option word, or the word after a "|"), or the value of an option?
+static int program_position(int argc, char *argv[], int *option_value) {
+    int expect = 1;
+    *option_value = 0;
+    for (int i = 1; i < argc; i++) {
+        if (*option_value) {
+            *option_value = 0;
+        } else if (strcmp(argv[i], "|") == 0) {
+            expect = 1;
+        } else if (expect && strncmp(argv[i], "--", 2) == 0) {
+            *option_value = 1;      // every option takes a value
+        } else {
+            expect = 0;
+        }
+    }
+    return expect;
+}
+
+// Fill `out` for the word at [start, end); *files says whether the matches
+// are file names (so readline quotes them and marks directories)
+static int candidates(const char *line, int start, int end, Matches *out, int *files) {
+    *files = 0;
+    drain_events();
+
+    // The word being completed, unquoted; readline leaves an opening quote
+    // just before `start`
+    char *word = strndup(line + start, (size_t)(end - start));
+    char *before = strndup(line, (size_t)start);
+    if (!word || !before) {
+        free(word);
+        free(before);
+        return -1;
+    }
+    lex_unquote(word);
+    int argc = lex_count(before);
+    if (argc < 0 && start > 0) {
+        before[start - 1] = '\0';
+        argc = lex_count(before);
+    }
+    char **argv = argc > 0 ? malloc(((size_t)argc + 1) * sizeof(char *)) : NULL;
+    if (argv) {
+        lex_split(before, argv);
+    }
+
+    int rc = 0;
+    if (!argv) {
+        // The command word: built-ins, then the prompt's own exit/quit
+        static const char *const repl_words[] = { "exit", "quit" };
+        rc = trie_collect(&commands, word, out);
+        for (int i = 0; rc == 0 && i < 2; i++) {
+            if (strncmp(repl_words[i], word, strlen(word)) == 0) {
+                rc = matches_add(out, "", repl_words[i], strlen(repl_words[i]));
+            }
+        }
+    } else if (word[0] == '$') {
+        VariableQuery q = { word + 1, strlen(word + 1), out };
+        script_each_variable(add_variable, &q);
+    } else {
+        const CommandInfo *cmd = registry_find(argv[0]);
+        int option_value = 0;
+        int program = cmd && cmd->complete == COMPLETE_PROGRAM &&
+                      program_position(argc, argv, &option_value);
+        if (!cmd) {
+            // Unknown commands get filenames
+            *files = 1;
+            rc = complete_files(word, out);
+        } else if (option_value) {
+            // The value of an option: nothing to offer
+        } else if (cmd->complete != COMPLETE_PROGRAM || program) {
+            rc = complete_words(cmd->words, word, out);
+        }
+
+        if (rc == 0 && cmd && !option_value) {
+            switch (cmd->complete) {
+            case COMPLETE_JOBS:
+            case COMPLETE_PIDS:
+                rc = complete_jobs(cmd->complete, word, out);
+                break;
+            case COMPLETE_COMMANDS:
+                rc = trie_collect(&commands, word, out);
+                break;
+            case COMPLETE_PROGRAM:
+                if (program && !strchr(word, '/')) {
+                    rc = refresh_programs();
+                    if (rc == 0) rc = trie_collect(&programs, word, out);
+                    break;
+                }
+                // A path, or the program's arguments: files
+                // fall through
+            case COMPLETE_FILES:
+                // Files only when no option or subcommand matched
+                if (out->n == 0) {
+                    *files = 1;
+                    rc = complete_files(word, out);
+                }
+                break;
+            case COMPLETE_NONE:
+                break;
+            }
+        }
+    }
+    free(argv);
+    free(before);
+    free(word);
+    return rc;
+}
+
+char **completion_candidates(const char *line, int start, int end) {
+    Matches m = { 0 };
+    int files;
+    if (candidates(line, start, end, &m, &files) != 0 || m.n == 0) {
+        matches_free(&m);
+        return NULL;
+    }
+    return m.v;
+}
+
+// ---------------------------------------------------------------------------
+// Readline
+// ---------------------------------------------------------------------------
+
+static Matches pending;
+static int pending_next;
+
+// Hands the precomputed matches to rl_completion_matches(), which frees them
+static char *pending_generator(const char *text, int state) {
+    (void)text;
+    if (!state) {
+        pending_next = 0;
+    }
+    if (pending_next < pending.n) {
+        char *match = pending.v[pending_next];
+        pending.v[pending_next++] = NULL;
+        return match;
+    }
+    return NULL;
+}
+
+static char **securecli_completion(const char *text, int start, int end) {
+    // Whatever we return is final: no fallback to filenames for "pslist <TAB>"
+    rl_attempted_completion_over = 1;
+
+    int files;
+    char **matches = NULL;
+    if (candidates(rl_line_buffer, start, end, &pending, &files) == 0 && pending.n > 0) {
+        rl_filename_completion_desired = files;
+        matches = rl_completion_matches(text, pending_generator);
+    }
+    matches_free(&pending);
+    return matches;
+}
+
+// A blank is part of the word if it is quoted or escaped (see lexer.h)
+static int char_is_quoted(char *line, int index) {
+    LexQuote q = LEX_PLAIN;
+    int i = 0;
+    while (i < index) {
+        int n = (int)lex_step(line + i, &q);
+        if (i + n > index) {
+            return 1;       // escaped by the backslash at i
+        }
+        i += n;
+    }
+    return q != LEX_PLAIN;
+}
+
+void completion_init(void) {
+    for (int i = 0; i < registry_count(); i++) {
+        trie_insert(&commands, registry_at(i)->name);
+    }
+
+    // Words break at blanks only, and quote the way the lexer reads them
+    rl_completer_word_break_characters = " \t";
+    rl_completer_quote_characters = "\"'";
+    rl_filename_quote_characters = " \t\"'\\";
+    rl_char_is_quoted_p = char_is_quoted;
+    rl_attempted_completion_function = securecli_completion;
+}
@@ -0,0 +1,24 @@
+#ifndef COMPLETION_H
+#define COMPLETION_H
+
+// Tab completion for the interactive prompt. Command names come from a
+// trie built from the command registry; a command's arguments complete as
+// its registry entry says (options, job IDs, PIDs, command names, programs
+// on PATH or files), and a word starting with $ completes to a session
+// script variable.
+//
+// Directory listings are read once and cached, sorted, for prefix lookups;
+// an inotify watch on each cached directory marks it stale when an entry is
+// added, removed, renamed or changes mode, so a Tab in a large or slow
+// (network-mounted) directory does not re-read it every time. Directories
+// that cannot be watched are re-checked by modification time instead.
+
+// Install the completer into readline
+void completion_init(void);
+
+// Completions for the word at [start, end) of `line`, where `line` holds at
+// least everything before the cursor: a NULL-terminated array of malloc'd
+// strings (the caller frees them and the array), or NULL if there are none
+char **completion_candidates(const char *line, int start, int end);
+
+#endif
@@ -7,6 +7,16 @@
 char default_color[10] = "green";
 char startup_dir[256] = ".";
 int show_banner = 1;
+char log_fsync[16] = "none";
+int log_fsync_interval_ms = 1000;
+int log_max_size_kb = 10240;
+int log_max_age_hours = 0;
+int log_keep_segments = 10;
+int log_retention_days = 0;
+int log_compress = 1;
+int dashboard_refresh_ms = 1000;
+int metrics_interval_ms = 5000;
+int history_max_kb = 16384;
 
 // Load configuration from .securecli_config file
 void load_config(void) {
@@ -26,6 +36,27 @@ void load_config(void) {
             startup_dir[sizeof(startup_dir) - 1] = '\0';
         } else if (strcmp(key, "show_banner") == 0) {
             show_banner = atoi(value);
+        } else if (strcmp(key, "log_fsync") == 0) {
+            strncpy(log_fsync, value, sizeof(log_fsync) - 1);
+            log_fsync[sizeof(log_fsync) - 1] = '\0';
+        } else if (strcmp(key, "log_fsync_interval_ms") == 0) {
+            log_fsync_interval_ms = atoi(value);
+        } else if (strcmp(key, "log_max_size_kb") == 0) {
+            log_max_size_kb = atoi(value);
+        } else if (strcmp(key, "log_max_age_hours") == 0) {
+            log_max_age_hours = atoi(value);
+        } else if (strcmp(key, "log_keep_segments") == 0) {
+            log_keep_segments = atoi(value);
+        } else if (strcmp(key, "log_retention_days") == 0) {
+            log_retention_days = atoi(value);
+        } else if (strcmp(key, "log_compress") == 0) {
+            log_compress = atoi(value);
+        } else if (strcmp(key, "dashboard_refresh_ms") == 0) {
+            dashboard_refresh_ms = atoi(value);
+        } else if (strcmp(key, "metrics_interval_ms") == 0) {
+            metrics_interval_ms = atoi(value);
+        } else if (strcmp(key, "history_max_kb") == 0) {
+            history_max_kb = atoi(value);
         }
     }
     fclose(f);
@@ -5,6 +5,16 @@
 extern char default_color[10];
 extern char startup_dir[256];
 extern int show_banner;
+extern char log_fsync[16];          // "none", "batch" or "interval"
+extern int log_fsync_interval_ms;   // used with log_fsync = interval
+extern int log_max_size_kb;         // rotate securecli.log at this size (0 = never)
+extern int log_max_age_hours;       // ... or at this age (0 = never)
+extern int log_keep_segments;       // rotated segments to keep (0 = unlimited)
+extern int log_retention_days;      // delete segments older than this (0 = never)
+extern int log_compress;            // gzip rotated segments in the background
+extern int dashboard_refresh_ms;    // dashboard sampling/refresh interval (min 100)
+extern int metrics_interval_ms;     // metrics exporter sampling interval (min 100)
+extern int history_max_kb;          // compact .securecli_history to this size (0 = never)
 
 // Load configuration from .securecli_config file
 void load_config(void);
@@ -1,4 +1,7 @@
 #include "crypto.h"
+#include "cli_output.h"
+#include "tasks.h"
+#include "metrics.h"
 #include <openssl/evp.h>
 #include <openssl/rand.h>
 #include <openssl/sha.h>
@@ -36,13 +39,13 @@ bool encrypt_file(const char *in_path, const char *out_path, const char *passwor
 
     // Open files
     fin = fopen(in_path, "rb");
-    if (!fin) { fprintf(stderr, "Encryption failed\n"); goto cleanup; }
+    if (!fin) { fprintf(cli_err(), "Encryption failed\n"); goto cleanup; }
     fout = fopen(out_path, "wb");
-    if (!fout) { fprintf(stderr, "Encryption failed\n"); goto cleanup; }
+    if (!fout) { fprintf(cli_err(), "Encryption failed\n"); goto cleanup; }
 
     // Generate salt and IV
-    if (RAND_bytes(salt, SALT_SIZE) != 1) { fprintf(stderr, "Encryption failed\n"); goto cleanup; }
-    if (RAND_bytes(iv, IV_SIZE) != 1) { fprintf(stderr, "Encryption failed\n"); goto cleanup; }
+    if (RAND_bytes(salt, SALT_SIZE) != 1) { fprintf(cli_err(), "Encryption failed\n"); goto cleanup; }
+    if (RAND_bytes(iv, IV_SIZE) != 1) { fprintf(cli_err(), "Encryption failed\n"); goto cleanup; }
 
     // Derive key using PBKDF2 (HMAC-SHA256) with 100k iterations
     if (PKCS5_PBKDF2_HMAC(password, strlen(password),
@@ -50,45 +53,51 @@ bool encrypt_file(const char *in_path, const char *out_path, const char *passwor
                           PBKDF2_ITER,
                           EVP_sha256(),
                           KEY_SIZE, key) != 1) {
-        fprintf(stderr, "Encryption failed\n"); goto cleanup;
+        fprintf(cli_err(), "Encryption failed\n"); goto cleanup;
     }
 
     // Write salt and IV to output file (header)
-    if (!write_all(fout, salt, SALT_SIZE)) { fprintf(stderr, "Encryption failed\n"); goto cleanup; }
-    if (!write_all(fout, iv, IV_SIZE)) { fprintf(stderr, "Encryption failed\n"); goto cleanup; }
+    if (!write_all(fout, salt, SALT_SIZE)) { fprintf(cli_err(), "Encryption failed\n"); goto cleanup; }
+    if (!write_all(fout, iv, IV_SIZE)) { fprintf(cli_err(), "Encryption failed\n"); goto cleanup; }
 
     // Setup encryption with AES-256-GCM
     ctx = EVP_CIPHER_CTX_new();
-    if (!ctx) { fprintf(stderr, "Encryption failed\n"); goto cleanup; }
+    if (!ctx) { fprintf(cli_err(), "Encryption failed\n"); goto cleanup; }
     if (EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, key, iv) != 1) { 
-        fprintf(stderr, "Encryption failed\n"); goto cleanup; 
+        fprintf(cli_err(), "Encryption failed\n"); goto cleanup; 
     }
 
-    // Process file
+    // Process file (reporting progress when running as a background task)
+    struct stat st;
+    long long total = (fstat(fileno(fin), &st) == 0) ? (long long)st.st_size : 0;
+    long long done = 0;
     size_t r;
     while ((r = fread(inbuf, 1, BUF_SIZE, fin)) > 0) {
+        if (task_cancelled()) { fprintf(cli_err(), "Encryption cancelled\n"); goto cleanup; }
+        task_progress(done += r, total);
         if (EVP_EncryptUpdate(ctx, outbuf, &outlen, inbuf, (int)r) != 1) { 
-            fprintf(stderr, "Encryption failed\n"); goto cleanup; 
+            fprintf(cli_err(), "Encryption failed\n"); goto cleanup; 
         }
-        if (!write_all(fout, outbuf, outlen)) { fprintf(stderr, "Encryption failed\n"); goto cleanup; }
+        metrics_crypto_bytes(METRICS_CRYPTO_ENCRYPT, r);
+        if (!write_all(fout, outbuf, outlen)) { fprintf(cli_err(), "Encryption failed\n"); goto cleanup; }
     }
-    if (ferror(fin)) { fprintf(stderr, "Encryption failed\n"); goto cleanup; }
+    if (ferror(fin)) { fprintf(cli_err(), "Encryption failed\n"); goto cleanup; }
 
     // Finalize encryption
     if (EVP_EncryptFinal_ex(ctx, outbuf, &outlen) != 1) { 
-        fprintf(stderr, "Encryption failed\n"); goto cleanup; 
+        fprintf(cli_err(), "Encryption failed\n"); goto cleanup; 
     }
     if (outlen > 0) {
-        if (!write_all(fout, outbuf, outlen)) { fprintf(stderr, "Encryption failed\n"); goto cleanup; }
+        if (!write_all(fout, outbuf, outlen)) { fprintf(cli_err(), "Encryption failed\n"); goto cleanup; }
     }
 
     // Get authentication tag
     if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, TAG_SIZE, tag) != 1) {
-        fprintf(stderr, "Encryption failed\n"); goto cleanup;
+        fprintf(cli_err(), "Encryption failed\n"); goto cleanup;
     }
 
     // Write tag at the end
-    if (!write_all(fout, tag, TAG_SIZE)) { fprintf(stderr, "Encryption failed\n"); goto cleanup; }
+    if (!write_all(fout, tag, TAG_SIZE)) { fprintf(cli_err(), "Encryption failed\n"); goto cleanup; }
 
     ok = true;
 
@@ -119,9 +128,9 @@ bool decrypt_file(const char *in_path, const char *out_path, const char *passwor
     long file_size, ciphertext_size;
 
     fin = fopen(in_path, "rb");
-    if (!fin) { fprintf(stderr, "Decryption failed\n"); goto cleanup; }
+    if (!fin) { fprintf(cli_err(), "Decryption failed\n"); goto cleanup; }
     fout = fopen(out_path, "wb");
-    if (!fout) { fprintf(stderr, "Decryption failed\n"); goto cleanup; }
+    if (!fout) { fprintf(cli_err(), "Decryption failed\n"); goto cleanup; }
 
     // Get file size
     fseek(fin, 0, SEEK_END);
@@ -131,16 +140,16 @@ bool decrypt_file(const char *in_path, const char *out_path, const char *passwor
     // Check minimum file size (salt + iv + tag)
     if (file_size < SALT_SIZE + IV_SIZE + TAG_SIZE) {
         // Generic error message - don't leak details
-        fprintf(stderr, "Decryption failed\n");
+        fprintf(cli_err(), "Decryption failed\n");
         goto cleanup;
     }
 
     // Read salt and IV from file
     if (fread(salt, 1, SALT_SIZE, fin) != SALT_SIZE) { 
-        fprintf(stderr, "Decryption failed\n"); goto cleanup; 
+        fprintf(cli_err(), "Decryption failed\n"); goto cleanup; 
     }
     if (fread(iv, 1, IV_SIZE, fin) != IV_SIZE) { 
-        fprintf(stderr, "Decryption failed\n"); goto cleanup; 
+        fprintf(cli_err(), "Decryption failed\n"); goto cleanup; 
     }
 
     // Calculate ciphertext size (file - salt - iv - tag)
@@ -152,14 +161,14 @@ bool decrypt_file(const char *in_path, const char *out_path, const char *passwor
                           PBKDF2_ITER,
                           EVP_sha256(),
                           KEY_SIZE, key) != 1) {
-        fprintf(stderr, "Decryption failed\n"); goto cleanup;
+        fprintf(cli_err(), "Decryption failed\n"); goto cleanup;
     }
 
     // Setup decryption with AES-256-GCM
     ctx = EVP_CIPHER_CTX_new();
-    if (!ctx) { fprintf(stderr, "Decryption failed\n"); goto cleanup; }
+    if (!ctx) { fprintf(cli_err(), "Decryption failed\n"); goto cleanup; }
     if (EVP_DecryptInit_ex(ctx, EVP_aes_256_gcm(), NULL, key, iv) != 1) { 
-        fprintf(stderr, "Decryption failed\n"); goto cleanup; 
+        fprintf(cli_err(), "Decryption failed\n"); goto cleanup; 
     }
 
     // Read and decrypt ciphertext (excluding tag)
@@ -170,40 +179,43 @@ bool decrypt_file(const char *in_path, const char *out_path, const char *passwor
                           (size_t)(ciphertext_size - bytes_read) : BUF_SIZE, 
                           fin);
         if (inlen <= 0) break;
-        
+        if (task_cancelled()) { fprintf(cli_err(), "Decryption cancelled\n"); goto cleanup; }
+        task_progress(bytes_read + inlen, ciphertext_size);
+
         if (EVP_DecryptUpdate(ctx, outbuf, &outlen, inbuf, inlen) != 1) { 
-            fprintf(stderr, "Decryption failed\n"); goto cleanup; 
+            fprintf(cli_err(), "Decryption failed\n"); goto cleanup; 
         }
+        metrics_crypto_bytes(METRICS_CRYPTO_DECRYPT, (size_t)inlen);
         if (outlen > 0) {
             if (fwrite(outbuf, 1, outlen, fout) != (size_t)outlen) { 
-                fprintf(stderr, "Decryption failed\n"); goto cleanup; 
+                fprintf(cli_err(), "Decryption failed\n"); goto cleanup; 
             }
         }
         bytes_read += inlen;
     }
     if (ferror(fin)) { 
-        fprintf(stderr, "Decryption failed\n"); goto cleanup; 
+        fprintf(cli_err(), "Decryption failed\n"); goto cleanup; 
     }
 
     // Read authentication tag from end of file
     if (fread(tag, 1, TAG_SIZE, fin) != TAG_SIZE) {
-        fprintf(stderr, "Decryption failed\n"); goto cleanup;
+        fprintf(cli_err(), "Decryption failed\n"); goto cleanup;
     }
 
     // Set expected tag for verification
     if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, TAG_SIZE, tag) != 1) {
-        fprintf(stderr, "Decryption failed\n"); goto cleanup;
+        fprintf(cli_err(), "Decryption failed\n"); goto cleanup;
     }
 
     // Finalize and verify tag
     if (EVP_DecryptFinal_ex(ctx, outbuf, &outlen) != 1) {
         // Generic error - don't leak whether it's wrong password or corrupted file
-        fprintf(stderr, "Decryption failed\n");
+        fprintf(cli_err(), "Decryption failed\n");
         goto cleanup;
     }
     if (outlen > 0) {
         if (fwrite(outbuf, 1, outlen, fout) != (size_t)outlen) { 
-            fprintf(stderr, "Decryption failed\n"); goto cleanup; 
+            fprintf(cli_err(), "Decryption failed\n"); goto cleanup; 
         }
     }
 
@@ -234,9 +246,15 @@ bool sha256_file_hex(const char *path, char *out_hex) {
     if (!mdctx) { fclose(f); return false; }
     if (EVP_DigestInit_ex(mdctx, EVP_sha256(), NULL) != 1) { goto cleanup; }
 
+    struct stat st;
+    long long total = (fstat(fileno(f), &st) == 0) ? (long long)st.st_size : 0;
+    long long done = 0;
     size_t r;
     while ((r = fread(buf, 1, BUF_SIZE, f)) > 0) {
+        if (task_cancelled()) { goto cleanup; }
+        task_progress(done += r, total);
         if (EVP_DigestUpdate(mdctx, buf, r) != 1) { goto cleanup; }
+        metrics_crypto_bytes(METRICS_CRYPTO_CHECKSUM, r);
     }
     if (ferror(f)) { goto cleanup; }
 
@@ -1,6 +1,8 @@
 #include <ncurses.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <string.h>
+#include <errno.h>
 #include <unistd.h>
 #include <time.h>
 #ifdef __linux__
@@ -8,72 +10,379 @@
 #endif
 #include "dashboard.h"
 #include "logger.h"
+#include "log_tail.h"
+#include "collectors.h"
+#include "timeline.h"
+
+#define HISTORY_LEN 240          // samples kept per series (one per refresh)
+
+// Replay speeds are powers of two in this range; gaps in a recording
+// (the dashboard was closed) play back as at most REPLAY_MAX_GAP_MS
+#define REPLAY_MIN_SPEED 0.25
+#define REPLAY_MAX_SPEED 64.0
+#define REPLAY_MAX_GAP_MS 2000
+
+// A bordered window plus what its interior currently shows, so a refresh
+// writes only the cells whose content changed
+typedef struct {
+    WINDOW     *win;
+    const char *title;
+    int         h, w;
+    chtype     *cells;           // (h - 2) * (w - 2) interior cells; 0 = unknown
+} Panel;
+
+enum { PANEL_PROCS, PANEL_CPU, PANEL_MEM, PANEL_DISK, PANEL_NET, PANEL_LOG, PANEL_STATUS, PANEL_COUNT };
+
+static const char *panel_titles[PANEL_COUNT] = {
+    "Processes (PID | CPU% | MEM%)", "CPU Cores", "Memory Usage", "Disk I/O",
+    "Network", "Command Log", "System Status",
+};
+
+static Panel panels[PANEL_COUNT];
+static int dashboard_active = 0;
 
-#define LOG_FILE "securecli.log"
-#define MAX_LOG_LINES 20
-#define MAX_PROCESS_LINES 15
+static ProcSampler procs;
+static CpuSampler cpus;
+static DevSampler disks;
+static DevSampler nics;
+static LogTail log_tail;
+static unsigned long log_seen;   // log_tail.seen at the previous sample
+
+// Recording (dashboard --record) and replay (dashboard --replay)
+static TimelineWriter recorder;
+static int recording = 0;
+static int record_errno = 0;     // why recording stopped, or 0
+static TimelineReader replay;
+static int replaying = 0;
+static int replay_paused = 0;
+static double replay_speed = 1;
+
+// The sample on screen, for redraws that must not take a new one
+static DashSample shown;
+
+// Preallocated at init; drawing never allocates
+static History cpu_hist[DASH_MAX_CPUS + 1];
+static History mem_hist;
+static History disk_hist[2];     // read, write bytes/s
+static History net_hist[2];      // rx, tx bytes/s
+static int hist_cpus;
+
+// -------------------- SAMPLING --------------------
+static void collect_sample(DashSample *s) {
+    memset(s, 0, sizeof(*s));
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    s->time_ms = (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+#ifdef __linux__
+    struct sysinfo info;
+    if (sysinfo(&info) == 0) {
+        s->uptime = info.uptime;
+    }
+#endif
+    if (getloadavg(s->load, 3) != 3) {
+        s->load[0] = s->load[1] = s->load[2] = 0;
+    }
+    meminfo_read(&s->mem);
 
-static WINDOW *process_win;
-static WINDOW *memory_win;
-static WINDOW *log_win;
-static WINDOW *status_win;
-static int dashboard_active = 0;
+    int n = proc_sampler_sample(&procs, s->procs, DASH_MAX_PROCS);
+    s->nprocs = n > 0 ? n : 0;
+    s->tasks = procs.total;
 
-// -------------------- MEMORY INFO --------------------
-static void get_memory_info(char *buffer, size_t size) {
-    FILE *meminfo = fopen("/proc/meminfo", "r");
-    if (!meminfo) {
-        snprintf(buffer, size, "Unable to read memory info");
-        return;
+    if (cpu_sampler_sample(&cpus) == 0) {
+        s->ncpu = cpus.ncpu < DASH_MAX_CPUS ? cpus.ncpu : DASH_MAX_CPUS;
+        memcpy(s->cpu, cpus.util, (size_t)(s->ncpu + 1) * sizeof(float));
+    }
+    if (disk_sampler_sample(&disks) == 0) {
+        memcpy(s->disk, disks.total, sizeof(s->disk));
+    }
+    if (net_sampler_sample(&nics) == 0) {
+        memcpy(s->net, nics.total, sizeof(s->net));
     }
 
-    long total_mem = 0, free_mem = 0, available_mem = 0;
-    char line[256];
+    // Newest log lines; reads only what was appended since the last tick
+    logger_flush();   // show entries still queued for the log writer
+    log_tail_poll(&log_tail);
+    s->nlog = log_tail.count < DASH_LOG_LINES ? log_tail.count : DASH_LOG_LINES;
+    int skip = log_tail.count - s->nlog;
+    for (int i = 0; i < s->nlog; i++) {
+        snprintf(s->log[i], DASH_LINE_MAX, "%s", log_tail_line(&log_tail, skip + i));
+    }
+    unsigned long fresh = log_tail.seen - log_seen;
+    s->log_fresh = fresh < (unsigned long)s->nlog ? (int)fresh : s->nlog;
+    log_seen = log_tail.seen;
+}
 
-    while (fgets(line, sizeof(line), meminfo)) {
-        if (sscanf(line, "MemTotal: %ld kB", &total_mem) == 1) continue;
-        if (sscanf(line, "MemFree: %ld kB", &free_mem) == 1) continue;
-        if (sscanf(line, "MemAvailable: %ld kB", &available_mem) == 1) break;
+static void record_history(const DashSample *s) {
+    for (int i = 0; i <= s->ncpu && i < hist_cpus; i++) {
+        history_push(&cpu_hist[i], s->cpu[i]);
+    }
+    if (s->mem.total_kb > 0) {
+        history_push(&mem_hist, (float)((s->mem.total_kb - s->mem.available_kb) * 100.0 / s->mem.total_kb));
     }
-    fclose(meminfo);
+    history_push(&disk_hist[0], (float)s->disk[DISK_READ_BYTES]);
+    history_push(&disk_hist[1], (float)s->disk[DISK_WRITE_BYTES]);
+    history_push(&net_hist[0], (float)s->net[NET_RX_BYTES]);
+    history_push(&net_hist[1], (float)s->net[NET_TX_BYTES]);
+}
+
+// -------------------- FORMATTING --------------------
+static void format_rate(double bytes_per_sec, char *buf, size_t size) {
+    const char *units[] = { "B/s", "KB/s", "MB/s", "GB/s" };
+    int u = 0;
+    while (bytes_per_sec >= 1024 && u < 3) {
+        bytes_per_sec /= 1024;
+        u++;
+    }
+    snprintf(buf, size, "%6.1f %s", bytes_per_sec, units[u]);
+}
 
-    if (total_mem > 0) {
-        long used_mem = total_mem - available_mem;
-        double used_percent = (double)used_mem / total_mem * 100.0;
-        snprintf(buffer, size,
-            "Total: %.1f MB\nUsed: %.1f MB (%.1f%%)\nFree: %.1f MB\nAvailable: %.1f MB",
-            total_mem / 1024.0, used_mem / 1024.0, used_percent,
-            free_mem / 1024.0, available_mem / 1024.0);
+// -------------------- DAMAGE TRACKING --------------------
+
+// Border and title; also forgets the interior so the next refresh
+// repaints every cell
+static void panel_frame(Panel *p) {
+    werase(p->win);
+    box(p->win, 0, 0);
+    wattron(p->win, COLOR_PAIR(1));
+    mvwprintw(p->win, 0, 1, " %s ", p->title);
+    wattroff(p->win, COLOR_PAIR(1));
+    memset(p->cells, 0, (size_t)(p->h - 2) * (size_t)(p->w - 2) * sizeof(chtype));
+}
+
+// Write `text` at interior row y, column x (1-based like the window),
+// padded with blanks to `width` cells (<= 0: to the border). Only cells
+// that differ from what is on screen are touched.
+static void panel_text(Panel *p, int y, int x, int width, attr_t attr, const char *text) {
+    int inner_w = p->w - 2;
+    if (!p->cells || y < 1 || y > p->h - 2 || x < 1 || x > inner_w) return;
+    if (width <= 0 || x + width - 1 > inner_w) width = inner_w - x + 1;
+
+    chtype *row = p->cells + (size_t)(y - 1) * (size_t)inner_w;
+    int ended = 0;
+    for (int i = 0; i < width; i++) {
+        unsigned char c = ended ? ' ' : (unsigned char)text[i];
+        if (c == '\0') {
+            ended = 1;
+            c = ' ';
+        }
+        chtype cell = (chtype)c | attr;
+        if (row[x - 1 + i] != cell) {
+            row[x - 1 + i] = cell;
+            mvwaddch(p->win, y, x + i, cell);
+        }
+    }
+}
+
+static void panel_print(Panel *p, int y, int x, int width, attr_t attr, const char *fmt, ...)
+    __attribute__((format(printf, 6, 7)));
+
+static void panel_print(Panel *p, int y, int x, int width, attr_t attr, const char *fmt, ...) {
+    char buf[512];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    panel_text(p, y, x, width, attr, buf);
+}
+
+// Blank the interior rows from `y` down (rows not drawn this refresh)
+static void panel_clear_from(Panel *p, int y) {
+    for (; y <= p->h - 2; y++) {
+        panel_text(p, y, 1, 0, A_NORMAL, "");
+    }
+}
+
+// The newest `width` samples of `h`, scaled to `max` (0 = the history's
+// own peak), right-aligned at (y, x)
+static void panel_sparkline(Panel *p, int y, int x, int width, const History *h, float max) {
+    static const char levels[] = " .:-=+*#";
+    const int nlevels = (int)sizeof(levels) - 1;
+    if (width <= 0) return;
+    if (max <= 0) max = history_max(h);
+
+    char line[HISTORY_LEN + 1];
+    if (width > HISTORY_LEN) width = HISTORY_LEN;
+    int shown = h->count < width ? h->count : width;
+    memset(line, ' ', (size_t)width);
+    for (int i = 0; i < shown; i++) {
+        float v = history_at(h, h->count - shown + i);
+        int level = max > 0 ? (int)(v / max * (nlevels - 1) + 0.5f) : 0;
+        if (level < 0) level = 0;
+        if (level >= nlevels) level = nlevels - 1;
+        if (v > 0 && level == 0) level = 1;    // any activity is visible
+        line[width - shown + i] = levels[level];
+    }
+    line[width] = '\0';
+    panel_text(p, y, x, width, COLOR_PAIR(2), line);
+}
+
+// -------------------- PANELS --------------------
+static void draw_processes(const DashSample *s) {
+    Panel *p = &panels[PANEL_PROCS];
+    panel_text(p, 1, 1, 0, A_NORMAL, "PID     CPU%   MEM%   COMMAND");
+    panel_text(p, 2, 1, 0, A_NORMAL, "-------------------------------");
+
+    // Sampled straight from /proc: no ps process per refresh
+    int y = 3;
+    for (int i = 0; i < s->nprocs && y <= p->h - 2; i++, y++) {
+        panel_print(p, y, 1, 0, A_NORMAL, "%-7d %5.1f  %5.1f   %s",
+                    (int)s->procs[i].pid, s->procs[i].cpu, s->procs[i].mem, s->procs[i].comm);
+    }
+    panel_clear_from(p, y);
+}
+
+static void draw_cpus(const DashSample *s) {
+    Panel *p = &panels[PANEL_CPU];
+
+    // One row per core (as many as fit) after the all-CPU row
+    int y = 1;
+    for (int i = 0; i <= s->ncpu && y <= p->h - 2; i++, y++) {
+        if (i == 0) {
+            panel_print(p, y, 1, 14, A_NORMAL, "all    %5.1f%%", s->cpu[0]);
+        } else {
+            panel_print(p, y, 1, 14, A_NORMAL, "cpu%-3d %5.1f%%", i - 1, s->cpu[i]);
+        }
+        if (i < hist_cpus) {
+            panel_sparkline(p, y, 15, p->w - 16, &cpu_hist[i], 100);
+        }
+    }
+    panel_clear_from(p, y);
+}
+
+static void draw_memory(const DashSample *s) {
+    Panel *p = &panels[PANEL_MEM];
+
+    if (s->mem.total_kb > 0) {
+        long used = s->mem.total_kb - s->mem.available_kb;
+        panel_print(p, 1, 1, 0, A_NORMAL, "Total: %.1f MB", s->mem.total_kb / 1024.0);
+        panel_print(p, 2, 1, 0, A_NORMAL, "Used: %.1f MB (%.1f%%)", used / 1024.0,
+                    (double)used / s->mem.total_kb * 100.0);
+        panel_print(p, 3, 1, 0, A_NORMAL, "Free: %.1f MB", s->mem.free_kb / 1024.0);
+        panel_print(p, 4, 1, 0, A_NORMAL, "Available: %.1f MB", s->mem.available_kb / 1024.0);
+        panel_sparkline(p, 5, 1, p->w - 2, &mem_hist, 100);
     } else {
-        snprintf(buffer, size, "Memory info unavailable");
+        panel_text(p, 1, 1, 0, A_NORMAL, "Memory info unavailable");
+        panel_clear_from(p, 2);
     }
 }
 
-// -------------------- LOG READING --------------------
-static void read_log_lines(char lines[][256], int max_lines, int *count) {
-    *count = 0;
-    FILE *log = fopen(LOG_FILE, "r");
-    if (!log) return;
+// Two series with their rates and sparklines (disk read/write, NIC rx/tx)
+static void draw_io(Panel *p, const char *labels[2], const double rate[2],
+                    const double ops[2], const char *ops_unit, const History hist[2]) {
+    for (int i = 0; i < 2; i++) {
+        char buf[32];
+        format_rate(rate[i], buf, sizeof(buf));
+        panel_print(p, 1 + 2 * i, 1, 0, A_NORMAL, "%-6s %s %7.0f %s", labels[i], buf, ops[i], ops_unit);
+        panel_sparkline(p, 2 + 2 * i, 1, p->w - 2, &hist[i], 0);
+    }
+}
 
-    char all_lines[1000][256];
-    int total = 0;
-    while (fgets(all_lines[total], sizeof(all_lines[0]), log) && total < 1000) {
-        all_lines[total][strcspn(all_lines[total], "\n")] = 0;
-        total++;
+static void draw_log(const DashSample *s) {
+    Panel *p = &panels[PANEL_LOG];
+
+    // Newest lines that fit
+    int fit = p->h - 2;
+    int first = s->nlog > fit ? s->nlog - fit : 0;
+    int y = 1;
+    for (int i = first; i < s->nlog; i++, y++) {
+        panel_text(p, y, 1, 0, COLOR_PAIR(5), s->log[i]);
     }
-    fclose(log);
+    panel_clear_from(p, y);
+}
+
+static void draw_status(const DashSample *s) {
+    Panel *p = &panels[PANEL_STATUS];
 
-    int start = (total > max_lines) ? total - max_lines : 0;
+    long days = s->uptime / 86400;
+    long hours = (s->uptime % 86400) / 3600;
+    long mins = (s->uptime % 3600) / 60;
+    panel_print(p, 1, 1, 0, A_NORMAL, "Uptime: %ldd %ldh %ldm", days, hours, mins);
 
-    for (int i = start; i < total && *count < max_lines; i++) {
-        strncpy(lines[*count], all_lines[i], sizeof(lines[0]) - 1);
-        lines[*count][sizeof(lines[0]) - 1] = '\0';
-        (*count)++;
+    struct tm tm_info;
+    char time_str[64];
+    time_t when = (time_t)(s->time_ms / 1000);
+    localtime_r(&when, &tm_info);
+    strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", &tm_info);
+    panel_print(p, 2, 1, 0, A_NORMAL, "Time: %s", time_str);
+    panel_print(p, 3, 1, 0, A_NORMAL, "Load: %.2f %.2f %.2f  Tasks: %d",
+                s->load[0], s->load[1], s->load[2], s->tasks);
+
+    if (replaying) {
+        char speed[16];
+        if (replay_speed >= 1) {
+            snprintf(speed, sizeof(speed), "%gx", replay_speed);
+        } else {
+            snprintf(speed, sizeof(speed), "1/%gx", 1 / replay_speed);
+        }
+        panel_print(p, 4, 1, 0, COLOR_PAIR(3) | A_BOLD, "REPLAY %ld/%ld  %s%s", replay.pos + 1,
+                    replay.count, speed, replay_paused ? "  paused" : "");
+        panel_text(p, 5, 1, 0, A_NORMAL, "Space pause  ,/. step  Arrows 1m");
+        panel_text(p, 6, 1, 0, A_NORMAL, "PgUp/PgDn 10m  +/- speed  q quit");
+        return;
+    }
+    if (recording) {
+        panel_print(p, 4, 1, 0, COLOR_PAIR(3), "Recording: %ld samples", recorder.count);
+    } else if (record_errno) {
+        panel_print(p, 4, 1, 0, COLOR_PAIR(3), "Recording stopped: %s", strerror(record_errno));
     }
+    panel_text(p, 5, 1, 0, A_NORMAL, "Press 'q' to quit dashboard");
+    panel_text(p, 6, 1, 0, A_NORMAL, "Press 'r' to redraw");
 }
 
 // -------------------- DASHBOARD INIT --------------------
-int dashboard_init(void) {
+
+static void destroy_windows(void) {
+    for (int i = 0; i < PANEL_COUNT; i++) {
+        if (panels[i].win) delwin(panels[i].win);
+        free(panels[i].cells);
+        memset(&panels[i], 0, sizeof(panels[i]));
+    }
+}
+
+static int create_panel(int idx, int h, int w, int y, int x) {
+    Panel *p = &panels[idx];
+    p->title = panel_titles[idx];
+    p->h = h;
+    p->w = w;
+    p->win = (h > 2 && w > 2) ? newwin(h, w, y, x) : NULL;
+    p->cells = p->win ? calloc((size_t)(h - 2) * (size_t)(w - 2), sizeof(chtype)) : NULL;
+    if (!p->win || !p->cells) {
+        return -1;
+    }
+    panel_frame(p);
+    return 0;
+}
+
+// Processes and CPU on top, memory/disk/network in the middle, log and
+// status at the bottom
+static int create_windows(void) {
+    int max_y, max_x;
+    getmaxyx(stdscr, max_y, max_x);
+
+    int top_h = max_y * 2 / 5;
+    int mid_h = 7;
+    if (top_h < 6) top_h = 6;
+    int bottom_h = max_y - top_h - mid_h;
+    if (bottom_h < 3) bottom_h = 3;
+    int third = max_x / 3;
+
+    int rc = 0;
+    rc |= create_panel(PANEL_PROCS, top_h, max_x / 2, 0, 0);
+    rc |= create_panel(PANEL_CPU, top_h, max_x - max_x / 2, 0, max_x / 2);
+    rc |= create_panel(PANEL_MEM, mid_h, third, top_h, 0);
+    rc |= create_panel(PANEL_DISK, mid_h, third, top_h, third);
+    rc |= create_panel(PANEL_NET, mid_h, max_x - 2 * third, top_h, 2 * third);
+    rc |= create_panel(PANEL_LOG, bottom_h, max_x / 2, top_h + mid_h, 0);
+    rc |= create_panel(PANEL_STATUS, bottom_h, max_x - max_x / 2, top_h + mid_h, max_x / 2);
+    return rc;
+}
+
+// ncurses setup shared by the live dashboard and replay
+static int screen_init(void) {
+    // readline exports LINES/COLUMNS, which ncurses would prefer over the
+    // terminal's real size, also after a resize
+    unsetenv("LINES");
+    unsetenv("COLUMNS");
     initscr();
     cbreak();
     noecho();
@@ -86,137 +395,287 @@ int dashboard_init(void) {
     init_pair(3, COLOR_RED, COLOR_BLACK);
     init_pair(5, COLOR_CYAN, COLOR_BLACK);
 
-    int max_y, max_x;
-    getmaxyx(stdscr, max_y, max_x);
-
-    process_win = newwin(max_y / 2 - 1, max_x / 2, 0, 0);
-    memory_win  = newwin(max_y / 2 - 1, max_x / 2, 0, max_x / 2);
-    log_win     = newwin(max_y / 2, max_x / 2, max_y / 2, 0);
-    status_win  = newwin(max_y / 2, max_x / 2, max_y / 2, max_x / 2);
+    // getch() refreshes stdscr whenever it is touched, which would blank
+    // the panels; flush it once so it never is
+    wnoutrefresh(stdscr);
 
-    if (!process_win || !memory_win || !log_win || !status_win) {
+    if (create_windows() != 0) {
+        destroy_windows();
         endwin();
         return -1;
     }
-
-    dashboard_active = 1;
-    dashboard_update();
     return 0;
 }
 
-// -------------------- DASHBOARD UPDATE --------------------
-void dashboard_update(void) {
-    if (!dashboard_active) return;
+static void histories_init(int ncpu) {
+    hist_cpus = (ncpu < DASH_MAX_CPUS ? ncpu : DASH_MAX_CPUS) + 1;
+    for (int i = 0; i < hist_cpus; i++) {
+        history_init(&cpu_hist[i], HISTORY_LEN);
+    }
+    history_init(&mem_hist, HISTORY_LEN);
+    for (int i = 0; i < 2; i++) {
+        history_init(&disk_hist[i], HISTORY_LEN);
+        history_init(&net_hist[i], HISTORY_LEN);
+    }
+}
 
-    int max_y, max_x;
-    getmaxyx(stdscr, max_y, max_x);
+static void histories_clear(void) {
+    for (int i = 0; i < hist_cpus; i++) {
+        history_clear(&cpu_hist[i]);
+    }
+    history_clear(&mem_hist);
+    for (int i = 0; i < 2; i++) {
+        history_clear(&disk_hist[i]);
+        history_clear(&net_hist[i]);
+    }
+}
 
-    // ---------- PROCESS PANEL ----------
-    werase(process_win);
-    box(process_win, 0, 0);
-    wattron(process_win, COLOR_PAIR(1));
-    mvwprintw(process_win, 0, 1, " Processes (PID | CPU%% | MEM%%) ");
-    wattroff(process_win, COLOR_PAIR(1));
-
-    mvwprintw(process_win, 1, 1, "PID     CPU%%   MEM%%");
-    mvwprintw(process_win, 2, 1, "-----------------------");
-
-    // NEW: Only PID, CPU%, MEM%
-    FILE *proc = popen("ps -eo pid,pcpu,pmem --sort=-pcpu | head -n 16", "r");
-    if (proc) {
-        char line[256];
-        int y = 3;
-        fgets(line, sizeof(line), proc); // skip header
-        while (fgets(line, sizeof(line), proc) && y < MAX_PROCESS_LINES + 3) {
-            line[strcspn(line, "\n")] = 0;
-            mvwprintw(process_win, y++, 1, "%s", line);
+static void histories_free(void) {
+    for (int i = 0; i < hist_cpus; i++) {
+        history_free(&cpu_hist[i]);
+    }
+    history_free(&mem_hist);
+    for (int i = 0; i < 2; i++) {
+        history_free(&disk_hist[i]);
+        history_free(&net_hist[i]);
+    }
+}
+
+int dashboard_init(void) {
+    if (screen_init() != 0) {
+        if (recording) {
+            timeline_close(&recorder);
+            recording = 0;
         }
-        pclose(proc);
+        return -1;
     }
 
-    wrefresh(process_win);
+    // First sample reports lifetime averages; later ones are per interval
+    proc_sampler_init(&procs);
+    cpu_sampler_init(&cpus);
+    dev_sampler_init(&disks);
+    dev_sampler_init(&nics);
+    // Seeks back from the end of the log once; later ticks read appends
+    log_tail_open(&log_tail, LOG_FILE, DASH_LOG_LINES);
+    log_seen = 0;
+    histories_init(cpus.ncpu);
 
-    // ---------- MEMORY PANEL ----------
-    werase(memory_win);
-    box(memory_win, 0, 0);
-    wattron(memory_win, COLOR_PAIR(1));
-    mvwprintw(memory_win, 0, 1, " Memory Usage ");
-    wattroff(memory_win, COLOR_PAIR(1));
+    dashboard_active = 1;
+    dashboard_update();
+    return 0;
+}
 
-    char mem_info[512];
-    get_memory_info(mem_info, sizeof(mem_info));
-    char *line = strtok(mem_info, "\n");
-    int y = 1;
-    while (line && y < max_y / 2 - 2) {
-        mvwprintw(memory_win, y++, 1, "%s", line);
-        line = strtok(NULL, "\n");
+int dashboard_record(const char *path, int interval_ms) {
+    if (recording) {
+        errno = EBUSY;
+        return -1;
+    }
+    if (timeline_create(&recorder, path, interval_ms) != 0) {
+        return -1;
     }
+    recording = 1;
+    record_errno = 0;
+    return 0;
+}
+
+// -------------------- DASHBOARD UPDATE --------------------
 
-    wrefresh(memory_win);
+// Draw every panel from one sample, then one terminal write for all of
+// them; untouched cells are not sent
+static void draw_sample(const DashSample *s) {
+    static const char *disk_labels[2] = { "Read", "Write" };
+    static const char *net_labels[2] = { "RX", "TX" };
+    double disk_ops[2] = { s->disk[DISK_READ_OPS], s->disk[DISK_WRITE_OPS] };
+    double net_pkts[2] = { s->net[NET_RX_PACKETS], s->net[NET_TX_PACKETS] };
+
+    draw_processes(s);
+    draw_cpus(s);
+    draw_memory(s);
+    draw_io(&panels[PANEL_DISK], disk_labels, s->disk, disk_ops, "IOPS", disk_hist);
+    draw_io(&panels[PANEL_NET], net_labels, s->net, net_pkts, "pkt/s", net_hist);
+    draw_log(s);
+    draw_status(s);
+
+    for (int i = 0; i < PANEL_COUNT; i++) {
+        wnoutrefresh(panels[i].win);
+    }
+    doupdate();
+}
 
-    // ---------- LOG PANEL ----------
-    werase(log_win);
-    box(log_win, 0, 0);
-    wattron(log_win, COLOR_PAIR(1));
-    mvwprintw(log_win, 0, 1, " Command Log ");
-    wattroff(log_win, COLOR_PAIR(1));
+void dashboard_update(void) {
+    if (!dashboard_active || replaying) return;
+
+    collect_sample(&shown);
+    record_history(&shown);
+    if (recording && timeline_append(&recorder, &shown) != 0) {
+        // Keep the dashboard up; the status panel says why recording ended
+        record_errno = errno ? errno : EIO;
+        timeline_close(&recorder);
+        recording = 0;
+    }
+    draw_sample(&shown);
+}
 
-    char log_lines[MAX_LOG_LINES][256];
-    int log_count = 0;
-    read_log_lines(log_lines, MAX_LOG_LINES, &log_count);
+void dashboard_redraw(void) {
+    if (!dashboard_active) return;
 
-    wattron(log_win, COLOR_PAIR(5));
-    for (int i = 0; i < log_count && i < max_y / 2 - 2; i++) {
-        mvwprintw(log_win, i + 1, 1, "%s", log_lines[i]);
+    // Re-lay out for the current size (after KEY_RESIZE) and repaint it all
+    destroy_windows();
+    clear();
+    wnoutrefresh(stdscr);
+    if (create_windows() != 0) {
+        return;
     }
-    wattroff(log_win, COLOR_PAIR(5));
+    clearok(curscr, TRUE);
+    if (replaying) {
+        draw_sample(&shown);
+    } else {
+        dashboard_update();
+    }
+}
 
-    wrefresh(log_win);
+// -------------------- REPLAY --------------------
 
-    // ---------- STATUS PANEL ----------
-    werase(status_win);
-    box(status_win, 0, 0);
-    wattron(status_win, COLOR_PAIR(1));
-    mvwprintw(status_win, 0, 1, " System Status ");
-    wattroff(status_win, COLOR_PAIR(1));
+static long elapsed_ms(const struct timespec *since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1000 + (now.tv_nsec - since->tv_nsec) / 1000000;
+}
 
-    // Uptime: available on Linux via sysinfo; on other systems, skip
-#ifdef __linux__
-    struct sysinfo info;
-    if (sysinfo(&info) == 0) {
-        long days = info.uptime / 86400;
-        long hours = (info.uptime % 86400) / 3600;
-        long mins = (info.uptime % 3600) / 60;
-        mvwprintw(status_win, 1, 1, "Uptime: %ldd %ldh %ldm", days, hours, mins);
+// Show recorded sample `index`. Stepping forward decodes one frame; a seek
+// also replays the frames before it into the sparkline histories.
+static void replay_show(long index) {
+    if (index < 0) index = 0;
+    if (index >= replay.count) index = replay.count - 1;
+
+    if (index != replay.pos + 1 || replay.pos < 0) {
+        histories_clear();
+        long start = index - HISTORY_LEN + 1;
+        for (long i = start > 0 ? start : 0; i < index; i++) {
+            if (timeline_read(&replay, i, &shown) == 0) {
+                record_history(&shown);
+            }
+        }
     }
-#endif
+    if (timeline_read(&replay, index, &shown) == 0) {
+        record_history(&shown);
+    }
+    draw_sample(&shown);
+}
 
-    time_t now = time(NULL);
-    struct tm *tm_info = localtime(&now);
-    char time_str[64];
-    strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", tm_info);
-    mvwprintw(status_win, 2, 1, "Time: %s", time_str);
+// Recorded time between the sample on screen and the next, scaled by speed
+static long replay_gap_ms(void) {
+    int64_t gap = replay.time_ms[replay.pos + 1] - replay.time_ms[replay.pos];
+    if (gap < 0) gap = 0;
+    if (gap > REPLAY_MAX_GAP_MS * replay_speed) gap = (int64_t)(REPLAY_MAX_GAP_MS * replay_speed);
+    return (long)(gap / replay_speed);
+}
 
-    double load[3];
-    if (getloadavg(load, 3) == 3) {
-        mvwprintw(status_win, 3, 1, "Load: %.2f %.2f %.2f", load[0], load[1], load[2]);
+int dashboard_replay(const char *path, double speed) {
+    if (timeline_open(&replay, path) != 0) {
+        return -1;
+    }
+    DashSample first;
+    if (timeline_read(&replay, 0, &first) != 0 || screen_init() != 0) {
+        timeline_close_reader(&replay);
+        errno = EINVAL;
+        return -1;
+    }
+    histories_init(first.ncpu);
+    replaying = 1;
+    dashboard_active = 1;
+    replay_paused = 0;
+    replay_speed = speed < REPLAY_MIN_SPEED ? REPLAY_MIN_SPEED
+                 : speed > REPLAY_MAX_SPEED ? REPLAY_MAX_SPEED : speed;
+    replay_show(0);
+
+    struct timespec shown_at;
+    clock_gettime(CLOCK_MONOTONIC, &shown_at);
+    for (;;) {
+        int wait = -1;
+        if (!replay_paused && replay.pos + 1 < replay.count) {
+            long remaining = replay_gap_ms() - elapsed_ms(&shown_at);
+            if (remaining <= 0) {
+                replay_show(replay.pos + 1);
+                clock_gettime(CLOCK_MONOTONIC, &shown_at);
+                continue;
+            }
+            wait = (int)remaining;
+        } else if (!replay_paused) {
+            replay_paused = 1;                  // reached the end
+            draw_sample(&shown);
+        }
+        timeout(wait);
+        int ch = getch();
+        if (ch == ERR) continue;
+
+        long pos = replay.pos;
+        int64_t now_ms = replay.time_ms[pos >= 0 ? pos : 0];
+        switch (ch) {
+        case 'q': case 'Q':
+            goto done;
+        case ' ':
+            replay_paused = !replay_paused;
+            if (!replay_paused && pos + 1 >= replay.count) {
+                replay_show(0);                 // play again from the start
+            }
+            break;
+        case ',': case '<':
+            replay_paused = 1;
+            replay_show(pos - 1);
+            break;
+        case '.': case '>':
+            replay_paused = 1;
+            replay_show(pos + 1);
+            break;
+        case KEY_LEFT:  replay_show(timeline_find(&replay, now_ms - 60 * 1000)); break;
+        case KEY_RIGHT: replay_show(timeline_find(&replay, now_ms + 60 * 1000)); break;
+        case KEY_PPAGE: replay_show(timeline_find(&replay, now_ms - 600 * 1000)); break;
+        case KEY_NPAGE: replay_show(timeline_find(&replay, now_ms + 600 * 1000)); break;
+        case KEY_HOME: case 'g': replay_show(0); break;
+        case KEY_END: case 'G':  replay_show(replay.count - 1); break;
+        case '+': case '=':
+            if (replay_speed < REPLAY_MAX_SPEED) replay_speed *= 2;
+            break;
+        case '-': case '_':
+            if (replay_speed > REPLAY_MIN_SPEED) replay_speed /= 2;
+            break;
+        case 'r': case 'R': case KEY_RESIZE:
+            dashboard_redraw();
+            break;
+        default:
+            continue;
+        }
+        draw_sample(&shown);                    // status line: position, speed
+        clock_gettime(CLOCK_MONOTONIC, &shown_at);
     }
 
-    mvwprintw(status_win, 5, 1, "Press 'q' to quit dashboard");
-    mvwprintw(status_win, 6, 1, "Press 'r' to refresh");
-
-    wrefresh(status_win);
-    refresh();
+done:
+    dashboard_cleanup();
+    return 0;
 }
 
 // -------------------- CLEANUP --------------------
 void dashboard_cleanup(void) {
     if (!dashboard_active) return;
 
-    if (process_win) delwin(process_win);
-    if (memory_win) delwin(memory_win);
-    if (log_win) delwin(log_win);
-    if (status_win) delwin(status_win);
+    destroy_windows();
+
+    if (replaying) {
+        timeline_close_reader(&replay);
+        replaying = 0;
+    } else {
+        proc_sampler_free(&procs);
+        cpu_sampler_free(&cpus);
+        dev_sampler_free(&disks);
+        dev_sampler_free(&nics);
+        log_tail_close(&log_tail);
+    }
+    if (recording) {
+        timeline_close(&recorder);
+        recording = 0;
+    }
+    histories_free();
 
     endwin();
     dashboard_active = 0;
@@ -5,12 +5,26 @@
 // Returns 0 on success, -1 on error
 int dashboard_init(void);
 
+// Record every sample the live dashboard takes to a timeline file (see
+// timeline.h). Call before dashboard_init() so the first sample is kept.
+// Returns 0, or -1 with errno set.
+int dashboard_record(const char *path, int interval_ms);
+
+// Replay a recording with the dashboard's panels until the user quits
+// (space pauses, arrows seek, +/- change speed). Returns 0, or -1 with
+// errno set if the file is not a usable recording.
+int dashboard_replay(const char *path, double speed);
+
 // Cleanup and close the dashboard
 void dashboard_cleanup(void);
 
 // Update the dashboard display (call this periodically)
 void dashboard_update(void);
 
+// Lay the panels out again for the current terminal size and repaint
+// everything (after KEY_RESIZE, or to recover from a garbled screen)
+void dashboard_redraw(void);
+
 // Check if dashboard is active
 int dashboard_is_active(void);
 
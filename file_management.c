@@ -3,8 +3,9 @@
 #include <dirent.h>
 #include <sys/stat.h>
 #include <unistd.h>
-#include "auth.h"
 #include "logger.h"
+#include "cli_output.h"
+#include "tasks.h"
 
 // list <dir>
 void cmd_list(int argc, char *argv[]) {
@@ -16,7 +17,7 @@ void cmd_list(int argc, char *argv[]) {
 
     d = opendir(target);
     if (d == NULL) {
-        perror("opendir");
+        cli_perror("opendir");
         return;
     }
 
@@ -25,7 +26,7 @@ void cmd_list(int argc, char *argv[]) {
         snprintf(path, sizeof(path), "%s/%s", target, entry->d_name);
 
         if (stat(path, &fileStat) == 0) {
-            printf("%c%c%c%c%c%c%c%c%c ",
+            cli_printf("%c%c%c%c%c%c%c%c%c ",
                    (fileStat.st_mode & S_IRUSR) ? 'r' : '-',
                    (fileStat.st_mode & S_IWUSR) ? 'w' : '-',
                    (fileStat.st_mode & S_IXUSR) ? 'x' : '-',
@@ -35,7 +36,7 @@ void cmd_list(int argc, char *argv[]) {
                    (fileStat.st_mode & S_IROTH) ? 'r' : '-',
                    (fileStat.st_mode & S_IWOTH) ? 'w' : '-',
                    (fileStat.st_mode & S_IXOTH) ? 'x' : '-');
-            printf("%s\n", entry->d_name);
+            cli_printf("%s\n", entry->d_name);
         }
     }
 
@@ -45,83 +46,87 @@ void cmd_list(int argc, char *argv[]) {
 // copy <src> <dst>
 void cmd_copy(int argc, char *argv[]) {
     if (argc < 3) {
-        printf("Usage: copy <src> <dst>\n");
+        cli_printf("Usage: copy <src> <dst>\n");
         return;
     }
 
     FILE *fsrc = fopen(argv[1], "rb");
     if (!fsrc) {
-        perror("fopen src");
+        cli_perror("fopen src");
         return;
     }
 
     FILE *fdst = fopen(argv[2], "wb");
     if (!fdst) {
-        perror("fopen dst");
+        cli_perror("fopen dst");
         fclose(fsrc);
         return;
     }
 
+    struct stat st;
+    long long total = (fstat(fileno(fsrc), &st) == 0) ? (long long)st.st_size : 0;
+    long long done = 0;
+
     char buffer[1024];
     size_t bytes;
     while ((bytes = fread(buffer, 1, sizeof(buffer), fsrc)) > 0) {
+        if (task_cancelled()) {
+            cli_printf("Copy cancelled\n");
+            fclose(fsrc);
+            fclose(fdst);
+            return;
+        }
         fwrite(buffer, 1, bytes, fdst);
+        task_progress(done += bytes, total);
     }
 
     fclose(fsrc);
     fclose(fdst);
 
-    printf("Copied %s -> %s\n", argv[1], argv[2]);
+    cli_printf("Copied %s -> %s\n", argv[1], argv[2]);
 }
 
 // create file
 void cmd_create(int argc, char *argv[]) {
     if (argc < 2) {
-        printf("Usage: create <filename>\n");
+        cli_printf("Usage: create <filename>\n");
         return;
     }
 
     FILE *f = fopen(argv[1], "w");  // Open for writing (creates or truncates)
     if (!f) {
-        perror("fopen");
+        cli_perror("fopen");
         return;
     }
     fclose(f);
-    printf("Created file: %s\n", argv[1]);
+    cli_printf("Created file: %s\n", argv[1]);
 }
 
 // delete <file>
 void cmd_delete(int argc, char *argv[]) {
     if (argc < 2) {
-        printf("Usage: delete <file>\n");
-        return;
-    }
-
-    // 🔒 check permission
-    if (!is_admin()) {
-        printf("🚫  Permission denied: only admin can delete files.\n");
-        log_command("UNAUTHORIZED delete attempt");
+        cli_printf("Usage: delete <file>\n");
         return;
     }
 
     if (unlink(argv[1]) == 0) {
-        printf("File deleted: %s\n", argv[1]);
+        cli_printf("File deleted: %s\n", argv[1]);
         log_command("delete file");
     } else {
-        perror("unlink failed");
+        cli_perror("unlink failed");
     }
 }
 
 // write <file> <content>
 void cmd_write(int argc, char *argv[]) {
     if (argc < 3) {
-        printf("Usage: write <file> <content>\n");
+        cli_printf("Usage: write <file> <content>\n");
         return;
     }
 
     FILE *f = fopen(argv[1], "w");
     if (!f) {
-        perror("fopen");
+        cli_perror("fopen");
         return;
     }
 
@@ -134,30 +139,30 @@ void cmd_write(int argc, char *argv[]) {
     fputc('\n', f);
 
     fclose(f);
-    printf("Wrote to file: %s\n", argv[1]);
+    cli_printf("Wrote to file: %s\n", argv[1]);
     log_command("write file");
 }
 
 // show <file>
 void cmd_show(int argc, char *argv[]) {
     if (argc < 2) {
-        printf("Usage: show <file>\n");
+        cli_printf("Usage: show <file>\n");
         return;
     }
 
     FILE *f = fopen(argv[1], "r");
     if (!f) {
-        perror("fopen");
+        cli_perror("fopen");
         return;
     }
 
     char buffer[512];
     while (fgets(buffer, sizeof(buffer), f)) {
-        fputs(buffer, stdout);
+        fputs(buffer, cli_out());
     }
 
     if (ferror(f)) {
-        perror("read error");
+        cli_perror("read error");
     }
 
     fclose(f);
@@ -0,0 +1,226 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/wait.h>
+#include "jobs.h"
+#include "tasks.h"
+#include "metrics.h"
+
+// ---------------------------------------------------------------------------
+// Integer-keyed hash index (open addressing, linear probing). Deletion
+// shifts later entries back instead of leaving tombstones, so lookups stay
+// short no matter how many jobs come and go.
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    int   *keys;      // 0 = empty slot (job IDs and PIDs are never 0)
+    Job  **values;
+    size_t capacity;  // power of two
+    size_t count;
+} JobIndex;
+
+static size_t index_slot(const JobIndex *ix, int key) {
+    // Fibonacci hashing spreads sequential IDs/PIDs across the table
+    return (size_t)(((unsigned int)key * 2654435769u) & (ix->capacity - 1));
+}
+
+static int index_grow(JobIndex *ix);
+
+static int index_put(JobIndex *ix, int key, Job *value) {
+    if ((ix->count + 1) * 2 > ix->capacity && index_grow(ix) != 0) {
+        return -1;
+    }
+    size_t i = index_slot(ix, key);
+    while (ix->keys[i] != 0 && ix->keys[i] != key) {
+        i = (i + 1) & (ix->capacity - 1);
+    }
+    if (ix->keys[i] == 0) {
+        ix->count++;
+    }
+    ix->keys[i] = key;
+    ix->values[i] = value;
+    return 0;
+}
+
+static int index_grow(JobIndex *ix) {
+    size_t new_cap = ix->capacity ? ix->capacity * 2 : 64;
+    int *keys = calloc(new_cap, sizeof(int));
+    Job **values = calloc(new_cap, sizeof(Job *));
+    if (!keys || !values) {
+        free(keys);
+        free(values);
+        return -1;
+    }
+
+    int *old_keys = ix->keys;
+    Job **old_values = ix->values;
+    size_t old_cap = ix->capacity;
+
+    ix->keys = keys;
+    ix->values = values;
+    ix->capacity = new_cap;
+    ix->count = 0;
+    for (size_t i = 0; i < old_cap; i++) {
+        if (old_keys[i] != 0) {
+            index_put(ix, old_keys[i], old_values[i]);
+        }
+    }
+    free(old_keys);
+    free(old_values);
+    return 0;
+}
+
+static Job *index_get(const JobIndex *ix, int key) {
+    if (ix->capacity == 0) return NULL;
+    size_t i = index_slot(ix, key);
+    while (ix->keys[i] != 0) {
+        if (ix->keys[i] == key) {
+            return ix->values[i];
+        }
+        i = (i + 1) & (ix->capacity - 1);
+    }
+    return NULL;
+}
+
+static void index_del(JobIndex *ix, int key) {
+    if (ix->capacity == 0) return;
+    size_t mask = ix->capacity - 1;
+    size_t i = index_slot(ix, key);
+    while (ix->keys[i] != key) {
+        if (ix->keys[i] == 0) return;
+        i = (i + 1) & mask;
+    }
+
+    // Backward-shift deletion: pull later members of the probe run into the hole
+    size_t hole = i;
+    for (size_t j = (hole + 1) & mask; ix->keys[j] != 0; j = (j + 1) & mask) {
+        size_t home = index_slot(ix, ix->keys[j]);
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            ix->keys[hole] = ix->keys[j];
+            ix->values[hole] = ix->values[j];
+            hole = j;
+        }
+    }
+    ix->keys[hole] = 0;
+    ix->values[hole] = NULL;
+    ix->count--;
+}
+
+// ---------------------------------------------------------------------------
+// Job table
+// ---------------------------------------------------------------------------
+
+static JobIndex by_id;
+static JobIndex by_pid;
+static Job *head = NULL, *tail = NULL;
+static int next_job_id = 1;
+static int tracked = 0;
+
+Job *job_add(const pid_t pids[], int npids, const char *cmd, const char *limits) {
+    Job *job = calloc(1, sizeof(Job));
+    if (!job) {
+        return NULL;
+    }
+
+    job->id = next_job_id++;
+    job->pid = npids > 0 ? pids[0] : 0;
+    memcpy(job->pids, pids, npids * sizeof(pid_t));
+    job->npids = npids;
+    strncpy(job->cmd, cmd, sizeof(job->cmd) - 1);
+    strncpy(job->limits, limits ? limits : "", sizeof(job->limits) - 1);
+    job->running = 1;
+
+    if (index_put(&by_id, job->id, job) != 0) {
+        free(job);
+        return NULL;
+    }
+    for (int i = 0; i < npids; i++) {
+        if (index_put(&by_pid, pids[i], job) != 0) {
+            for (int k = 0; k < i; k++) index_del(&by_pid, pids[k]);
+            index_del(&by_id, job->id);
+            free(job);
+            return NULL;
+        }
+    }
+
+    job->prev = tail;
+    if (tail) tail->next = job; else head = job;
+    tail = job;
+    tracked++;
+    metrics_job_added(npids == 0);   // tasks have no PIDs
+    return job;
+}
+
+Job *job_add_task(struct Task *task, const char *cmd) {
+    pid_t none = 0;
+    Job *job = job_add(&none, 0, cmd, "");
+    if (job) {
+        job->task = task;
+    }
+    return job;
+}
+
+Job *job_find_by_id(int id) {
+    return id > 0 ? index_get(&by_id, id) : NULL;
+}
+
+Job *job_find_by_pid(pid_t pid) {
+    return pid > 0 ? index_get(&by_pid, pid) : NULL;
+}
+
+int job_poll(Job *job) {
+    if (job->task) {
+        job->running = !task_finished(job->task);
+        return job->running;
+    }
+
+    int running = 0;
+    for (int i = 0; i < job->npids; i++) {
+        unsigned int bit = 1u << i;
+        if (job->reaped & bit) continue;
+
+        pid_t r = waitpid(job->pids[i], NULL, WNOHANG);
+        if (r == 0) {
+            running++;
+        } else if (r == job->pids[i] || (r < 0 && errno == ECHILD)) {
+            job->reaped |= bit;   // exited, or already reaped elsewhere
+        }
+    }
+    job->running = running > 0;
+    return running;
+}
+
+void job_remove(Job *job) {
+    if (!job) return;
+
+    index_del(&by_id, job->id);
+    for (int i = 0; i < job->npids; i++) {
+        index_del(&by_pid, job->pids[i]);
+    }
+
+    if (job->prev) job->prev->next = job->next; else head = job->next;
+    if (job->next) job->next->prev = job->prev; else tail = job->prev;
+    tracked--;
+    metrics_job_removed();
+    free(job);
+}
+
+Job *job_first(void) {
+    return head;
+}
+
+int job_count(void) {
+    return tracked;
+}
+
+int job_parse_id(const char *arg) {
+    if (!arg) return -1;
+    if (*arg == '%') arg++;
+    char *end;
+    long id = strtol(arg, &end, 10);
+    if (end == arg || *end != '\0' || id <= 0 || id > 0x7fffffff) {
+        return -1;
+    }
+    return (int)id;
+}
@@ -0,0 +1,52 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <sys/types.h>
+#include "pipeline.h"
+
+struct Task;
+
+// A background job: a launched process/pipeline, or a built-in running on
+// the worker pool (task != NULL, no PIDs). Job IDs are handed out monotonically starting at 1
+// and are never reused, so an ID keeps naming the same job until it ends.
+typedef struct Job {
+    int   id;
+    pid_t pid;                          // first stage; leads the job's process group
+    pid_t pids[MAX_PIPELINE_STAGES];    // every stage of a pipeline job
+    int   npids;
+    unsigned int reaped;                // bit i set once pids[i] has been waited for
+    char  cmd[256];
+    char  limits[128];                  // resource controls summary shown by pslist
+    int   running;
+    struct Task *task;                  // built-in task, NULL for processes
+
+    struct Job *prev, *next;            // job-ID order, for listing
+} Job;
+
+// Register a job for the given stage PIDs. Returns NULL on allocation failure.
+Job *job_add(const pid_t pids[], int npids, const char *cmd, const char *limits);
+
+// Register a built-in task (see tasks.h)
+Job *job_add_task(struct Task *task, const char *cmd);
+
+// O(1) lookups; NULL if there is no such job
+Job *job_find_by_id(int id);
+Job *job_find_by_pid(pid_t pid);     // matches any stage of a pipeline
+
+// Reap finished stages without blocking; returns the number still running
+// (for a task: 1 while it has not finished, else 0)
+int job_poll(Job *job);
+
+// Forget a job and free it
+void job_remove(Job *job);
+
+// Iterate jobs in ID order: for (Job *j = job_first(); j; j = j->next)
+Job *job_first(void);
+
+// Number of tracked jobs
+int job_count(void);
+
+// Parse "3" or "%3" into a job ID; returns -1 if malformed
+int job_parse_id(const char *arg);
+
+#endif
@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "launcher.h"
+#include "signals.h"
+#include "cli_output.h"
+#include "path_cache.h"
+#include "profiler.h"
+
+extern char **environ;
+
+// Signals SecureSysCLI installs handlers for; children get SIG_DFL back
+static void default_signal_set(sigset_t *set) {
+    sigemptyset(set);
+    sigaddset(set, SIGINT);
+    sigaddset(set, SIGTERM);
+}
+
+void launch_options_init(LaunchOptions *opts) {
+    opts->detach = 0;
+    opts->in_fd = -1;
+    opts->out_fd = -1;
+    opts->pgid = -1;
+    opts->limits = NULL;
+}
+
+// Fast path: posix_spawn, which glibc implements with clone(CLONE_VM|CLONE_VFORK)
+static pid_t spawn_fast(const char *path, char *const argv[], const LaunchOptions *opts) {
+    posix_spawnattr_t attr;
+    posix_spawn_file_actions_t actions;
+    sigset_t defaults, empty;
+    short flags = POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK;
+
+    posix_spawnattr_init(&attr);
+    posix_spawn_file_actions_init(&actions);
+
+    default_signal_set(&defaults);
+    sigemptyset(&empty);
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+    posix_spawnattr_setsigmask(&attr, &empty);
+
+#ifdef POSIX_SPAWN_USEVFORK
+    flags |= POSIX_SPAWN_USEVFORK;
+#endif
+    if (opts->pgid >= 0) {
+        flags |= POSIX_SPAWN_SETPGROUP;
+        posix_spawnattr_setpgroup(&attr, opts->pgid);
+    } else if (opts->detach) {
+        flags |= POSIX_SPAWN_SETSID;
+    }
+
+    // Pipe ends are close-on-exec; dup2 clears the flag on the target
+    if (opts->in_fd >= 0) {
+        posix_spawn_file_actions_adddup2(&actions, opts->in_fd, STDIN_FILENO);
+    } else if (opts->detach) {
+        posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    }
+    if (opts->out_fd >= 0) {
+        posix_spawn_file_actions_adddup2(&actions, opts->out_fd, STDOUT_FILENO);
+    } else if (opts->detach) {
+        posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    }
+    if (opts->detach) {
+        posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+    }
+    posix_spawnattr_setflags(&attr, flags);
+
+    pid_t pid;
+    int err = posix_spawn(&pid, path, &actions, &attr, argv, environ);
+
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+
+    if (err != 0) {
+        errno = err;
+        return -1;
+    }
+    return pid;
+}
+
+// Slow path: fork() so resource controls can be applied before exec.
+// Child-side failures are reported back through a close-on-exec pipe.
+static pid_t spawn_fork(const char *path, char *const argv[], const LaunchOptions *opts) {
+    int report[2];
+    if (pipe2(report, O_CLOEXEC) != 0) {
+        return -1;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        int saved = errno;
+        close(report[0]);
+        close(report[1]);
+        errno = saved;
+        return -1;
+    }
+
+    if (pid == 0) {
+        close(report[0]);
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        // As spawn_fast() does: a worker thread's mask blocks SIGINT and
+        // SIGTERM, which would leave the program deaf to Ctrl+C and killproc
+        sigset_t empty;
+        sigemptyset(&empty);
+        sigprocmask(SIG_SETMASK, &empty, NULL);
+        if (opts->pgid >= 0) {
+            setpgid(0, opts->pgid);
+        } else if (opts->detach) {
+            setsid();
+        }
+        if (opts->in_fd >= 0) {
+            dup2(opts->in_fd, STDIN_FILENO);
+        }
+        if (opts->out_fd >= 0) {
+            dup2(opts->out_fd, STDOUT_FILENO);
+        }
+        if (opts->detach) {
+            int null_fd = open("/dev/null", O_RDWR);
+            if (null_fd >= 0) {
+                if (opts->in_fd < 0) dup2(null_fd, STDIN_FILENO);
+                if (opts->out_fd < 0) dup2(null_fd, STDOUT_FILENO);
+                dup2(null_fd, STDERR_FILENO);
+                if (null_fd > STDERR_FILENO) {
+                    close(null_fd);
+                }
+            }
+        }
+        if (resource_limits_apply(opts->limits) == 0) {
+            execv(path, argv);
+        }
+        int err = errno;
+        ssize_t w = write(report[1], &err, sizeof(err));
+        (void)w;
+        _exit(127);
+    }
+
+    close(report[1]);
+    int child_err = 0;
+    ssize_t n;
+    do {
+        n = read(report[0], &child_err, sizeof(child_err));
+    } while (n < 0 && errno == EINTR);
+    close(report[0]);
+
+    if (n == sizeof(child_err)) {
+        waitpid(pid, NULL, 0);
+        errno = child_err;
+        return -1;
+    }
+    return pid;
+}
+
+pid_t launch_program(char *const argv[], const LaunchOptions *opts) {
+    LaunchOptions defaults;
+    if (!opts) {
+        launch_options_init(&defaults);
+        opts = &defaults;
+    }
+
+    // argv[0] is looked up on PATH once; after that the remembered path is
+    // exec'd directly instead of trying every PATH directory in turn
+    char path[PATH_MAX];
+    int cached = path_cache_lookup(argv[0], path, sizeof(path));
+    pid_t pid = -1;
+    for (int attempt = 0; cached >= 0 && attempt < 2; attempt++) {
+        if (opts->limits && resource_limits_any(opts->limits)) {
+            pid = spawn_fork(path, argv, opts);
+        } else {
+            pid = spawn_fast(path, argv, opts);
+        }
+        if (pid >= 0 || errno != ENOENT || cached != 1) {
+            break;
+        }
+        // The remembered program is gone: forget it and search PATH again
+        path_cache_forget(argv[0]);
+        cached = path_cache_lookup(argv[0], path, sizeof(path));
+    }
+
+    if (pid < 0) {
+        fprintf(cli_err(), "%s: %s\n", argv[0], strerror(errno));
+        cli_set_status(127);
+    }
+    return pid;
+}
+
+int launch_wait_foreground(pid_t pid) {
+    // Set global variable so signal handler can forward SIGINT. Only the
+    // main thread does: a worker's children (parallel script loops) share
+    // our process group and get Ctrl+C from the terminal directly.
+    int forward = gettid() == getpid();
+    if (forward) {
+        foreground_pid = pid;
+    }
+
+    int status;
+    struct rusage ru;
+    pid_t r;
+    do {
+        r = wait4(pid, &status, 0, &ru);
+    } while (r < 0 && errno == EINTR);
+
+    // Clear foreground PID after process completes
+    if (forward) {
+        foreground_pid = 0;
+    }
+    if (r < 0) {
+        return -1;
+    }
+    profile_child_reaped(&ru);
+
+    // Command status as a shell would report it
+    if (WIFEXITED(status)) {
+        cli_set_status(WEXITSTATUS(status));
+    } else if (WIFSIGNALED(status)) {
+        cli_set_status(128 + WTERMSIG(status));
+    }
+    return status;
+}
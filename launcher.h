@@ -0,0 +1,32 @@
+#ifndef LAUNCHER_H
+#define LAUNCHER_H
+
+#include <sys/types.h>
+#include "resource_limits.h"
+
+// How a program should be started by launch_program().
+// Always initialise with launch_options_init() before filling in fields.
+typedef struct {
+    int detach;                     // stdio not given below goes to /dev/null;
+                                    // new session unless pgid is set
+    int in_fd;                      // becomes stdin, -1 = inherit
+    int out_fd;                     // becomes stdout, -1 = inherit
+    pid_t pgid;                     // -1 = keep ours, 0 = new group, >0 = join
+    const ResourceLimits *limits;   // NULL = no resource controls
+} LaunchOptions;
+
+void launch_options_init(LaunchOptions *opts);
+
+// Start argv[0] (searched on PATH through the path cache, see path_cache.h)
+// with default signal dispositions.
+// Uses posix_spawn (vfork semantics) unless resource controls are requested,
+// which need code to run in the child and fall back to fork().
+// Returns the child's PID, or -1 after printing an error.
+pid_t launch_program(char *const argv[], const LaunchOptions *opts);
+
+// Wait for a foreground child, forwarding Ctrl+C to it while it runs.
+// Returns the raw wait status, or -1 if waitpid failed. The exit code
+// (128 + signal if killed) becomes the command status, see cli_set_status().
+int launch_wait_foreground(pid_t pid);
+
+#endif
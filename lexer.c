@@ -0,0 +1,107 @@
+#include <string.h>
+#include "lexer.h"
+
+static int is_blank(char c) {
+    return c == ' ' || c == '\t';
+}
+
+static inline size_t step(const char *s, LexQuote *q) {
+    if (*q == LEX_SINGLE) {
+        if (*s == '\'') {
+            *q = LEX_PLAIN;
+        }
+        return 1;
+    }
+    if (s[0] == '\\' && s[1] && (*q == LEX_PLAIN || strchr("\"\\$", s[1]))) {
+        return 2;
+    }
+    if (*s == '\'' && *q == LEX_PLAIN) {
+        *q = LEX_SINGLE;
+    } else if (*s == '"') {
+        *q = (*q == LEX_DOUBLE) ? LEX_PLAIN : LEX_DOUBLE;
+    }
+    return 1;
+}
+
+size_t lex_step(const char *s, LexQuote *q) {
+    return step(s, q);
+}
+
+// Characters that end a run of ordinary text: the NUL, blanks, and those
+// that change the quoting. Everything else is copied as it is.
+static const unsigned char stops[256] = {
+    ['\0'] = 1, [' '] = 1, ['\t'] = 1, ['\\'] = 1, ['\''] = 1, ['"'] = 1
+};
+
+// The one scanner behind the public functions. Writes the unquoted words to
+// `out` (may be `s` itself: output never overtakes input) and their starts
+// to `argv`, either of which may be NULL to only count. Without `split`
+// blanks are kept and the whole input is one word.
+static int lex_scan(const char *s, char *out, char **argv, int split) {
+    LexQuote q = LEX_PLAIN;
+    int n = 0, in_word = 0;
+    while (*s) {
+        if (split && q == LEX_PLAIN && is_blank(*s)) {
+            if (in_word && out) {
+                *out++ = '\0';
+            }
+            in_word = 0;
+            s++;
+            continue;
+        }
+        if (!in_word) {
+            if (argv) {
+                argv[n] = out;
+            }
+            n++;
+            in_word = 1;
+        }
+        if (!stops[(unsigned char)*s]) {
+            const char *run = s;
+            while (!stops[(unsigned char)*s]) s++;
+            if (out) {
+                if (out != run) {
+                    memmove(out, run, (size_t)(s - run));
+                }
+                out += s - run;
+            }
+            continue;
+        }
+        LexQuote before = q;
+        size_t len = step(s, &q);
+        if (out && (len == 2 || q == before)) {
+            *out++ = s[len - 1];
+        }
+        s += len;
+    }
+    if (q != LEX_PLAIN) {
+        return -1;
+    }
+    if (out) {
+        *out = '\0';
+    }
+    if (argv) {
+        argv[n] = NULL;
+    }
+    return n;
+}
+
+int lex_count(const char *line) {
+    return lex_scan(line, NULL, NULL, 1);
+}
+
+int lex_split(char *line, char **argv) {
+    return lex_scan(line, line, argv, 1);
+}
+
+int lex_unquote(char *s) {
+    return lex_scan(s, s, NULL, 0) < 0 ? -1 : 0;
+}
+
+const char *lex_word_end(const char *s) {
+    LexQuote q = LEX_PLAIN;
+    while (*s && !(q == LEX_PLAIN && is_blank(*s))) {
+        s += step(s, &q);
+    }
+    return s;
+}
@@ -0,0 +1,41 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <stddef.h>
+
+// Splits command lines into words, for the prompt, `project -c` and
+// scripts alike. Words are separated by spaces and tabs; there is no limit
+// on their number or length.
+//
+//   'text'     literal, nothing inside is special
+//   "text"     blanks and ' are literal; \" \\ and \$ are escapes
+//   \c         outside quotes: c literally (a blank, quote or backslash)
+//
+// A word may mix the three ("a b"'c'\ d is one word), and "" or '' is an
+// empty word. Dollar signs are left alone: scripts expand variables
+// before the line is split (see script.c).
+
+typedef enum { LEX_PLAIN, LEX_SINGLE, LEX_DOUBLE } LexQuote;
+
+// Number of words in `line`, or -1 if a quote is never closed
+int lex_count(const char *line);
+
+// Split `line` in place (unquoting only ever shortens it), storing the words
+// in argv, which needs lex_count() + 1 entries and ends up NULL-terminated.
+// Returns the number of words, or -1 if a quote is never closed.
+int lex_split(char *line, char **argv);
+
+// Remove the quotes and escapes from `s` in place without splitting it at
+// blanks. Returns -1 if a quote is never closed.
+int lex_unquote(char *s);
+
+// End of the word that starts at `s`: the first blank outside quotes, or
+// the terminating NUL
+const char *lex_word_end(const char *s);
+
+// Step over the character at `s` in quote context *q. Returns 2 for an
+// escape (the backslash and the escaped character), else 1, and updates *q
+// at a quote mark. Lets callers walk a raw line the way the lexer reads it.
+size_t lex_step(const char *s, LexQuote *q);
+
+#endif
@@ -0,0 +1,361 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include "log_rotate.h"
+#include "config.h"
+#include "worker_pool.h"
+
+#define SEGMENT_PATH_MAX 1024
+
+// Retention may run from the log writer and from several compression jobs
+static pthread_mutex_t retention_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int log_rotate_due(uint64_t size, time_t opened) {
+    if (size == 0) {
+        return 0;
+    }
+    if (log_max_size_kb > 0 && size >= (uint64_t)log_max_size_kb * 1024) {
+        return 1;
+    }
+    if (log_max_age_hours > 0 && time(NULL) - opened >= (time_t)log_max_age_hours * 3600) {
+        return 1;
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Segment listing
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    char   name[SEGMENT_PATH_MAX];
+    char   stem[SEGMENT_PATH_MAX];   // name without ".gz", orders segments by age
+    time_t mtime;
+} Segment;
+
+static void split_path(const char *path, char *dir, size_t dir_size, const char **base) {
+    const char *slash = strrchr(path, '/');
+    if (slash) {
+        snprintf(dir, dir_size, "%.*s", (int)(slash - path), path);
+        *base = slash + 1;
+    } else {
+        snprintf(dir, dir_size, ".");
+        *base = path;
+    }
+}
+
+// Timestamps are fixed width, but the same-second suffix is not: strverscmp()
+// compares digit runs as numbers, so "-10" sorts after "-9"
+static int compare_segments(const void *a, const void *b) {
+    const Segment *x = a, *y = b;
+    int c = strverscmp(x->stem, y->stem);
+    return c ? c : strcmp(x->name, y->name);   // plain before its .gz
+}
+
+// Rotated segments of `path`, oldest first. Caller frees *out.
+static int list_segments(const char *path, Segment **out) {
+    char dir[SEGMENT_PATH_MAX - 256];
+    const char *base;
+    split_path(path, dir, sizeof(dir), &base);
+    size_t base_len = strlen(base);
+
+    *out = NULL;
+    DIR *d = opendir(dir);
+    if (!d) {
+        return 0;
+    }
+
+    Segment *segs = NULL;
+    int count = 0, capacity = 0;
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        const char *name = ent->d_name;
+        size_t len = strlen(name);
+        if (strncmp(name, base, base_len) != 0 || name[base_len] != '-' ||
+            (len > 4 && strcmp(name + len - 4, ".tmp") == 0)) {
+            continue;
+        }
+
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            Segment *grown = realloc(segs, capacity * sizeof(Segment));
+            if (!grown) break;
+            segs = grown;
+        }
+        Segment *s = &segs[count];
+        snprintf(s->name, sizeof(s->name), "%s/%s", dir, name);
+        snprintf(s->stem, sizeof(s->stem), "%s", name);
+        size_t stem_len = strlen(s->stem);
+        if (stem_len > 3 && strcmp(s->stem + stem_len - 3, ".gz") == 0) {
+            s->stem[stem_len - 3] = '\0';
+        }
+        struct stat st;
+        s->mtime = (stat(s->name, &st) == 0) ? st.st_mtime : 0;
+        count++;
+    }
+    closedir(d);
+
+    qsort(segs, count, sizeof(Segment), compare_segments);
+
+    // While a segment is being compressed both forms exist briefly; the
+    // .gz is complete once it has its final name, so keep just that one
+    int kept = 0;
+    for (int i = 0; i < count; i++) {
+        if (i + 1 < count && strcmp(segs[i].stem, segs[i + 1].stem) == 0) {
+            continue;
+        }
+        segs[kept++] = segs[i];
+    }
+
+    *out = segs;
+    return kept;
+}
+
+static int is_compressed(const char *name) {
+    size_t len = strlen(name);
+    return len > 3 && strcmp(name + len - 3, ".gz") == 0;
+}
+
+static void apply_retention(const char *path) {
+    pthread_mutex_lock(&retention_lock);
+
+    Segment *segs;
+    int count = list_segments(path, &segs);
+    time_t cutoff = log_retention_days > 0 ? time(NULL) - (time_t)log_retention_days * 86400 : 0;
+
+    for (int i = 0; i < count; i++) {
+        int excess = log_keep_segments > 0 && count - i > log_keep_segments;
+        int expired = cutoff && segs[i].mtime < cutoff;
+        if (excess || expired) {
+            unlink(segs[i].name);
+        }
+    }
+    free(segs);
+
+    pthread_mutex_unlock(&retention_lock);
+}
+
+// ---------------------------------------------------------------------------
+// Compression (worker pool)
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    char segment[SEGMENT_PATH_MAX];
+    char log_path[SEGMENT_PATH_MAX];
+} CompressJob;
+
+static int gzip_file(const char *src, const char *dst) {
+    int in = open(src, O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        return -1;
+    }
+    // Same permissions as the log itself
+    int fd = open(dst, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    gzFile out = fd >= 0 ? gzdopen(fd, "wb6") : NULL;
+    if (!out) {
+        if (fd >= 0) close(fd);
+        close(in);
+        return -1;
+    }
+
+    char buf[64 * 1024];
+    ssize_t n;
+    int rc = 0;
+    while ((n = read(in, buf, sizeof(buf))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            rc = -1;
+            break;
+        }
+        if (gzwrite(out, buf, (unsigned)n) != (int)n) {
+            rc = -1;
+            break;
+        }
+    }
+    close(in);
+    if (gzclose(out) != Z_OK) {
+        rc = -1;
+    }
+    return rc;
+}
+
+static void compress_segment(void *arg) {
+    CompressJob *job = arg;
+    char tmp[SEGMENT_PATH_MAX + 8], gz[SEGMENT_PATH_MAX + 4];
+    snprintf(tmp, sizeof(tmp), "%s.gz.tmp", job->segment);
+    snprintf(gz, sizeof(gz), "%s.gz", job->segment);
+
+    // Publish the .gz only once it is complete; readers fall back to the
+    // plain segment until then
+    if (gzip_file(job->segment, tmp) == 0 && rename(tmp, gz) == 0) {
+        unlink(job->segment);
+    } else {
+        unlink(tmp);
+    }
+
+    apply_retention(job->log_path);
+    free(job);
+}
+
+static void queue_compression(const char *segment, const char *path) {
+    CompressJob *job = malloc(sizeof(CompressJob));
+    if (!job) {
+        return;
+    }
+    snprintf(job->segment, sizeof(job->segment), "%s", segment);
+    snprintf(job->log_path, sizeof(job->log_path), "%s", path);
+    if (worker_pool_submit(compress_segment, job) != 0) {
+        free(job);
+    }
+}
+
+// Suffix for the next segment rotated in second `stamp`: none (0) for the
+// first, else one past the newest. Not the first free name: retention may
+// have deleted older ones, and reusing their names would sort a new segment
+// before the ones it is newer than.
+static int next_suffix(const char *path, const char *stamp) {
+    char dir[SEGMENT_PATH_MAX - 256], prefix[SEGMENT_PATH_MAX];
+    const char *base;
+    split_path(path, dir, sizeof(dir), &base);
+    snprintf(prefix, sizeof(prefix), "%s-%s", base, stamp);
+    size_t prefix_len = strlen(prefix);
+
+    Segment *segs;
+    int count = list_segments(path, &segs);
+    int next = 0;
+    for (int i = 0; i < count; i++) {
+        if (strncmp(segs[i].stem, prefix, prefix_len) != 0) {
+            continue;
+        }
+        const char *rest = segs[i].stem + prefix_len;
+        if (*rest != '\0' && *rest != '-') {
+            continue;
+        }
+        int n = (*rest == '-') ? atoi(rest + 1) : 0;
+        if (n + 1 > next) {
+            next = n + 1;
+        }
+    }
+    free(segs);
+    return next;
+}
+
+int log_rotate(const char *path) {
+    char segment[SEGMENT_PATH_MAX];
+    char stamp[32];
+    time_t now = time(NULL);
+    struct tm tm_info;
+    localtime_r(&now, &tm_info);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm_info);
+
+    // Several rotations within a second get -1, -2, ... (sorts after the first)
+    for (int n = next_suffix(path, stamp); ; n++) {
+        if (n == 0) {
+            snprintf(segment, sizeof(segment), "%s-%s", path, stamp);
+        } else {
+            snprintf(segment, sizeof(segment), "%s-%s-%d", path, stamp, n);
+        }
+        char gz[SEGMENT_PATH_MAX + 4];
+        snprintf(gz, sizeof(gz), "%s.gz", segment);
+        if (access(segment, F_OK) != 0 && access(gz, F_OK) != 0) {
+            break;
+        }
+    }
+
+    if (rename(path, segment) != 0) {
+        return -1;
+    }
+
+    if (log_compress) {
+        queue_compression(segment, path);
+    } else {
+        apply_retention(path);
+    }
+    return 0;
+}
+
+void log_rotate_recover(const char *path) {
+    Segment *segs;
+    int count = list_segments(path, &segs);
+    for (int i = 0; i < count; i++) {
+        if (log_compress && !is_compressed(segs[i].name)) {
+            char tmp[SEGMENT_PATH_MAX + 8];
+            snprintf(tmp, sizeof(tmp), "%s.gz.tmp", segs[i].name);
+            unlink(tmp);
+            queue_compression(segs[i].name, path);
+        }
+    }
+    free(segs);
+    apply_retention(path);
+}
+
+// ---------------------------------------------------------------------------
+// Reading across segments
+// ---------------------------------------------------------------------------
+
+// Keep the last `want` lines of `file` in ring[]; returns lines seen
+static long tail_file(const char *file, char (*ring)[256], int want) {
+    gzFile in = gzopen(file, "rb");   // reads plain files too
+    if (!in) {
+        return 0;
+    }
+    long seen = 0;
+    char line[256];
+    while (gzgets(in, line, sizeof(line))) {
+        size_t len = strcspn(line, "\n");
+        line[len] = '\0';
+        memcpy(ring[seen % want], line, len + 1);
+        seen++;
+    }
+    gzclose(in);
+    return seen;
+}
+
+static int read_tail(const char *path, char lines[][256], int max_lines, int include_current) {
+    if (max_lines <= 0) {
+        return 0;
+    }
+    char (*ring)[256] = malloc((size_t)max_lines * sizeof(*ring));
+    if (!ring) {
+        return 0;
+    }
+
+    Segment *segs;
+    int nsegs = list_segments(path, &segs);
+
+    // Fill lines[] from the back: newest file first, then older segments
+    int need = max_lines;
+    for (int s = include_current ? nsegs : nsegs - 1; s >= 0 && need > 0; s--) {
+        const char *file = (s == nsegs) ? path : segs[s].name;
+        long seen = tail_file(file, ring, need);
+        int take = seen < need ? (int)seen : need;
+        for (int i = 0; i < take; i++) {
+            long src = (seen - take + i) % need;
+            memcpy(lines[need - take + i], ring[src], sizeof(ring[0]));
+        }
+        need -= take;
+    }
+    free(segs);
+    free(ring);
+
+    int count = max_lines - need;
+    if (need > 0) {
+        memmove(lines[0], lines[need], (size_t)count * sizeof(lines[0]));
+    }
+    return count;
+}
+
+int log_read_tail(const char *path, char lines[][256], int max_lines) {
+    return read_tail(path, lines, max_lines, 1);
+}
+
+int log_read_rotated_tail(const char *path, char lines[][256], int max_lines) {
+    return read_tail(path, lines, max_lines, 0);
+}
@@ -0,0 +1,32 @@
+#ifndef LOG_ROTATE_H
+#define LOG_ROTATE_H
+
+#include <stdint.h>
+#include <time.h>
+
+// Rotation of the text command log. A full log is renamed to a timestamped
+// segment (securecli.log-20240115-143045), which is gzip-compressed on the
+// worker pool; old segments are pruned per the log_keep_segments and
+// log_retention_days config keys.
+
+// True if a log of `size` bytes opened at `opened` should be rotated now
+// (log_max_size_kb / log_max_age_hours)
+int log_rotate_due(uint64_t size, time_t opened);
+
+// Rename `path` to a new segment and queue its compression. The caller must
+// have closed its descriptor for `path`. Returns 0, or -1 if the rename failed.
+int log_rotate(const char *path);
+
+// Queue compression of segments left uncompressed (e.g. by an earlier run
+// that exited mid-compression) and apply retention
+void log_rotate_recover(const char *path);
+
+// Read the last `max_lines` lines of the log, continuing into rotated
+// segments (compressed or not) when the current file is shorter. Lines are
+// returned oldest first without the trailing newline; returns the count.
+int log_read_tail(const char *path, char lines[][256], int max_lines);
+
+// Same, but only from the rotated segments (newest segment last)
+int log_read_rotated_tail(const char *path, char lines[][256], int max_lines);
+
+#endif
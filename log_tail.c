@@ -0,0 +1,264 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include "log_tail.h"
+#include "log_rotate.h"
+
+#define READ_CHUNK (64 * 1024)
+
+// Never read more than this from the back of the file to find the last lines
+#define SEED_WINDOW_MAX (4 * 1024 * 1024)
+
+static void push_line(LogTail *t, const char *s, size_t len) {
+    if (len >= LOG_TAIL_LINE_MAX) {
+        len = LOG_TAIL_LINE_MAX - 1;
+    }
+    int slot;
+    if (t->count < t->max_lines) {
+        slot = (t->head + t->count++) % t->max_lines;
+    } else {
+        slot = t->head;
+        t->head = (t->head + 1) % t->max_lines;
+    }
+    memcpy(t->lines[slot], s, len);
+    t->lines[slot][len] = '\0';
+    t->seen++;
+}
+
+// Push each complete line of buf; returns the bytes consumed (through the
+// last newline). A partial last line is left for the next read.
+static size_t push_lines(LogTail *t, const char *buf, size_t len) {
+    size_t start = 0;
+    const char *nl;
+    while (start < len && (nl = memchr(buf + start, '\n', len - start)) != NULL) {
+        size_t end = (size_t)(nl - buf);
+        push_line(t, buf + start, end - start);
+        start = end + 1;
+    }
+    return start;
+}
+
+static int count_newlines(const char *buf, size_t len) {
+    int n = 0;
+    for (const char *p = buf; (p = memchr(p, '\n', len - (size_t)(p - buf))) != NULL; p++) {
+        n++;
+    }
+    return n;
+}
+
+// Read the last max_lines lines by reading ever larger windows back from
+// EOF. With `segments`, a file shorter than that is preceded by lines from
+// the rotated segments.
+static void seed_from_end(LogTail *t, off_t size, int segments) {
+    size_t window = 4096;
+    char *buf = NULL;
+    off_t start;
+    ssize_t got;
+    for (;;) {
+        start = size > (off_t)window ? size - (off_t)window : 0;
+        char *grown = realloc(buf, (size_t)(size - start));
+        if (!grown) {
+            free(buf);
+            return;
+        }
+        buf = grown;
+        got = pread(t->fd, buf, (size_t)(size - start), start);
+        if (got < 0) {
+            free(buf);
+            return;
+        }
+        // Beyond the window start, the first line may be partial
+        int need = t->max_lines + (start > 0);
+        if (start == 0 || count_newlines(buf, (size_t)got) >= need || window >= SEED_WINDOW_MAX) {
+            break;
+        }
+        window *= 2;
+    }
+
+    const char *p = buf;
+    size_t len = (size_t)got;
+    if (start > 0) {
+        const char *nl = memchr(buf, '\n', len);
+        size_t skip = nl ? (size_t)(nl - buf) + 1 : len;
+        p += skip;
+        len -= skip;
+    }
+
+    int in_file = count_newlines(p, len);
+    if (segments && start == 0 && in_file < t->max_lines) {
+        int want = t->max_lines - in_file;
+        char (*older)[256] = malloc((size_t)want * sizeof(*older));
+        if (older) {
+            int n = log_read_rotated_tail(t->path, older, want);
+            for (int i = 0; i < n; i++) {
+                push_line(t, older[i], strlen(older[i]));
+            }
+            free(older);
+        }
+    }
+
+    t->offset = start + (off_t)(p - buf) + (off_t)push_lines(t, p, len);
+    free(buf);
+}
+
+// Read what was appended since the last call
+static void read_appended(LogTail *t) {
+    struct stat st;
+    if (t->fd < 0 || fstat(t->fd, &st) != 0) {
+        return;
+    }
+    if (st.st_size < t->offset) {
+        t->offset = 0;              // truncated in place
+    }
+    // Far behind (e.g. a burst of output): only the end matters
+    if (st.st_size - t->offset > (off_t)t->max_lines * LOG_TAIL_LINE_MAX * 4) {
+        seed_from_end(t, st.st_size, 0);
+        return;
+    }
+
+    char buf[READ_CHUNK];
+    for (;;) {
+        ssize_t n = pread(t->fd, buf, sizeof(buf), t->offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        size_t used = push_lines(t, buf, (size_t)n);
+        if (used == 0 && n == (ssize_t)sizeof(buf)) {
+            push_line(t, buf, (size_t)n);    // overlong line: keep its start
+            used = (size_t)n;
+        }
+        t->offset += (off_t)used;
+        if (used < (size_t)n) break;         // partial line still being written
+    }
+}
+
+static void watch_file(LogTail *t) {
+    if (t->inotify_fd < 0) return;
+    if (t->file_watch >= 0) {
+        inotify_rm_watch(t->inotify_fd, t->file_watch);
+    }
+    t->file_watch = inotify_add_watch(t->inotify_fd, t->path, IN_MODIFY | IN_MOVE_SELF);
+}
+
+// (Re)open the path if it names a different file than the one we follow.
+// Returns 1 if it switched.
+static int follow_path(LogTail *t) {
+    struct stat st;
+    if (stat(t->path, &st) != 0 || (t->fd >= 0 && st.st_ino == t->inode)) {
+        return 0;
+    }
+    int fd = open(t->path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+    int first = (t->fd < 0 && t->seen == 0);
+    if (t->fd >= 0) {
+        read_appended(t);           // finish the rotated file first
+        close(t->fd);
+    }
+    t->fd = fd;
+    t->offset = 0;
+    t->inode = fstat(fd, &st) == 0 ? st.st_ino : 0;
+    watch_file(t);
+
+    if (first) {
+        seed_from_end(t, st.st_size, 1);
+    } else {
+        read_appended(t);
+    }
+    return 1;
+}
+
+int log_tail_open(LogTail *t, const char *path, int max_lines) {
+    memset(t, 0, sizeof(*t));
+    snprintf(t->path, sizeof(t->path), "%s", path);
+    t->fd = -1;
+    t->file_watch = t->dir_watch = -1;
+    t->max_lines = max_lines > 0 ? max_lines : 1;
+    t->lines = calloc((size_t)t->max_lines, sizeof(*t->lines));
+    if (!t->lines) {
+        return -1;
+    }
+
+    t->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (t->inotify_fd >= 0) {
+        // The directory watch sees the log being created or replaced
+        char dir[sizeof(t->path)];
+        const char *slash = strrchr(t->path, '/');
+        if (slash) {
+            snprintf(dir, sizeof(dir), "%.*s", (int)(slash - t->path), t->path);
+        } else {
+            snprintf(dir, sizeof(dir), ".");
+        }
+        t->dir_watch = inotify_add_watch(t->inotify_fd, dir, IN_CREATE | IN_MOVED_TO);
+    }
+
+    follow_path(t);
+    if (t->fd < 0) {
+        // No log yet: still show what the rotated segments hold
+        int n;
+        char (*older)[256] = malloc((size_t)t->max_lines * sizeof(*older));
+        if (older) {
+            n = log_read_rotated_tail(t->path, older, t->max_lines);
+            for (int i = 0; i < n; i++) {
+                push_line(t, older[i], strlen(older[i]));
+            }
+            free(older);
+        }
+    }
+    return 0;
+}
+
+int log_tail_poll(LogTail *t) {
+    unsigned long before = t->seen;
+
+    if (t->inotify_fd < 0) {
+        follow_path(t);
+        read_appended(t);
+        return t->seen != before;
+    }
+
+    const char *base = strrchr(t->path, '/');
+    base = base ? base + 1 : t->path;
+    int modified = 0, replaced = 0;
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t n;
+    while ((n = read(t->inotify_fd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + n; ) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            if (ev->mask & IN_Q_OVERFLOW) {
+                modified = replaced = 1;
+            } else if (ev->wd == t->file_watch) {
+                modified |= (ev->mask & IN_MODIFY) != 0;
+                replaced |= (ev->mask & IN_MOVE_SELF) != 0;
+            } else if (ev->wd == t->dir_watch && ev->len && strcmp(ev->name, base) == 0) {
+                replaced = 1;
+            }
+            p += sizeof(struct inotify_event) + ev->len;
+        }
+    }
+
+    if (modified) {
+        read_appended(t);
+    }
+    if (replaced) {
+        follow_path(t);
+    }
+    return t->seen != before;
+}
+
+const char *log_tail_line(const LogTail *t, int i) {
+    return t->lines[(t->head + i) % t->max_lines];
+}
+
+void log_tail_close(LogTail *t) {
+    if (t->fd >= 0) close(t->fd);
+    if (t->inotify_fd >= 0) close(t->inotify_fd);
+    free(t->lines);
+    memset(t, 0, sizeof(*t));
+    t->fd = t->inotify_fd = -1;
+}
@@ -0,0 +1,41 @@
+#ifndef LOG_TAIL_H
+#define LOG_TAIL_H
+
+#include <sys/types.h>
+
+// Incremental tail of a growing text log. The first read seeks backward
+// from EOF (and into rotated segments if the file is short); after that only
+// appended bytes are read, woken by inotify. Rotation is followed by
+// reopening the path when it names a new file.
+
+#define LOG_TAIL_LINE_MAX 256
+
+typedef struct {
+    char   path[512];
+    int    fd;                    // current log, -1 until it exists
+    ino_t  inode;
+    off_t  offset;                // just past the last complete line read
+    int    inotify_fd;            // -1 if unavailable: poll with fstat
+    int    file_watch;
+    int    dir_watch;
+    char (*lines)[LOG_TAIL_LINE_MAX];   // ring of the last max_lines lines
+    int    max_lines;
+    int    head;                  // index of the oldest line
+    int    count;
+    unsigned long seen;           // lines pushed so far
+} LogTail;
+
+// Returns 0, or -1 if out of memory. A missing log is not an error.
+int  log_tail_open(LogTail *t, const char *path, int max_lines);
+
+// Pick up appended lines and follow rotation. Cheap when nothing changed
+// (one non-blocking read of the inotify descriptor). Returns 1 if the
+// lines changed, 0 otherwise.
+int  log_tail_poll(LogTail *t);
+
+// i-th line, oldest first (0 <= i < t->count)
+const char *log_tail_line(const LogTail *t, int i);
+
+void log_tail_close(LogTail *t);
+
+#endif
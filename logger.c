@@ -3,10 +3,297 @@
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
 #include "logger.h"
+#include "audit.h"
+#include "log_rotate.h"
+#include "config.h"
 
-#define LOG_FILE "securecli.log"
 #define MAX_LOG_LINE 1024
+#define RING_SLOTS 1024          // power of two
+#define BATCH_MAX 64             // entries per writev
+
+// ---------------------------------------------------------------------------
+// Bounded lock-free multi-producer ring (per-slot sequence numbers).
+// Any thread may enqueue; only the writer thread dequeues. A slot holds
+// either a text line for securecli.log or a binary audit record.
+// ---------------------------------------------------------------------------
+
+enum { SLOT_TEXT, SLOT_AUDIT };
+
+typedef struct {
+    atomic_size_t seq;
+    size_t        len;
+    int           kind;
+    _Alignas(8) char text[MAX_LOG_LINE];
+} LogSlot;
+
+static LogSlot ring[RING_SLOTS];
+static atomic_size_t enqueue_pos;
+static size_t dequeue_pos;               // writer thread only
+
+static int log_fd = -1;
+static uint64_t log_size;                // bytes in the current log file
+static time_t log_opened;                // when the current log file was started
+static pthread_t writer_thread;
+static sem_t writer_wake;
+static atomic_int writer_idle;           // writer is (about to be) asleep
+static atomic_int stopping;
+static atomic_size_t pending;            // entries enqueued but not yet written
+static pthread_once_t start_once = PTHREAD_ONCE_INIT;
+static int started = 0;
+
+// Last second formatted by each thread, so localtime_r runs once a second
+static __thread time_t ts_cached_sec = -1;
+static __thread char ts_cached[32];
+
+static const char *timestamp_now(void) {
+    time_t now = time(NULL);
+    if (now != ts_cached_sec) {
+        struct tm tm_info;
+        localtime_r(&now, &tm_info);
+        strftime(ts_cached, sizeof(ts_cached), "%Y-%m-%d %H:%M:%S", &tm_info);
+        ts_cached_sec = now;
+    }
+    return ts_cached;
+}
+
+static void wake_writer(void) {
+    if (atomic_exchange(&writer_idle, 0)) {
+        sem_post(&writer_wake);
+    }
+}
+
+int logger_writev_all(int fd, struct iovec *iov, int count) {
+    while (count > 0) {
+        ssize_t n = writev(fd, iov, count);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        // Skip fully written buffers, trim a partially written one
+        while (count > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return 0;
+}
+
+// Flush the text log and the audit log to disk
+static void sync_files(void) {
+    if (log_fd >= 0) {
+        fdatasync(log_fd);
+    }
+    audit_sync();
+}
+
+static void open_log(void) {
+    log_fd = open(LOG_FILE, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+    struct stat st;
+    log_size = (log_fd >= 0 && fstat(log_fd, &st) == 0) ? (uint64_t)st.st_size : 0;
+    log_opened = time(NULL);
+}
+
+static void write_text(struct iovec *iov, int count) {
+    // Rotation happens here on the writer thread; compression of the old
+    // segment is queued on the worker pool, so producers never wait for it
+    if (log_fd >= 0 && log_rotate_due(log_size, log_opened)) {
+        close(log_fd);
+        log_rotate(LOG_FILE);
+        open_log();
+    }
+    if (log_fd < 0) {
+        return;
+    }
+
+    size_t bytes = 0;
+    for (int i = 0; i < count; i++) {
+        bytes += iov[i].iov_len;
+    }
+    if (logger_writev_all(log_fd, iov, count) == 0) {
+        log_size += bytes;
+    }
+}
+
+// Write everything currently in the ring; returns number of entries written
+static size_t drain_ring(void) {
+    size_t total = 0;
+    for (;;) {
+        struct iovec text_iov[BATCH_MAX], audit_iov[BATCH_MAX];
+        int count = 0, ntext = 0, naudit = 0;
+        size_t pos = dequeue_pos;
+
+        while (count < BATCH_MAX) {
+            LogSlot *slot = &ring[pos & (RING_SLOTS - 1)];
+            if (atomic_load_explicit(&slot->seq, memory_order_acquire) != pos + 1) {
+                break;   // not yet published
+            }
+            struct iovec *iov = (slot->kind == SLOT_AUDIT) ? &audit_iov[naudit++]
+                                                           : &text_iov[ntext++];
+            iov->iov_base = slot->text;
+            iov->iov_len = slot->len;
+            count++;
+            pos++;
+        }
+        if (count == 0) {
+            return total;
+        }
+
+        if (ntext > 0) {
+            write_text(text_iov, ntext);
+        }
+        if (naudit > 0) {
+            audit_write_batch(audit_iov, naudit);
+        }
+
+        // Hand the slots back to producers only after writev has copied them
+        for (int i = 0; i < count; i++) {
+            LogSlot *slot = &ring[(dequeue_pos + i) & (RING_SLOTS - 1)];
+            atomic_store_explicit(&slot->seq, dequeue_pos + i + RING_SLOTS, memory_order_release);
+        }
+        dequeue_pos = pos;
+        atomic_fetch_sub(&pending, count);
+        total += count;
+
+        if (strcmp(log_fsync, "batch") == 0) {
+            sync_files();
+        }
+    }
+}
+
+static void *writer_main(void *unused) {
+    (void)unused;
+    struct timespec last_sync;
+    clock_gettime(CLOCK_MONOTONIC, &last_sync);
+    int dirty = 0;
+
+    for (;;) {
+        if (drain_ring() > 0) {
+            dirty = 1;
+        }
+
+        if (dirty && strcmp(log_fsync, "interval") == 0) {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            long elapsed_ms = (now.tv_sec - last_sync.tv_sec) * 1000 +
+                              (now.tv_nsec - last_sync.tv_nsec) / 1000000;
+            if (elapsed_ms >= log_fsync_interval_ms) {
+                sync_files();
+                last_sync = now;
+                dirty = 0;
+            }
+        }
+
+        if (atomic_load(&stopping) && atomic_load(&pending) == 0) {
+            break;
+        }
+
+        // Announce we are going idle, then re-check to avoid a lost wakeup
+        atomic_store(&writer_idle, 1);
+        if (atomic_load(&pending) > 0 || atomic_load(&stopping)) {
+            atomic_store(&writer_idle, 0);
+            continue;
+        }
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += 100 * 1000000L;   // also wakes for interval fsync
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        sem_timedwait(&writer_wake, &deadline);
+        atomic_store(&writer_idle, 0);
+    }
+
+    if (strcmp(log_fsync, "none") != 0) {
+        sync_files();
+    }
+    audit_writer_close();
+    return NULL;
+}
+
+static void start_logger(int fresh) {
+    // A fresh log starts a new segment; the previous one is kept as a rotated segment
+    struct stat st;
+    if (fresh && stat(LOG_FILE, &st) == 0 && st.st_size > 0) {
+        log_rotate(LOG_FILE);
+    }
+    log_rotate_recover(LOG_FILE);
+
+    open_log();
+    if (log_fd >= 0 && log_size == 0) {
+        static const char header[] = "=== SecureSysCLI Command Log ===\n";
+        if (write(log_fd, header, sizeof(header) - 1) > 0) {
+            log_size = sizeof(header) - 1;
+        }
+    }
+
+    for (size_t i = 0; i < RING_SLOTS; i++) {
+        atomic_init(&ring[i].seq, i);
+    }
+    sem_init(&writer_wake, 0, 0);
+
+    // Leave terminal signals (incl. SIGWINCH for the dashboard) to the main thread
+    sigset_t block, old;
+    sigemptyset(&block);
+    sigaddset(&block, SIGINT);
+    sigaddset(&block, SIGTERM);
+    sigaddset(&block, SIGWINCH);
+    pthread_sigmask(SIG_BLOCK, &block, &old);
+    if (pthread_create(&writer_thread, NULL, writer_main, NULL) == 0) {
+        started = 1;
+        atexit(logger_shutdown);
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+}
+
+static void start_default(void) {
+    start_logger(0);
+}
+
+// Claim the next free slot; if the ring is full, wait for the writer to catch up
+static LogSlot *claim_slot(size_t *claimed) {
+    size_t pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+    for (;;) {
+        LogSlot *slot = &ring[pos & (RING_SLOTS - 1)];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (seq == pos) {
+            if (atomic_compare_exchange_weak_explicit(&enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                *claimed = pos;
+                return slot;
+            }
+        } else if (seq < pos) {
+            wake_writer();
+            sched_yield();
+            pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+        } else {
+            pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+static void publish_slot(LogSlot *slot, size_t pos) {
+    atomic_fetch_add(&pending, 1);
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+    wake_writer();
+}
 
 // Log a command to the command history log file
 void log_command(const char *command) {
@@ -14,31 +301,79 @@ void log_command(const char *command) {
         return;
     }
 
-    FILE *log = fopen(LOG_FILE, "a");
-    if (!log) {
-        // Silently fail if we can't open log file
-        return;
+    pthread_once(&start_once, start_default);
+    if (!started) {
+        return;   // Silently fail if the writer could not be started
     }
 
-    // Get current timestamp
-    time_t now = time(NULL);
-    struct tm *tm_info = localtime(&now);
-    char timestamp[64];
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", tm_info);
+    size_t pos;
+    LogSlot *slot = claim_slot(&pos);
 
     // Write log entry: timestamp | command
-    fprintf(log, "[%s] %s\n", timestamp, command);
-    fflush(log);  // Ensure it's written immediately
-    fclose(log);
+    int n = snprintf(slot->text, sizeof(slot->text), "[%s] %s\n", timestamp_now(), command);
+    if (n < 0) {
+        n = 0;
+    } else if ((size_t)n >= sizeof(slot->text)) {
+        n = sizeof(slot->text) - 1;
+        slot->text[n - 1] = '\n';
+    }
+    slot->len = n;
+    slot->kind = SLOT_TEXT;
+    publish_slot(slot, pos);
+}
+
+void logger_submit_record(const void *record, size_t len) {
+    if (len > MAX_LOG_LINE) {
+        return;
+    }
+
+    pthread_once(&start_once, start_default);
+    if (!started) {
+        return;
+    }
+
+    size_t pos;
+    LogSlot *slot = claim_slot(&pos);
+    memcpy(slot->text, record, len);
+    slot->len = len;
+    slot->kind = SLOT_AUDIT;
+    publish_slot(slot, pos);
+}
+
+static void start_fresh(void) {
+    start_logger(1);
 }
 
 // Initialize the logger (optional, can be called at startup)
 void logger_init(void) {
-    // Create or truncate log file with header
-    FILE *log = fopen(LOG_FILE, "w");
-    if (log) {
-        fprintf(log, "=== SecureSysCLI Command Log ===\n");
-        fclose(log);
+    // Start a new log file with header, rotating out the old one
+    pthread_once(&start_once, start_fresh);
+}
+
+void logger_flush(void) {
+    if (!started) {
+        return;
     }
+    while (atomic_load(&pending) > 0) {
+        wake_writer();
+        sched_yield();
+    }
+}
+
+size_t logger_backlog(void) {
+    return atomic_load(&pending);
 }
 
+void logger_shutdown(void) {
+    if (!started) {
+        return;
+    }
+    started = 0;
+    atomic_store(&stopping, 1);
+    sem_post(&writer_wake);
+    pthread_join(writer_thread, NULL);
+    if (log_fd >= 0) {
+        close(log_fd);
+        log_fd = -1;
+    }
+}
@@ -1,11 +1,34 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
-// Log a command to the command history log file
+#include <stddef.h>
+
+#define LOG_FILE "securecli.log"
+
+// Log a command to the command history log file.
+// Safe to call from any thread: the entry is queued on a lock-free ring
+// and written by a background thread in batches (see log_fsync config).
 void log_command(const char *command);
 
-// Initialize the logger (optional, can be called at startup)
+// Queue a binary audit record (see audit.h), at most 1024 bytes. It is
+// written by the same background thread as the text log.
+void logger_submit_record(const void *record, size_t len);
+
+// Initialize the logger (optional, can be called at startup). Starts a new
+// log file; a non-empty old one becomes a rotated segment (see log_rotate.h).
 void logger_init(void);
 
-#endif
+// Block until every queued entry has been written
+void logger_flush(void);
 
+// Entries queued but not yet written
+size_t logger_backlog(void);
+
+// Write out remaining entries and stop the writer (registered with atexit)
+void logger_shutdown(void);
+
+// writev() every byte of `iov` to `fd`, retrying short writes; 0 or -1
+struct iovec;
+int logger_writev_all(int fd, struct iovec *iov, int count);
+
+#endif
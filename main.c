@@ -4,108 +4,204 @@
 #include <signal.h>
 #include <unistd.h>
 #include <readline/readline.h>
-#include <readline/history.h>
 #include <dirent.h>
+#include <limits.h>
 #include "commands.h"
-#include "file_management.h"
-#include "process_management.h"
 #include "terminal.h"
 #include "auth.h"
 #include "logger.h"
 #include "config.h"
 #include "signals.h"
 #include "script.h"
+#include "tasks.h"
+#include "jobs.h"
+#include "launcher.h"
+#include "audit.h"
+#include "cli_output.h"
+#include "metrics.h"
+#include "registry.h"
+#include "completion.h"
+#include "arena.h"
+#include "lexer.h"
+#include "cmdhist.h"
 
 // Global flag to track if we're in the main loop (not running a foreground process)
 static volatile sig_atomic_t in_main_loop = 1;
+volatile sig_atomic_t in_batch = 0;
 // Global variable to track foreground child process (used by signal handler)
 volatile pid_t foreground_pid = 0;
 
-// ---------------- Autocomplete Setup ----------------
+static char *build_prompt(void) {
+    const char *username = (current_user && current_user->username[0])
+                               ? current_user->username
+                               : "user";
+    char prompt[512];
+    snprintf(prompt, sizeof(prompt), "SecureSysCLI@%s:~$ ", username);
+    return strdup(prompt);
+}
+
+// ---------------- Command Dispatcher ----------------
 
-// List of available commands
-static char *command_list[] = {
-    "hello", "help", "clear", "exec", "list", "create", "copy", "delete",
-    "run", "pslist", "fgproc", "bgproc", "killproc", "whoami",
-    "encrypt", "decrypt", "checksum",
-    "dashboard", "source", "exit", "quit", NULL
-};
 
-// Command generator for readline completion
-static char *command_generator(const char *text, int state) {
-    static int idx, len;
-    if (!state) {
-        idx = 0;
-        len = strlen(text);
-    }
-    
-    while (command_list[idx]) {
-        const char *name = command_list[idx++];
-        if (strncmp(name, text, len) == 0) {
-            return strdup(name);
+// Run a built-in on the worker pool: "checksum big.iso &"
+static void start_background_command(const CommandInfo *cmd, int argc, char *argv[]) {
+    char secret[128] = "";
+    if (cmd->flags & CMD_SECRET) {
+        prompt_crypto_password(secret, sizeof(secret));
+        if (secret[0] == '\0') {
+            printf("Password cannot be empty\n");
+            return;
         }
     }
-    return NULL;
+
+    task_start(cmd->func, argc, argv, (cmd->flags & CMD_SECRET) ? secret : NULL);
+    memset(secret, 0, sizeof(secret));
 }
 
-// Completion function for readline
-static char **securecli_completion(const char *text, int start, int end) {
-    (void)end;
-    
-    // If start == 0, we're completing the first token (command name)
-    if (start == 0) {
-        return rl_completion_matches(text, command_generator);
+// Words of the line being run, plus dispatch()'s copy of them; reset once
+// the line has been dispatched
+static Arena line_arena;
+
+// Run one tokenized command and record it in the audit log. In batch mode
+// there is no prompt to come back to, so a built-in's trailing "&" is
+// ignored and it runs in the foreground. Returns the exit status.
+static int dispatch(int argc, char *argv[], int batch) {
+    // Commands may overwrite argv slots (pipelines split on "|"), so the
+    // audit record is built from a copy of the token pointers
+    char **audit_argv = arena_alloc(&line_arena, (argc + 1) * sizeof(char *));
+    int audit_argc = argc;
+    if (audit_argv) {
+        memcpy(audit_argv, argv, (argc + 1) * sizeof(char *));
     } else {
-        // For other tokens, use filename completion
-        return rl_completion_matches(text, rl_filename_completion_function);
+        audit_argv = argv;
     }
+    AuditTimer timer;
+    audit_timer_start(&timer);
+    cli_set_status(0);
+    int backgrounded = 0;
+
+    // Match command
+    const CommandInfo *cmd = registry_find(argv[0]);
+    if (!cmd) {
+        printf("Unknown command: %s\n", argv[0]);
+        cli_set_status(127);
+    } else if (batch && (cmd->flags & CMD_REPL_ONLY)) {
+        fprintf(stderr, "%s: only available at the prompt\n", argv[0]);
+        cli_set_status(1);
+    } else {
+        int background = argc > 1 && strcmp(argv[argc - 1], "&") == 0 &&
+                         !(cmd->flags & CMD_FOREGROUND);
+        if (background) {
+            argv[--argc] = NULL;
+        }
+        if (registry_check(cmd, argc) == 0) {
+            if (background && !batch) {
+                start_background_command(cmd, argc, argv);
+                backgrounded = 1;   // the task writes its own audit record
+            } else {
+                cmd->func(argc, argv);
+            }
+        }
+    }
+    if (!backgrounded) {
+        audit_finish(&timer, audit_argc, audit_argv, cli_status());
+        metrics_command_finished(cli_status());
+    }
+    return cli_status();
 }
 
-static char *build_prompt(void) {
-    const char *username = (current_user && current_user->username[0])
-                               ? current_user->username
-                               : "user";
-    char prompt[512];
-    snprintf(prompt, sizeof(prompt), "SecureSysCLI@%s:~$ ", username);
-    return strdup(prompt);
+// Tokenize and run one input line; returns its exit status
+static int run_line(const char *line, int batch) {
+    int argc = lex_count(line);
+    if (argc < 0) {
+        fprintf(stderr, "Syntax error: unterminated quote\n");
+        cli_set_status(2);
+        return 2;
+    }
+    int status = 0;
+    if (argc > 0) {
+        // Split in place in the arena; argv is NULL-terminated for execvp
+        char *words = arena_strdup(&line_arena, line);
+        char **argv = arena_alloc(&line_arena, (argc + 1) * sizeof(char *));
+        if (!words || !argv) {
+            fprintf(stderr, "Out of memory\n");
+            status = 1;
+        } else {
+            lex_split(words, argv);
+            status = dispatch(argc, argv, batch);
+        }
+    }
+    arena_reset(&line_arena);
+    return status;
 }
 
-// ---------------- Command Dispatcher ----------------
+// Programs a batch run started in the background ("run prog &", bgproc)
+// would be orphaned, and nothing would ever poll their jobs, so wait for
+// them before exiting. The first one that failed sets the exit status if
+// the command itself succeeded.
+static int wait_for_jobs(int status) {
+    if (job_count() > 0) {
+        fflush(stdout);
+        fprintf(stderr, "Waiting for %d background job(s)...\n", job_count());
+    }
+    Job *job = job_first();
+    while (job) {
+        Job *next = job->next;
+        if (!job->task) {
+            for (int i = 0; i < job->npids; i++) {
+                if (!(job->reaped & (1u << i))) {
+                    launch_wait_foreground(job->pids[i]);
+                    if (status == 0) {
+                        status = cli_status();
+                    }
+                }
+            }
+            job_remove(job);
+        }
+        job = next;
+    }
+    return status;
+}
 
-struct Command {
-    const char *name;
-    void (*func)(int argc, char *argv[]);
-};
-
-struct Command commands[] = {
-    {"hello", cmd_hello},
-    {"help", cmd_help},
-    {"clear", cmd_clear},
-    {"exec", cmd_exec},
-    {"list", cmd_list},
-    {"create", cmd_create},
-    {"copy", cmd_copy},
-    {"delete", cmd_delete},
-    {"write", cmd_write},
-    {"show", cmd_show},
-    {"close", cmd_close},
-    {"run", cmd_run},
-    {"pslist", cmd_pslist},
-    {"fgproc", cmd_fgproc},
-    {"bgproc", cmd_bgproc},
-    {"killproc", cmd_killproc},
-    {"whoami", cmd_whoami},
-    {"encrypt", cmd_encrypt},
-    {"decrypt", cmd_decrypt},
-    {"checksum", cmd_checksum},
-    {"dashboard", cmd_dashboard},
-    {"source", cmd_source},
-    {NULL, NULL}
-};
+// `project -c COMMAND` and `project SCRIPT.cli`: log in from a key file or
+// token, run, and exit with the command's status. No banner, readline,
+// history or terminal setup.
+static int run_batch(const char *command, const char *script, const char *key_file) {
+    if (!login_batch(key_file)) {
+        return 77;      // EX_NOPERM
+    }
+    in_batch = 1;
+    in_main_loop = 0;
+
+    int status;
+    if (command) {
+        log_command(command);
+        status = run_line(command, 1);
+    } else {
+        // Logged as the prompt logs the line that runs it
+        char line[PATH_MAX + 8];
+        snprintf(line, sizeof(line), "source %s", script);
+        log_command(line);
+        char *argv[] = { "source", (char *)script, NULL };
+        status = dispatch(2, argv, 1);
+    }
+    return wait_for_jobs(status);
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "Usage: project                          interactive prompt\n"
+            "       project [-k KEYFILE] -c COMMAND  run one command\n"
+            "       project [-k KEYFILE] SCRIPT.cli  run a script\n"
+            "Batch mode reads \"user:password\" from KEYFILE, $" KEY_FILE_ENV " or $" TOKEN_ENV ".\n");
+}
 
 // Signal handler for SIGINT (Ctrl+C)
 static void sigint_handler(int sig) {
     (void)sig;
+    if (in_batch && foreground_pid == 0) {
+        _exit(130);
+    }
     if (in_main_loop || foreground_pid == 0) {
         // In main loop or no foreground process - just print a newline
         printf("\n");
@@ -118,7 +214,38 @@ static void sigint_handler(int sig) {
 
 // ---------------- Main REPL ----------------
 
-int main() {
+int main(int argc, char *argv[]) {
+    const char *command = NULL, *key_file = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "+c:k:h")) != -1) {
+        switch (opt) {
+        case 'c':
+            command = optarg;
+            break;
+        case 'k':
+            key_file = optarg;
+            break;
+        default:
+            usage();
+            return opt == 'h' ? 0 : 2;
+        }
+    }
+    const char *script = optind < argc ? argv[optind] : NULL;
+    if (optind + 1 < argc || (command && script) || (key_file && !command && !script)) {
+        usage();
+        return 2;
+    }
+
+    // Paths on the command line are relative to where we were started,
+    // not to startup_dir
+    char key_path[PATH_MAX], script_path[PATH_MAX];
+    if (key_file && realpath(key_file, key_path)) {
+        key_file = key_path;
+    }
+    if (script && realpath(script, script_path)) {
+        script = script_path;
+    }
+
     // Set up signal handler to ignore Ctrl+C in main loop
     struct sigaction sa;
     sa.sa_handler = sigint_handler;
@@ -136,6 +263,10 @@ int main() {
     }
 
     load_users();
+    if (command || script) {
+        return run_batch(command, script, key_file);
+    }
+
     printf("🔒 Welcome to SecureSysCLI\n");
     printf("Note: Use 'exit' to quit. Ctrl+C will kill foreground processes.\n");
 
@@ -148,16 +279,18 @@ int main() {
         terminal_init();
     }
 
-    // Initialize readline history system
-    read_history(".securecli_history");
-    using_history();
+    // History: the file's tail for Up/Down now, the rest on first Ctrl+R
+    cmdhist_init(".securecli_history");
     
     // Set up autocomplete
-    rl_attempted_completion_function = securecli_completion;
+    completion_init();
 
     char *input_line;
     while (1) {
         in_main_loop = 1;  // We're in the main loop waiting for input
+
+        // Announce background tasks that finished since the last prompt
+        tasks_report_finished();
         
         // Use readline for input (with history and autocomplete)
         char *prompt = build_prompt();
@@ -172,9 +305,9 @@ int main() {
         
         in_main_loop = 0;  // We're executing a command
 
-        // Add non-empty lines to history
+        // Add non-empty lines to history (appended to the file right away)
         if (*input_line) {
-            add_history(input_line);
+            cmdhist_add(input_line);
         }
 
         // Log the command before execution
@@ -193,42 +326,11 @@ int main() {
             break;
         }
 
-        // Tokenize input
-        char *argv[10];
-        int argc = 0;
-        char *line_copy = strdup(input_line);  // strtok modifies the string
-        char *token = strtok(line_copy, " ");
-        while (token && argc < 10) {
-            argv[argc++] = token;
-            token = strtok(NULL, " ");
-        }
-
-        if (argc == 0) {
-            free(input_line);
-            free(line_copy);
-            continue;
-        }
-
-        // Match command
-        int found = 0;
-        for (int i = 0; commands[i].name != NULL; i++) {
-            if (strcmp(argv[0], commands[i].name) == 0) {
-                commands[i].func(argc, argv);
-                found = 1;
-                break;
-            }
-        }
-
-        if (!found) {
-            printf("Unknown command: %s\n", argv[0]);
-        }
-
+        run_line(input_line, 0);
         free(input_line);
-        free(line_copy);
     }
 
-    // Save history before exiting
-    write_history(".securecli_history");
+    cmdhist_close();
     
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,623 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "metrics.h"
+#include "collectors.h"
+#include "logger.h"
+
+#define TOP_PROCS 5
+#define REQUEST_MAX 2048
+#define CLIENT_TIMEOUT_MS 1000
+
+// Serve mode takes its first full sample after at most this long, so an
+// early scrape does not wait a whole interval for CPU figures
+#define FIRST_SAMPLE_MS 1000
+
+// -------------------- Counters --------------------
+
+static atomic_ulong commands_total;
+static atomic_ulong command_failures;
+static atomic_ulong jobs_added[2];          // [0] processes, [1] built-in tasks
+static atomic_ulong jobs_removed;
+static atomic_ullong crypto_bytes[METRICS_CRYPTO_OPS];
+
+void metrics_command_finished(int status) {
+    atomic_fetch_add_explicit(&commands_total, 1, memory_order_relaxed);
+    if (status != 0) {
+        atomic_fetch_add_explicit(&command_failures, 1, memory_order_relaxed);
+    }
+}
+
+void metrics_job_added(int is_task) {
+    atomic_fetch_add_explicit(&jobs_added[is_task != 0], 1, memory_order_relaxed);
+}
+
+void metrics_job_removed(void) {
+    atomic_fetch_add_explicit(&jobs_removed, 1, memory_order_relaxed);
+}
+
+void metrics_crypto_bytes(MetricsCryptoOp op, size_t bytes) {
+    if (op >= 0 && op < METRICS_CRYPTO_OPS) {
+        atomic_fetch_add_explicit(&crypto_bytes[op], bytes, memory_order_relaxed);
+    }
+}
+
+// -------------------- Sampling --------------------
+
+// The dashboard's collectors, owned by one consumer
+typedef struct {
+    ProcSampler procs;
+    CpuSampler  cpus;
+    DevSampler  disks, nics;
+    int         cpu_ok;
+    int         sampled;          // CPU rates cover a full window
+    ProcStat    top[TOP_PROCS];
+    int         ntop;
+    MemInfo     mem;
+    double      load[3];
+} Source;
+
+static void source_sample(Source *s) {
+    int n = proc_sampler_sample(&s->procs, s->top, TOP_PROCS);
+    s->ntop = n > 0 ? n : 0;
+    if (s->cpu_ok) {
+        cpu_sampler_sample(&s->cpus);
+    }
+    disk_sampler_sample(&s->disks);
+    net_sampler_sample(&s->nics);
+    if (meminfo_read(&s->mem) != 0) {
+        memset(&s->mem, 0, sizeof(s->mem));
+    }
+    if (getloadavg(s->load, 3) != 3) {
+        s->load[0] = s->load[1] = s->load[2] = 0;
+    }
+    s->sampled = 1;
+}
+
+static int source_init(Source *s) {
+    memset(s, 0, sizeof(*s));
+    if (proc_sampler_init(&s->procs) != 0) {
+        return -1;
+    }
+    s->cpu_ok = cpu_sampler_init(&s->cpus) == 0;
+    dev_sampler_init(&s->disks);
+    dev_sampler_init(&s->nics);
+    source_sample(s);             // baseline; instant gauges are valid already
+    s->sampled = 0;
+    return 0;
+}
+
+static void source_free(Source *s) {
+    proc_sampler_free(&s->procs);
+    if (s->cpu_ok) {
+        cpu_sampler_free(&s->cpus);
+    }
+    dev_sampler_free(&s->disks);
+    dev_sampler_free(&s->nics);
+}
+
+// -------------------- Rendering --------------------
+
+typedef struct {
+    const char *name;
+    const char *help;
+} MetricDesc;
+
+static const MetricDesc disk_metrics[DEV_COUNTERS] = {
+    [DISK_READ_BYTES]  = { "securecli_disk_read_bytes_total", "Bytes read from the disk." },
+    [DISK_WRITE_BYTES] = { "securecli_disk_written_bytes_total", "Bytes written to the disk." },
+    [DISK_READ_OPS]    = { "securecli_disk_reads_completed_total", "Reads completed by the disk." },
+    [DISK_WRITE_OPS]   = { "securecli_disk_writes_completed_total", "Writes completed by the disk." },
+};
+
+static const MetricDesc net_metrics[DEV_COUNTERS] = {
+    [NET_RX_BYTES]   = { "securecli_network_receive_bytes_total", "Bytes received by the interface." },
+    [NET_TX_BYTES]   = { "securecli_network_transmit_bytes_total", "Bytes sent by the interface." },
+    [NET_RX_PACKETS] = { "securecli_network_receive_packets_total", "Packets received by the interface." },
+    [NET_TX_PACKETS] = { "securecli_network_transmit_packets_total", "Packets sent by the interface." },
+};
+
+static const char *crypto_ops[METRICS_CRYPTO_OPS] = { "encrypt", "decrypt", "checksum" };
+
+static void describe(FILE *out, const char *name, const char *type, const char *help) {
+    fprintf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+// Label values escape backslash, double quote and newline
+static void label_value(FILE *out, const char *s) {
+    for (; *s; s++) {
+        if (*s == '\\' || *s == '"') {
+            fputc('\\', out);
+            fputc(*s, out);
+        } else if (*s == '\n') {
+            fputs("\\n", out);
+        } else {
+            fputc(*s, out);
+        }
+    }
+}
+
+// Cumulative counters of the devices the sampler counts (whole disks,
+// non-loopback NICs) that are still present
+static void render_devices(FILE *out, const DevSampler *s, const MetricDesc desc[DEV_COUNTERS]) {
+    for (int c = 0; c < DEV_COUNTERS; c++) {
+        describe(out, desc[c].name, "counter", desc[c].help);
+        for (int i = 0; i < s->ndev; i++) {
+            const DevStat *d = &s->dev[i];
+            if (!d->counted || !d->present) continue;
+            fprintf(out, "%s{device=\"", desc[c].name);
+            label_value(out, d->name);
+            fprintf(out, "\"} %llu\n", (unsigned long long)d->prev[c]);
+        }
+    }
+}
+
+static void render_processes(FILE *out, const Source *s) {
+    describe(out, "securecli_process_cpu_percent", "gauge",
+             "CPU use of the busiest processes, in % of one CPU.");
+    for (int i = 0; i < s->ntop; i++) {
+        fprintf(out, "securecli_process_cpu_percent{pid=\"%d\",comm=\"", (int)s->top[i].pid);
+        label_value(out, s->top[i].comm);
+        fprintf(out, "\"} %.1f\n", s->top[i].cpu);
+    }
+    describe(out, "securecli_process_memory_percent", "gauge",
+             "Resident memory of the busiest processes, in % of physical memory.");
+    for (int i = 0; i < s->ntop; i++) {
+        fprintf(out, "securecli_process_memory_percent{pid=\"%d\",comm=\"", (int)s->top[i].pid);
+        label_value(out, s->top[i].comm);
+        fprintf(out, "\"} %.1f\n", s->top[i].mem);
+    }
+}
+
+static void render(FILE *out, const Source *s) {
+    // SecureSysCLI itself
+    describe(out, "securecli_commands_total", "counter", "Commands run, including background built-ins.");
+    fprintf(out, "securecli_commands_total %lu\n", atomic_load(&commands_total));
+    describe(out, "securecli_command_failures_total", "counter", "Commands that finished with a non-zero status.");
+    fprintf(out, "securecli_command_failures_total %lu\n", atomic_load(&command_failures));
+
+    unsigned long processes = atomic_load(&jobs_added[0]), tasks = atomic_load(&jobs_added[1]);
+    describe(out, "securecli_jobs_started_total", "counter", "Background jobs started, by kind.");
+    fprintf(out, "securecli_jobs_started_total{kind=\"process\"} %lu\n", processes);
+    fprintf(out, "securecli_jobs_started_total{kind=\"task\"} %lu\n", tasks);
+    describe(out, "securecli_jobs", "gauge", "Background jobs currently tracked.");
+    fprintf(out, "securecli_jobs %lu\n", processes + tasks - atomic_load(&jobs_removed));
+
+    describe(out, "securecli_crypto_bytes_total", "counter", "Bytes processed by encrypt, decrypt and checksum.");
+    for (int op = 0; op < METRICS_CRYPTO_OPS; op++) {
+        fprintf(out, "securecli_crypto_bytes_total{op=\"%s\"} %llu\n", crypto_ops[op], atomic_load(&crypto_bytes[op]));
+    }
+    describe(out, "securecli_log_backlog_entries", "gauge", "Log entries queued but not yet written.");
+    fprintf(out, "securecli_log_backlog_entries %zu\n", logger_backlog());
+
+    // Host
+    describe(out, "securecli_load1", "gauge", "1-minute load average.");
+    fprintf(out, "securecli_load1 %.2f\n", s->load[0]);
+    describe(out, "securecli_load5", "gauge", "5-minute load average.");
+    fprintf(out, "securecli_load5 %.2f\n", s->load[1]);
+    describe(out, "securecli_load15", "gauge", "15-minute load average.");
+    fprintf(out, "securecli_load15 %.2f\n", s->load[2]);
+
+    describe(out, "securecli_memory_total_bytes", "gauge", "Physical memory.");
+    fprintf(out, "securecli_memory_total_bytes %lld\n", (long long)s->mem.total_kb * 1024);
+    describe(out, "securecli_memory_free_bytes", "gauge", "Unused physical memory.");
+    fprintf(out, "securecli_memory_free_bytes %lld\n", (long long)s->mem.free_kb * 1024);
+    describe(out, "securecli_memory_available_bytes", "gauge", "Memory available without swapping.");
+    fprintf(out, "securecli_memory_available_bytes %lld\n", (long long)s->mem.available_kb * 1024);
+
+    describe(out, "securecli_processes", "gauge", "Processes running on the host.");
+    fprintf(out, "securecli_processes %d\n", s->procs.total);
+
+    if (s->cpu_ok && s->sampled) {
+        describe(out, "securecli_cpu_busy_percent", "gauge", "CPU busy time over the last sampling interval.");
+        fprintf(out, "securecli_cpu_busy_percent{cpu=\"all\"} %.1f\n", s->cpus.util[0]);
+        for (int i = 1; i <= s->cpus.ncpu; i++) {
+            fprintf(out, "securecli_cpu_busy_percent{cpu=\"%d\"} %.1f\n", i - 1, s->cpus.util[i]);
+        }
+    }
+    render_devices(out, &s->disks, disk_metrics);
+    render_devices(out, &s->nics, net_metrics);
+    render_processes(out, s);
+}
+
+int metrics_print(FILE *out, int window_ms) {
+    Source s;
+    if (source_init(&s) != 0) {
+        return -1;
+    }
+    struct timespec window = { window_ms / 1000, (window_ms % 1000) * 1000000L };
+    while (nanosleep(&window, &window) != 0 && errno == EINTR) {
+    }
+    source_sample(&s);
+    render(out, &s);
+    source_free(&s);
+    return 0;
+}
+
+// -------------------- Exporter --------------------
+
+static struct {
+    int           running;
+    pthread_t     thread;
+    MetricsTarget target;
+    char          where[256];
+    int           port;           // bound port (HTTP)
+    int           listen_fd;      // -1 for the textfile target
+    int           stop_fd[2];
+    int           interval_ms;
+    Source        source;         // owned by the thread while it runs
+    atomic_ulong  served;         // scrapes answered or files written
+    atomic_int    last_error;     // errno of the last failed write, or 0
+} exporter = { .listen_fd = -1, .stop_fd = { -1, -1 } };
+
+static int send_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// Answer one HTTP/1.0 request: GET or HEAD of / or /metrics
+static void serve_client(int fd) {
+    struct timeval tv = { CLIENT_TIMEOUT_MS / 1000, (CLIENT_TIMEOUT_MS % 1000) * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    // Only the request line matters, but read the headers so the client
+    // does not see a reset when we close
+    char req[REQUEST_MAX];
+    size_t len = 0;
+    req[0] = '\0';
+    while (len < sizeof(req) - 1) {
+        ssize_t n = recv(fd, req + len, sizeof(req) - 1 - len, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        len += (size_t)n;
+        req[len] = '\0';
+        if (strstr(req, "\r\n\r\n") || strstr(req, "\n\n")) break;
+    }
+
+    const char *status = "200 OK";
+    char method[8], path[256];
+    if (sscanf(req, "%7s %255s", method, path) != 2) {
+        status = "400 Bad Request";
+    } else if (strcmp(method, "GET") != 0 && strcmp(method, "HEAD") != 0) {
+        status = "405 Method Not Allowed";
+    } else {
+        path[strcspn(path, "?")] = '\0';
+        if (strcmp(path, "/") != 0 && strcmp(path, "/metrics") != 0) {
+            status = "404 Not Found";
+        }
+    }
+
+    char *body = NULL;
+    size_t body_len = 0;
+    FILE *m = open_memstream(&body, &body_len);
+    if (!m) {
+        return;
+    }
+    if (status[0] == '2') {
+        render(m, &exporter.source);
+    } else {
+        fprintf(m, "%s\n", status + 4);
+    }
+    fclose(m);
+
+    char header[256];
+    int n = snprintf(header, sizeof(header),
+                     "HTTP/1.0 %s\r\n"
+                     "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                     "Content-Length: %zu\r\n"
+                     "Connection: close\r\n\r\n", status, body_len);
+    if (send_all(fd, header, (size_t)n) == 0 && strcmp(method, "HEAD") != 0) {
+        send_all(fd, body, body_len);
+    }
+    free(body);
+    atomic_fetch_add(&exporter.served, 1);
+}
+
+// Write next to the target and rename over it, so the textfile collector
+// never reads a partial file (it ignores names not ending in .prom)
+static void write_textfile(void) {
+    char tmp[sizeof(exporter.where) + 8];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", exporter.where);
+    FILE *f = fopen(tmp, "w");
+    if (!f) {
+        atomic_store(&exporter.last_error, errno);
+        return;
+    }
+    render(f, &exporter.source);
+    int failed = ferror(f);
+    if (fclose(f) != 0 || failed) {
+        atomic_store(&exporter.last_error, errno ? errno : EIO);
+        unlink(tmp);
+        return;
+    }
+    if (rename(tmp, exporter.where) != 0) {
+        atomic_store(&exporter.last_error, errno);
+        unlink(tmp);
+        return;
+    }
+    atomic_store(&exporter.last_error, 0);
+    atomic_fetch_add(&exporter.served, 1);
+}
+
+static void add_ms(struct timespec *t, long ms) {
+    t->tv_sec += ms / 1000;
+    t->tv_nsec += (ms % 1000) * 1000000L;
+    if (t->tv_nsec >= 1000000000L) {
+        t->tv_sec++;
+        t->tv_nsec -= 1000000000L;
+    }
+}
+
+static long ms_until(const struct timespec *t) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (t->tv_sec - now.tv_sec) * 1000 + (t->tv_nsec - now.tv_nsec) / 1000000;
+}
+
+// Sample on a fixed cadence; scrapes in between are answered from the
+// last sample, so their cost does not depend on the scrape rate
+static void *exporter_main(void *arg) {
+    (void)arg;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    add_ms(&next, exporter.interval_ms < FIRST_SAMPLE_MS ? exporter.interval_ms : FIRST_SAMPLE_MS);
+    if (exporter.target == METRICS_TEXTFILE) {
+        write_textfile();
+    }
+
+    for (;;) {
+        struct pollfd fds[2] = {
+            { .fd = exporter.stop_fd[0], .events = POLLIN },
+            { .fd = exporter.listen_fd, .events = POLLIN },
+        };
+        long wait = ms_until(&next);
+        int r = poll(fds, exporter.listen_fd >= 0 ? 2 : 1, wait > 0 ? (int)wait : 0);
+        if (r < 0 && errno != EINTR) break;
+        if (fds[0].revents) break;
+
+        if (ms_until(&next) <= 0) {
+            source_sample(&exporter.source);
+            if (exporter.target == METRICS_TEXTFILE) {
+                write_textfile();
+            }
+            add_ms(&next, exporter.interval_ms);
+            if (ms_until(&next) <= 0) {           // fell behind: skip, don't burst
+                clock_gettime(CLOCK_MONOTONIC, &next);
+                add_ms(&next, exporter.interval_ms);
+            }
+        }
+        if (r > 0 && (fds[1].revents & POLLIN)) {
+            int fd = accept4(exporter.listen_fd, NULL, NULL, SOCK_CLOEXEC);
+            if (fd >= 0) {
+                serve_client(fd);
+                close(fd);
+            }
+        }
+    }
+    return NULL;
+}
+
+static int listen_http(const char *port_arg) {
+    char *end;
+    long port = strtol(port_arg, &end, 10);
+    if (*port_arg == '\0' || *end != '\0' || port < 0 || port > 65535) {
+        errno = EINVAL;
+        return -1;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons((uint16_t)port) };
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);   // never reachable off-host
+    socklen_t addr_len = sizeof(addr);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0 ||
+        getsockname(fd, (struct sockaddr *)&addr, &addr_len) != 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    exporter.port = ntohs(addr.sin_port);
+    return fd;
+}
+
+static int listen_unix(const char *path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    // Replace a stale socket from an earlier run, but nothing else
+    struct stat st;
+    if (lstat(path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            errno = EEXIST;
+            return -1;
+        }
+        unlink(path);
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    mode_t old_mask = umask(077);                 // owner-only from the start
+    int rc = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(old_mask);
+    if (rc != 0 || listen(fd, 16) != 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+}
+
+static void close_exporter_fds(void) {
+    if (exporter.listen_fd >= 0) close(exporter.listen_fd);
+    if (exporter.stop_fd[0] >= 0) close(exporter.stop_fd[0]);
+    if (exporter.stop_fd[1] >= 0) close(exporter.stop_fd[1]);
+    exporter.listen_fd = exporter.stop_fd[0] = exporter.stop_fd[1] = -1;
+}
+
+int metrics_serve(MetricsTarget target, const char *where, int interval_ms) {
+    if (exporter.running) {
+        errno = EBUSY;
+        return -1;
+    }
+    if (strlen(where) >= sizeof(exporter.where)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    snprintf(exporter.where, sizeof(exporter.where), "%s", where);
+    exporter.target = target;
+    exporter.interval_ms = interval_ms;
+    atomic_store(&exporter.served, 0);
+    atomic_store(&exporter.last_error, 0);
+
+    if (target == METRICS_HTTP) {
+        exporter.listen_fd = listen_http(where);
+    } else if (target == METRICS_SOCKET) {
+        exporter.listen_fd = listen_unix(where);
+    }
+    int err;
+    if ((target != METRICS_TEXTFILE && exporter.listen_fd < 0) ||
+        pipe2(exporter.stop_fd, O_CLOEXEC) != 0) {
+        goto fail;
+    }
+    if (source_init(&exporter.source) != 0) {
+        goto fail;
+    }
+
+    // Signals stay with the main thread (Ctrl+C, SIGWINCH for the dashboard)
+    sigset_t block, old;
+    sigemptyset(&block);
+    sigaddset(&block, SIGINT);
+    sigaddset(&block, SIGTERM);
+    sigaddset(&block, SIGWINCH);
+    pthread_sigmask(SIG_BLOCK, &block, &old);
+    int rc = pthread_create(&exporter.thread, NULL, exporter_main, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (rc != 0) {
+        source_free(&exporter.source);
+        errno = rc;
+        goto fail;
+    }
+
+    exporter.running = 1;
+    static int registered = 0;
+    if (!registered) {
+        atexit(metrics_stop);
+        registered = 1;
+    }
+    return 0;
+
+fail:
+    err = errno;
+    if (target == METRICS_SOCKET && exporter.listen_fd >= 0) {
+        unlink(where);
+    }
+    close_exporter_fds();
+    errno = err;
+    return -1;
+}
+
+// After the thread has exited
+static void release_exporter(void) {
+    if (exporter.target == METRICS_SOCKET) {
+        unlink(exporter.where);
+    }
+    close_exporter_fds();
+    source_free(&exporter.source);
+    exporter.running = 0;
+}
+
+void metrics_stop(void) {
+    if (!exporter.running) {
+        return;
+    }
+    ssize_t w;
+    do {
+        w = write(exporter.stop_fd[1], "x", 1);
+    } while (w < 0 && errno == EINTR);
+    pthread_join(exporter.thread, NULL);
+    release_exporter();
+}
+
+// Whichever thread takes the signal, the exporter sees its stop pipe
+static void stop_on_signal(int sig) {
+    (void)sig;
+    int saved = errno;
+    ssize_t w = write(exporter.stop_fd[1], "x", 1);
+    (void)w;
+    errno = saved;
+}
+
+void metrics_run_foreground(void) {
+    if (!exporter.running) {
+        return;
+    }
+    struct sigaction sa, old_int, old_term;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = stop_on_signal;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGINT, &sa, &old_int);
+    sigaction(SIGTERM, &sa, &old_term);
+
+    pthread_join(exporter.thread, NULL);
+
+    sigaction(SIGINT, &old_int, NULL);
+    sigaction(SIGTERM, &old_term, NULL);
+    release_exporter();
+}
+
+int metrics_status(char *buf, size_t size) {
+    if (!exporter.running) {
+        return 0;
+    }
+    unsigned long served = atomic_load(&exporter.served);
+    int err = atomic_load(&exporter.last_error);
+    switch (exporter.target) {
+    case METRICS_HTTP:
+        snprintf(buf, size, "serving http://127.0.0.1:%d/metrics, sampling every %d ms, %lu scrape(s)",
+                 exporter.port, exporter.interval_ms, served);
+        break;
+    case METRICS_SOCKET:
+        snprintf(buf, size, "serving unix socket %s, sampling every %d ms, %lu scrape(s)",
+                 exporter.where, exporter.interval_ms, served);
+        break;
+    case METRICS_TEXTFILE:
+        snprintf(buf, size, "writing %s every %d ms, %lu write(s)%s%s",
+                 exporter.where, exporter.interval_ms, served,
+                 err ? ", last failed: " : "", err ? strerror(err) : "");
+        break;
+    }
+    return 1;
+}
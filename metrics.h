@@ -0,0 +1,57 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+// Prometheus exposition of the dashboard's collectors plus SecureSysCLI's
+// own counters. The exporter runs on one background thread without ncurses
+// and either answers HTTP scrapes (localhost TCP port or Unix socket) or
+// rewrites a file for node_exporter's textfile collector.
+
+// -------------------- Counters (any thread) --------------------
+
+typedef enum {
+    METRICS_CRYPTO_ENCRYPT,
+    METRICS_CRYPTO_DECRYPT,
+    METRICS_CRYPTO_CHECKSUM,
+    METRICS_CRYPTO_OPS
+} MetricsCryptoOp;
+
+// A command (foreground or background task) finished with `status`
+void metrics_command_finished(int status);
+
+// A job was registered / forgotten (see jobs.h)
+void metrics_job_added(int is_task);
+void metrics_job_removed(void);
+
+// Plaintext bytes run through encrypt, decrypt or checksum
+void metrics_crypto_bytes(MetricsCryptoOp op, size_t bytes);
+
+// -------------------- Exposition --------------------
+
+// Sample the system over `window_ms` (rates need two samples) and write
+// one exposition to `out`. Returns 0, or -1 if /proc is unreadable.
+int metrics_print(FILE *out, int window_ms);
+
+typedef enum {
+    METRICS_HTTP,                 // 127.0.0.1:<port>
+    METRICS_SOCKET,               // HTTP over a Unix socket at <path>
+    METRICS_TEXTFILE              // <path>, replaced atomically each interval
+} MetricsTarget;
+
+// Start the exporter thread, sampling every `interval_ms`. Returns 0, or -1
+// with errno set (EBUSY if an exporter is already running).
+int metrics_serve(MetricsTarget target, const char *where, int interval_ms);
+
+// Stop the exporter and remove its socket (registered with atexit)
+void metrics_stop(void);
+
+// Batch mode: keep serving on the calling thread until SIGINT or SIGTERM,
+// then stop the exporter as metrics_stop() does
+void metrics_run_foreground(void);
+
+// Describe the running exporter into buf; returns 0 if none is running
+int metrics_status(char *buf, size_t size);
+
+#endif
@@ -0,0 +1,226 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "path_cache.h"
+
+#define PATH_CACHE_BUCKETS 128      // power of two; a session runs few distinct programs
+
+// Search path execvp() uses when PATH is unset
+#define DEFAULT_PATH "/bin:/usr/bin"
+
+typedef struct PathEntry {
+    struct PathEntry *next;
+    unsigned long     hits;
+    char             *path;
+    char              name[];
+} PathEntry;
+
+static struct {
+    pthread_mutex_t lock;
+    PathEntry      *buckets[PATH_CACHE_BUCKETS];
+    size_t          count;
+    char           *path_env;       // PATH the entries were resolved against
+} cache = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static unsigned int bucket_of(const char *name) {
+    unsigned int h = 2166136261u;   // FNV-1a
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        h = (h ^ *p) * 16777619u;
+    }
+    return (h ^ (h >> 16)) & (PATH_CACHE_BUCKETS - 1);
+}
+
+static PathEntry **find_slot(const char *name) {
+    PathEntry **slot = &cache.buckets[bucket_of(name)];
+    while (*slot && strcmp((*slot)->name, name) != 0) {
+        slot = &(*slot)->next;
+    }
+    return slot;
+}
+
+// Caller holds the lock
+static void clear_locked(void) {
+    for (int i = 0; i < PATH_CACHE_BUCKETS; i++) {
+        PathEntry *e = cache.buckets[i];
+        while (e) {
+            PathEntry *next = e->next;
+            free(e->path);
+            free(e);
+            e = next;
+        }
+        cache.buckets[i] = NULL;
+    }
+    cache.count = 0;
+}
+
+// Forget everything if PATH is not what the entries were resolved against.
+// Caller holds the lock.
+static void check_path_env(const char *env) {
+    if (cache.path_env && strcmp(cache.path_env, env) == 0) {
+        return;
+    }
+    clear_locked();
+    free(cache.path_env);
+    cache.path_env = strdup(env);
+}
+
+// Search the PATH directories the way execvp() does: the first regular file
+// we may execute wins; a match we may not execute only matters (EACCES) if
+// nothing later on PATH is executable. Sets *relative if the match came from
+// a relative directory ("" or "."), which depends on the working directory.
+static int search_path(const char *env, const char *name, char *out, size_t size, int *relative) {
+    int denied = 0;
+    const char *dir = env;
+    for (;;) {
+        const char *end = strchrnul(dir, ':');
+        size_t dir_len = (size_t)(end - dir);
+        char candidate[PATH_MAX];
+        int n;
+        if (dir_len == 0) {
+            n = snprintf(candidate, sizeof(candidate), "%s", name);
+        } else {
+            n = snprintf(candidate, sizeof(candidate), "%.*s/%s", (int)dir_len, dir, name);
+        }
+        if (n > 0 && (size_t)n < sizeof(candidate)) {
+            struct stat st;
+            if (stat(candidate, &st) == 0 && S_ISREG(st.st_mode)) {
+                if (access(candidate, X_OK) == 0) {
+                    if ((size_t)n >= size) {
+                        errno = ENAMETOOLONG;
+                        return -1;
+                    }
+                    memcpy(out, candidate, (size_t)n + 1);
+                    *relative = dir_len == 0 || dir[0] != '/';
+                    return 0;
+                }
+                denied = 1;
+            }
+        }
+        if (*end == '\0') {
+            break;
+        }
+        dir = end + 1;
+    }
+    errno = denied ? EACCES : ENOENT;
+    return -1;
+}
+
+int path_cache_lookup(const char *name, char *path, size_t size) {
+    if (name[0] == '\0') {
+        errno = ENOENT;
+        return -1;
+    }
+    if (strchr(name, '/')) {
+        if (strlen(name) >= size) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        strcpy(path, name);
+        return 0;
+    }
+
+    const char *env = getenv("PATH");
+    if (!env) {
+        env = DEFAULT_PATH;
+    }
+
+    pthread_mutex_lock(&cache.lock);
+    check_path_env(env);
+    PathEntry *e = *find_slot(name);
+    if (e && strlen(e->path) < size) {
+        e->hits++;
+        strcpy(path, e->path);
+        pthread_mutex_unlock(&cache.lock);
+        return 1;
+    }
+    pthread_mutex_unlock(&cache.lock);
+
+    // Search without the lock; two threads racing on a new name both find it
+    int relative = 0;
+    if (search_path(env, name, path, size, &relative) != 0) {
+        return -1;
+    }
+    if (relative) {
+        return 0;                       // "./tool" means something else after cd
+    }
+
+    size_t name_len = strlen(name);
+    PathEntry *fresh = malloc(sizeof(PathEntry) + name_len + 1);
+    char *copy = strdup(path);
+    if (!fresh || !copy) {
+        free(fresh);
+        free(copy);
+        return 0;                       // still launchable, just not remembered
+    }
+    memcpy(fresh->name, name, name_len + 1);
+    fresh->path = copy;
+    fresh->hits = 1;
+
+    pthread_mutex_lock(&cache.lock);
+    check_path_env(env);
+    PathEntry **slot = find_slot(name);
+    if (*slot) {
+        // Another thread got here first
+        (*slot)->hits++;
+        free(copy);
+        free(fresh);
+    } else {
+        fresh->next = NULL;
+        *slot = fresh;
+        cache.count++;
+    }
+    pthread_mutex_unlock(&cache.lock);
+    return 0;
+}
+
+void path_cache_forget(const char *name) {
+    pthread_mutex_lock(&cache.lock);
+    PathEntry **slot = find_slot(name);
+    PathEntry *e = *slot;
+    if (e) {
+        *slot = e->next;
+        free(e->path);
+        free(e);
+        cache.count--;
+    }
+    pthread_mutex_unlock(&cache.lock);
+}
+
+void path_cache_clear(void) {
+    pthread_mutex_lock(&cache.lock);
+    clear_locked();
+    pthread_mutex_unlock(&cache.lock);
+}
+
+static int by_hits(const void *a, const void *b) {
+    const PathEntry *x = *(PathEntry *const *)a, *y = *(PathEntry *const *)b;
+    if (x->hits != y->hits) {
+        return x->hits < y->hits ? 1 : -1;
+    }
+    return strcmp(x->name, y->name);
+}
+
+void path_cache_each(void (*fn)(const char *name, const char *path,
+                                unsigned long hits, void *arg), void *arg) {
+    pthread_mutex_lock(&cache.lock);
+    PathEntry **sorted = cache.count ? malloc(cache.count * sizeof(PathEntry *)) : NULL;
+    size_t n = 0;
+    for (int i = 0; sorted && i < PATH_CACHE_BUCKETS; i++) {
+        for (PathEntry *e = cache.buckets[i]; e; e = e->next) {
+            sorted[n++] = e;
+        }
+    }
+    if (n > 1) {
+        qsort(sorted, n, sizeof(PathEntry *), by_hits);
+    }
+    for (size_t i = 0; i < n; i++) {
+        fn(sorted[i]->name, sorted[i]->path, sorted[i]->hits, arg);
+    }
+    free(sorted);
+    pthread_mutex_unlock(&cache.lock);
+}
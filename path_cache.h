@@ -0,0 +1,29 @@
+#ifndef PATH_CACHE_H
+#define PATH_CACHE_H
+
+#include <stddef.h>
+
+// Program name -> absolute path cache for the launcher, like bash's `hash`.
+// A name is searched on PATH once; later launches exec the remembered path
+// directly instead of trying execve() in every PATH directory. The table is
+// dropped when PATH changes, and the launcher forgets an entry whose path
+// has disappeared (exec fails with ENOENT) and searches again.
+// Safe to call from worker threads.
+
+// Resolve `name` into `path`. Names containing '/' are used as given.
+// Returns 1 if the path came from the cache, 0 if it was just searched for
+// (or needs no search), -1 with errno set (ENOENT, EACCES, ENAMETOOLONG) if
+// there is no such program.
+int path_cache_lookup(const char *name, char *path, size_t size);
+
+// Drop one name, so the next lookup searches PATH again
+void path_cache_forget(const char *name);
+
+// Drop every name (hash -r)
+void path_cache_clear(void);
+
+// Call fn for every remembered program, most used first
+void path_cache_each(void (*fn)(const char *name, const char *path,
+                                unsigned long hits, void *arg), void *arg);
+
+#endif
@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "pipeline.h"
+#include "commands.h"
+#include "cli_output.h"
+
+int pipeline_parse(Pipeline *pl, int argc, char *argv[], int start) {
+    pl->count = 0;
+    int stage_start = start;
+
+    for (int i = start; i <= argc; i++) {
+        int at_end = (i == argc);
+        if (!at_end && strcmp(argv[i], "|") != 0) {
+            continue;
+        }
+
+        if (i == stage_start) {
+            cli_printf("Syntax error: empty pipeline stage\n");
+            return -1;
+        }
+        if (pl->count == MAX_PIPELINE_STAGES) {
+            cli_printf("Pipeline too long (max %d stages)\n", MAX_PIPELINE_STAGES);
+            return -1;
+        }
+
+        pl->stages[pl->count++] = &argv[stage_start];
+        if (!at_end) {
+            argv[i] = NULL;   // terminate this stage's argv
+        }
+        stage_start = i + 1;
+    }
+    return 0;
+}
+
+int pipeline_is_safe(const Pipeline *pl) {
+    for (int s = 0; s < pl->count; s++) {
+        for (char **arg = pl->stages[s]; *arg; arg++) {
+            if (!is_input_safe(*arg)) {
+                cli_printf("⚠️  Unsafe characters detected in argument: %s\n", *arg);
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+// Kill and reap stages that were started before a later stage failed
+static void abort_stages(const pid_t pids[], int started) {
+    for (int i = 0; i < started; i++) {
+        kill(pids[i], SIGTERM);
+    }
+    for (int i = 0; i < started; i++) {
+        waitpid(pids[i], NULL, 0);
+    }
+}
+
+int pipeline_launch(const Pipeline *pl, const LaunchOptions *base, pid_t pids[]) {
+    int prev_read = -1;
+
+    for (int s = 0; s < pl->count; s++) {
+        int fds[2] = { -1, -1 };
+        int last = (s == pl->count - 1);
+
+        // Close-on-exec so only the intended ends survive into each child
+        if (!last && pipe2(fds, O_CLOEXEC) != 0) {
+            cli_perror("pipe2");
+            if (prev_read >= 0) close(prev_read);
+            abort_stages(pids, s);
+            return -1;
+        }
+
+        LaunchOptions opts = *base;
+        if (prev_read >= 0) opts.in_fd = prev_read;
+        if (!last) opts.out_fd = fds[1];
+        if (base->detach && pl->count > 1) {
+            opts.pgid = (s == 0) ? 0 : pids[0];
+        }
+
+        pid_t pid = launch_program(pl->stages[s], &opts);
+
+        if (prev_read >= 0) close(prev_read);
+        if (!last) close(fds[1]);
+        prev_read = last ? -1 : fds[0];
+
+        if (pid < 0) {
+            if (prev_read >= 0) close(prev_read);
+            abort_stages(pids, s);
+            return -1;
+        }
+        pids[s] = pid;
+    }
+    return 0;
+}
+
+int pipeline_wait_foreground(const pid_t pids[], int count) {
+    int status = -1;
+    for (int i = 0; i < count; i++) {
+        status = launch_wait_foreground(pids[i]);
+    }
+    return status;
+}
+
+void pipeline_describe(const Pipeline *pl, char *buf, size_t size) {
+    size_t len = 0;
+    buf[0] = '\0';
+    for (int s = 0; s < pl->count && len < size; s++) {
+        len += snprintf(buf + len, size - len, "%s%s", s ? " | " : "", pl->stages[s][0]);
+    }
+}
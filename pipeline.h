@@ -0,0 +1,38 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include "launcher.h"
+
+#define MAX_PIPELINE_STAGES 16
+
+// A command line split at standalone "|" tokens.
+// Each stage points into the caller's argv and is NULL-terminated.
+typedef struct {
+    char **stages[MAX_PIPELINE_STAGES];
+    int    count;
+} Pipeline;
+
+// Split argv[start..argc) into stages. The "|" slots in argv are replaced
+// with NULL. Returns 0, or -1 after printing an error (empty stage, too
+// many stages). argv[argc] must be NULL.
+int pipeline_parse(Pipeline *pl, int argc, char *argv[], int start);
+
+// Returns 1 if no stage argument contains shell metacharacters
+int pipeline_is_safe(const Pipeline *pl);
+
+// Start every stage, connecting stdout of each to stdin of the next with
+// pipe2(). No shell is involved. With base->detach the whole pipeline is
+// put in a new process group led by the first stage. Fills pids[] and
+// returns 0; on failure the stages already started are killed and reaped
+// and -1 is returned.
+int pipeline_launch(const Pipeline *pl, const LaunchOptions *base, pid_t pids[]);
+
+// Wait for all stages in the foreground. Returns the last stage's status.
+int pipeline_wait_foreground(const pid_t pids[], int count);
+
+// "prog1 | prog2 | prog3" (program names only)
+void pipeline_describe(const Pipeline *pl, char *buf, size_t size);
+
+#endif
@@ -1,55 +1,37 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <unistd.h>
 #include <sys/wait.h>
 #include <signal.h>
 #include <sys/types.h>
-#include <fcntl.h>
-#include "auth.h"
 #include "logger.h"
 #include "signals.h"
+#include "resource_limits.h"
+#include "launcher.h"
+#include "pipeline.h"
+#include "jobs.h"
+#include "tasks.h"
+#include "cli_output.h"
+#include "path_cache.h"
 
-#define MAX_JOBS 100
-
-typedef struct {
-    pid_t pid;
-    char  cmd[256];
-    int   running;
-} Job;
-
-static Job jobs[MAX_JOBS];
-static int job_count = 0;
-
-// Internal job management functions
-static void add_job(pid_t pid, const char *cmd) {
-    if (job_count < MAX_JOBS) {
-        jobs[job_count].pid = pid;
-        strncpy(jobs[job_count].cmd, cmd, sizeof(jobs[job_count].cmd) - 1);
-        jobs[job_count].cmd[sizeof(jobs[job_count].cmd) - 1] = '\0';
-        jobs[job_count].running = 1;
-        job_count++;
+// Register a launched job and report it the way bash does: "[id] pid"
+static void add_job(const pid_t pids[], int npids, const char *cmd, const ResourceLimits *limits) {
+    char summary[128];
+    resource_limits_format(limits, summary, sizeof(summary));
+    Job *job = job_add(pids, npids, cmd, summary);
+    if (job) {
+        cli_printf("[%d] %d started: %s\n", job->id, job->pid, cmd);
     } else {
-        printf("Job table full, cannot add more processes\n");
-    }
-}
-
-static void remove_job(pid_t pid) {
-    for (int i = 0; i < job_count; i++) {
-        if (jobs[i].pid == pid) {
-            for (int j = i; j < job_count - 1; j++) {
-                jobs[j] = jobs[j + 1];
-            }
-            job_count--;
-            break;
-        }
+        cli_printf("Out of memory, job %d is not tracked\n", pids[0]);
     }
 }
 
 // Track jobs when run is background
 void cmd_run(int argc, char *argv[]) {
     if (argc < 2) {
-        printf("Usage: run <program> [&]\n");
+        cli_printf("Usage: run " RESOURCE_LIMITS_USAGE " <program> [args...] [&]\n");
         return;
     }
 
@@ -60,48 +42,40 @@ void cmd_run(int argc, char *argv[]) {
         argc--;
     }
 
-    pid_t pid = fork();
-    if (pid < 0) {
-        perror("fork");
+    ResourceLimits limits;
+    resource_limits_init(&limits);
+    int first = resource_limits_parse(&limits, argc, argv, 1);
+    if (first < 0) {
+        return;
+    }
+    if (first >= argc) {
+        cli_printf("Usage: run " RESOURCE_LIMITS_USAGE " <program> [args...] [&]\n");
         return;
     }
 
-    if (pid == 0) {
-        // Child process - restore default signal handlers
-        signal(SIGINT, SIG_DFL);
-        signal(SIGTERM, SIG_DFL);
-        if (background) {
-            setsid();
-            int null_fd = open("/dev/null", O_RDWR);
-            if (null_fd >= 0) {
-                dup2(null_fd, STDIN_FILENO);
-                dup2(null_fd, STDOUT_FILENO);
-                dup2(null_fd, STDERR_FILENO);
-                if (null_fd > STDERR_FILENO) {
-                    close(null_fd);
-                }
-            }
-        }
-        execvp(argv[1], &argv[1]);
-        perror("execvp");
-        exit(1);
-    } else if (pid > 0) {
-        if (background) {
-            printf("[bg] %d started: %s\n", pid, argv[1]);
-            add_job(pid, argv[1]);
-        } else {
-            // Foreground process - set global variable so signal handler can forward SIGINT
-            foreground_pid = pid;
-            
-            int status;
-            waitpid(pid, &status, 0);
-            
-            // Clear foreground PID after process completes
-            foreground_pid = 0;
-            
-            if (WIFSIGNALED(status)) {
-                printf("\nProcess terminated by signal %d\n", WTERMSIG(status));
-            }
+    Pipeline pl;
+    if (pipeline_parse(&pl, argc, argv, first) != 0) {
+        return;
+    }
+
+    LaunchOptions opts;
+    launch_options_init(&opts);
+    opts.detach = background;
+    opts.limits = &limits;
+    pid_t pids[MAX_PIPELINE_STAGES];
+    if (pipeline_launch(&pl, &opts, pids) != 0) {
+        return;
+    }
+
+    if (background) {
+        char desc[256];
+        pipeline_describe(&pl, desc, sizeof(desc));
+        add_job(pids, pl.count, desc, &limits);
+    } else {
+        // Foreground process - signal handler forwards SIGINT while we wait
+        int status = pipeline_wait_foreground(pids, pl.count);
+        if (status >= 0 && WIFSIGNALED(status)) {
+            cli_printf("\nProcess terminated by signal %d\n", WTERMSIG(status));
         }
     }
 }
@@ -109,124 +83,231 @@ void cmd_run(int argc, char *argv[]) {
 // pslist (like jobs)
 void cmd_pslist(int argc, char *argv[]) {
     (void)argc; (void)argv;
-    for (int i = 0; i < job_count; i++) {
-        if (kill(jobs[i].pid, 0) == 0) {
-            printf("[%d] PID %d running %s\n", i, jobs[i].pid, jobs[i].cmd);
+    Job *job = job_first();
+    while (job) {
+        Job *next = job->next;
+        if (job->task) {
+            // Finished tasks stay listed until fgproc collects their output
+            char state[32];
+            task_describe(job->task, state, sizeof(state));
+            cli_printf("[%d] task %s %s\n", job->id, state, job->cmd);
+        } else if (job_poll(job) > 0) {
+            if (job->limits[0]) {
+                cli_printf("[%d] PID %d running %s [%s]\n", job->id, job->pid, job->cmd, job->limits);
+            } else {
+                cli_printf("[%d] PID %d running %s\n", job->id, job->pid, job->cmd);
+            }
         } else {
-            printf("[%d] PID %d (terminated)\n", i, jobs[i].pid);
+            // Reported once, then forgotten so the table does not fill up
+            cli_printf("[%d] PID %d (terminated)\n", job->id, job->pid);
+            job_remove(job);
         }
+        job = next;
+    }
+}
+
+// Wait for a built-in task and print the output it captured
+static void fg_task(Job *job) {
+    Task *task = job->task;
+    if (!task_finished(task)) {
+        cli_printf("Waiting for job %d (%s)...\n", job->id, job->cmd);
+        fflush(cli_out());
+        task_wait(task);
+    }
+
+    if (task->output_len > 0) {
+        fwrite(task->output, 1, task->output_len, cli_out());
+    }
+    if (atomic_load(&task->state) == TASK_CANCELLED) {
+        cli_printf("Job %d was cancelled.\n", job->id);
     }
+
+    task_free(task);
+    job_remove(job);
 }
 
 // fgproc (like fg)
 void cmd_fgproc(int argc, char *argv[]) {
     if (argc < 2) {
-        printf("Usage: fgproc <jobid>\n");
+        cli_printf("Usage: fgproc <jobid>\n");
         return;
     }
 
-    int jid = atoi(argv[1]);
-    if (jid < 0 || jid >= job_count || !jobs[jid].running) {
-        printf("No such job: %d\n", jid);
+    int jid = job_parse_id(argv[1]);
+    Job *job = job_find_by_id(jid);
+    if (job && job->task) {
+        fg_task(job);
+        return;
+    }
+    if (!job || !job->running) {
+        cli_printf("No such job: %s\n", argv[1]);
         return;
     }
 
-    pid_t pid = jobs[jid].pid;
-    
+    pid_t pid = job->pid;
+
     // Check if process is still running
-    if (kill(pid, 0) != 0) {
-        printf("Process %d (PID %d) is no longer running.\n", jid, pid);
-        jobs[jid].running = 0;
-        remove_job(pid);
+    if (job_poll(job) == 0) {
+        cli_printf("Process %d (PID %d) is no longer running.\n", jid, pid);
+        job_remove(job);
         return;
     }
     
-    printf("Bringing job %d (PID %d) to foreground...\n", jid, pid);
-    printf("Note: Output may not be visible (redirected when backgrounded). Press Ctrl+C to terminate.\n");
+    cli_printf("Bringing job %d (PID %d) to foreground...\n", jid, pid);
+    cli_printf("Note: Output may not be visible (redirected when backgrounded). Press Ctrl+C to terminate.\n");
     
-    // Set global variable so signal handler can forward SIGINT
-    foreground_pid = pid;
-    
-    int status;
-    waitpid(pid, &status, 0);
-    
-    // Clear foreground PID after process completes
-    foreground_pid = 0;
-    
-    if (WIFSIGNALED(status)) {
-        printf("\nProcess terminated by signal %d\n", WTERMSIG(status));
+    // Wait for the stages that have not been reaped yet
+    int status = 0;
+    for (int i = 0; i < job->npids; i++) {
+        if (!(job->reaped & (1u << i))) {
+            status = launch_wait_foreground(job->pids[i]);
+        }
+    }
+
+    if (status < 0) {
+        cli_perror("waitpid");
+    } else if (WIFSIGNALED(status)) {
+        cli_printf("\nProcess terminated by signal %d\n", WTERMSIG(status));
     } else if (WIFEXITED(status)) {
-        printf("Process exited with status %d\n", WEXITSTATUS(status));
+        cli_printf("Process exited with status %d\n", WEXITSTATUS(status));
     }
     
-    jobs[jid].running = 0;   // mark as stopped/finished
-    remove_job(pid);
+    job_remove(job);
 }
 
 // bgproc (like bg)
 void cmd_bgproc(int argc, char *argv[]) {
     if (argc < 2) {
-        printf("Usage: bgproc <program> [args...]\n");
+        cli_printf("Usage: bgproc " RESOURCE_LIMITS_USAGE " <program> [args...]\n");
         return;
     }
 
-    pid_t pid = fork();
-    if (pid == 0) {
-        // Child process
-        setsid();  // run independently
-        int null_fd = open("/dev/null", O_RDWR);
-        if (null_fd >= 0) {
-            dup2(null_fd, STDIN_FILENO);
-            dup2(null_fd, STDOUT_FILENO);
-            dup2(null_fd, STDERR_FILENO);
-            if (null_fd > STDERR_FILENO) {
-                close(null_fd);
-            }
-        }
-        execvp(argv[1], &argv[1]);
-        perror("execvp");
-        exit(1);
-    } else if (pid > 0) {
-        printf("[bg] %d started: %s\n", pid, argv[1]);
-        add_job(pid, argv[1]);   // track in jobs[] array
-    } else {
-        perror("fork");
+    ResourceLimits limits;
+    resource_limits_init(&limits);
+    int first = resource_limits_parse(&limits, argc, argv, 1);
+    if (first < 0) {
+        return;
     }
+    if (first >= argc) {
+        cli_printf("Usage: bgproc " RESOURCE_LIMITS_USAGE " <program> [args...]\n");
+        return;
+    }
+
+    Pipeline pl;
+    if (pipeline_parse(&pl, argc, argv, first) != 0) {
+        return;
+    }
+
+    LaunchOptions opts;
+    launch_options_init(&opts);
+    opts.detach = 1;
+    opts.limits = &limits;
+    pid_t pids[MAX_PIPELINE_STAGES];
+    if (pipeline_launch(&pl, &opts, pids) == 0) {
+        char desc[256];
+        pipeline_describe(&pl, desc, sizeof(desc));
+        add_job(pids, pl.count, desc, &limits);   // track in the job table
+    }
+}
+
+// cancel <jobid> - stop a background built-in task
+void cmd_cancel(int argc, char *argv[]) {
+    if (argc < 2) {
+        cli_printf("Usage: cancel <jobid>\n");
+        return;
+    }
+
+    Job *job = job_find_by_id(job_parse_id(argv[1]));
+    if (!job) {
+        cli_printf("No such job: %s\n", argv[1]);
+        return;
+    }
+    if (!job->task) {
+        cli_printf("Job %d is a process; use killproc %d\n", job->id, job->pid);
+        return;
+    }
+    if (task_finished(job->task)) {
+        cli_printf("Job %d has already finished.\n", job->id);
+        return;
+    }
+
+    task_cancel(job->task);
+    cli_printf("Cancelling job %d (%s)\n", job->id, job->cmd);
+    log_command("cancel");
 }
 
 // killproc (like kill)
 void cmd_killproc(int argc, char *argv[]) {
     if (argc < 2) {
-        printf("Usage: killproc <pid>\n");
+        cli_printf("Usage: killproc <pid>\n");
         return;
     }
 
-    if (!is_admin()) {
-        printf("🚫  Permission denied: only admin can kill processes.\n");
-        log_command("UNAUTHORIZED killproc attempt");
+    pid_t pid = atoi(argv[1]);
+    if (pid <= 0) {
+        cli_printf("Invalid PID: %s\n", argv[1]);
         return;
     }
 
-    pid_t pid = atoi(argv[1]);
-    if (kill(pid, SIGTERM) == 0) {
+    // Killing a pipeline job's leader takes down its whole process group
+    Job *job = job_find_by_pid(pid);
+    pid_t target = (job && job->npids > 1 && job->pid == pid) ? -pid : pid;
+
+    if (kill(target, SIGTERM) == 0) {
         int status;
-        waitpid(pid, &status, 0);  // reap the process to avoid zombie
-        printf("Process %d terminated.\n", pid);
+        if (target < 0) {
+            for (int i = 0; i < job->npids; i++) {
+                waitpid(job->pids[i], &status, 0);  // reap every stage
+            }
+        } else {
+            waitpid(pid, &status, 0);  // reap the process to avoid zombie
+        }
+        cli_printf("Process %d terminated.\n", pid);
         log_command("killproc");
 
-        // Remove from job table
-        for (int i = 0; i < job_count; i++) {
-            if (jobs[i].pid == pid) {
-                // shift others down
-                for (int j = i; j < job_count - 1; j++) {
-                    jobs[j] = jobs[j + 1];
-                }
-                job_count--;
-                break;
-            }
+        // Remove from job table once no stage is left
+        if (job && job_poll(job) == 0) {
+            job_remove(job);
         }
     } else {
-        perror("kill failed");
+        cli_perror("kill failed");
+    }
+}
+
+static void print_hashed(const char *name, const char *path, unsigned long hits, void *arg) {
+    int *shown = arg;
+    if ((*shown)++ == 0) {
+        cli_printf("hits\tcommand\n");
     }
+    cli_printf("%4lu\t%s (%s)\n", hits, path, name);
 }
 
+// hash [-l|-r|program...] (like bash's hash) - the PATH lookup cache
+void cmd_hash(int argc, char *argv[]) {
+    if (argc < 2 || strcmp(argv[1], "-l") == 0) {
+        int shown = 0;
+        path_cache_each(print_hashed, &shown);
+        if (shown == 0) {
+            cli_printf("hash: hash table empty\n");
+        }
+        return;
+    }
+    if (strcmp(argv[1], "-r") == 0) {
+        path_cache_clear();
+        return;
+    }
+
+    // Look programs up now so later launches skip the PATH search
+    for (int i = 1; i < argc; i++) {
+        char path[PATH_MAX];
+        if (argv[i][0] == '-') {
+            cli_printf("Usage: hash [-l|-r|program...]\n");
+            cli_set_status(2);
+            return;
+        }
+        if (path_cache_lookup(argv[i], path, sizeof(path)) < 0) {
+            fprintf(cli_err(), "hash: %s: not found\n", argv[i]);
+            cli_set_status(1);
+        }
+    }
+}
@@ -7,6 +7,8 @@ void cmd_pslist(int argc, char *argv[]);
 void cmd_fgproc(int argc, char *argv[]);
 void cmd_bgproc(int argc, char *argv[]);
 void cmd_killproc(int argc, char *argv[]);
+void cmd_cancel(int argc, char *argv[]);
+void cmd_hash(int argc, char *argv[]);
 
 #endif
 
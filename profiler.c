@@ -0,0 +1,486 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include "profiler.h"
+#include "cli_output.h"
+
+#define PROFILE_TOP_LINES 20
+#define PROFILE_TEXT_MAX 60     // line text kept for the report and the stacks
+
+// One distinct stack of frames: a script, or a line reached through the
+// frames above it. Inclusive times skip runs nested inside another run of
+// the same line, so summing them per line does not count recursion twice.
+typedef struct ProfileNode {
+    struct ProfileNode *parent;
+    const char         *file;         // interned
+    int                 line;         // 0 = the whole script
+    char               *text;
+    long                count;
+    int64_t             self_us;      // wall time not spent in nested frames
+    int64_t             wall_us, cpu_us, child_us;
+} ProfileNode;
+
+typedef struct {
+    const char *name;                 // registry name, not copied
+    long        count;
+    int64_t     wall_us, cpu_us, child_us;
+} CommandStat;
+
+typedef struct {
+    const char *file;
+    int         line;
+    const char *text;
+    long        count;
+    int64_t     self_us, wall_us, cpu_us, child_us;
+} LineStat;
+
+static struct {
+    pthread_mutex_t lock;
+    int             active;
+    ProfileNode   **nodes;            // creation order
+    int             nnodes, nodes_cap;
+    ProfileNode   **index;            // open addressing by (parent, file, line)
+    size_t          index_cap;
+    char          **files;
+    int             nfiles, files_cap;
+    CommandStat    *commands;
+    int             ncommands, commands_cap;
+} prof = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static __thread ProfileFrame *current_frame = NULL;
+
+static int grow(void **array, int *cap, int count, size_t elem) {
+    if (count < *cap) {
+        return 0;
+    }
+    int new_cap = *cap ? *cap * 2 : 16;
+    void *p = realloc(*array, (size_t)new_cap * elem);
+    if (!p) {
+        return -1;
+    }
+    *array = p;
+    *cap = new_cap;
+    return 0;
+}
+
+static int64_t timespec_us(const struct timespec *t) {
+    return (int64_t)t->tv_sec * 1000000 + t->tv_nsec / 1000;
+}
+
+static int64_t timeval_us(const struct timeval *t) {
+    return (int64_t)t->tv_sec * 1000000 + t->tv_usec;
+}
+
+// CPU time of every child process the whole process has reaped so far
+static int64_t children_us(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_CHILDREN, &ru);
+    return timeval_us(&ru.ru_utime) + timeval_us(&ru.ru_stime);
+}
+
+static void frame_start(ProfileFrame *f) {
+    f->command = NULL;
+    f->nested_us = 0;
+    clock_gettime(CLOCK_MONOTONIC, &f->wall0);
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &f->cpu0);
+    f->child_us = 0;
+}
+
+static void frame_times(const ProfileFrame *f, int64_t *wall, int64_t *cpu, int64_t *child) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    *wall = timespec_us(&now) - timespec_us(&f->wall0);
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    *cpu = timespec_us(&now) - timespec_us(&f->cpu0);
+    *child = f->child_us;
+}
+
+// ---------------------------------------------------------------------------
+// Calling-context tree (prof.lock held)
+// ---------------------------------------------------------------------------
+
+static const char *intern_file(const char *name) {
+    for (int i = 0; i < prof.nfiles; i++) {
+        if (strcmp(prof.files[i], name) == 0) {
+            return prof.files[i];
+        }
+    }
+    char *copy = strdup(name);
+    if (!copy || grow((void **)&prof.files, &prof.files_cap, prof.nfiles, sizeof(char *)) != 0) {
+        free(copy);
+        return NULL;
+    }
+    prof.files[prof.nfiles++] = copy;
+    return copy;
+}
+
+static size_t node_hash(const ProfileNode *parent, const char *file, int line) {
+    uint64_t h = (uint64_t)(uintptr_t)parent * 0x9e3779b97f4a7c15ull;
+    h ^= (uint64_t)(uintptr_t)file + 0x632be59bd9b4e019ull + (h << 6) + (h >> 2);
+    h ^= (uint64_t)line * 0xff51afd7ed558ccdull;
+    return (size_t)(h ^ (h >> 29));
+}
+
+static int index_grow(void) {
+    size_t cap = prof.index_cap ? prof.index_cap * 2 : 256;
+    ProfileNode **index = calloc(cap, sizeof(*index));
+    if (!index) {
+        return -1;
+    }
+    for (int i = 0; i < prof.nnodes; i++) {
+        ProfileNode *n = prof.nodes[i];
+        size_t slot = node_hash(n->parent, n->file, n->line) & (cap - 1);
+        while (index[slot]) {
+            slot = (slot + 1) & (cap - 1);
+        }
+        index[slot] = n;
+    }
+    free(prof.index);
+    prof.index = index;
+    prof.index_cap = cap;
+    return 0;
+}
+
+// Stack labels are separated by ';' and the report prints one line per entry
+static char *copy_text(const char *text) {
+    size_t len = strlen(text);
+    size_t keep = len > PROFILE_TEXT_MAX ? PROFILE_TEXT_MAX : len;
+    char *copy = malloc(keep + 4);
+    if (!copy) {
+        return NULL;
+    }
+    for (size_t i = 0; i < keep; i++) {
+        char c = text[i];
+        copy[i] = c == ';' ? ',' : ((unsigned char)c < ' ' ? ' ' : c);
+    }
+    strcpy(copy + keep, len > keep ? "..." : "");
+    return copy;
+}
+
+static ProfileNode *find_node(ProfileNode *parent, const char *file, int line, const char *text) {
+    if ((size_t)(prof.nnodes + 1) * 2 > prof.index_cap && index_grow() != 0) {
+        return NULL;
+    }
+    size_t slot = node_hash(parent, file, line) & (prof.index_cap - 1);
+    for (ProfileNode *n; (n = prof.index[slot]) != NULL; slot = (slot + 1) & (prof.index_cap - 1)) {
+        if (n->parent == parent && n->file == file && n->line == line) {
+            return n;
+        }
+    }
+
+    ProfileNode *n = calloc(1, sizeof(*n));
+    if (!n || grow((void **)&prof.nodes, &prof.nodes_cap, prof.nnodes, sizeof(*prof.nodes)) != 0 ||
+        (text && (n->text = copy_text(text)) == NULL)) {
+        free(n);
+        return NULL;
+    }
+    n->parent = parent;
+    n->file = file;
+    n->line = line;
+    prof.nodes[prof.nnodes++] = n;
+    prof.index[slot] = n;
+    return n;
+}
+
+// Is the same line (or command) already running further out?
+static int line_on_stack(const ProfileFrame *f, const ProfileNode *n) {
+    for (; f && f->node; f = f->parent) {
+        if (f->node->line == n->line && f->node->file == n->file) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int command_on_stack(const ProfileFrame *f, const char *name) {
+    for (; f && f->node; f = f->parent) {
+        if (f->command == name) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void command_add(const char *name, int64_t wall, int64_t cpu, int64_t child) {
+    CommandStat *c = NULL;
+    for (int i = 0; i < prof.ncommands && !c; i++) {
+        if (prof.commands[i].name == name) {
+            c = &prof.commands[i];
+        }
+    }
+    if (!c) {
+        if (grow((void **)&prof.commands, &prof.commands_cap, prof.ncommands, sizeof(CommandStat)) != 0) {
+            return;
+        }
+        c = &prof.commands[prof.ncommands++];
+        memset(c, 0, sizeof(*c));
+        c->name = name;
+    }
+    c->count++;
+    c->wall_us += wall;
+    c->cpu_us += cpu;
+    c->child_us += child;
+}
+
+// ---------------------------------------------------------------------------
+// Frames
+// ---------------------------------------------------------------------------
+
+int profile_enter(ProfileFrame *f, const char *file, int line, const char *text) {
+    ProfileFrame *parent = current_frame;
+    if (!parent) {
+        return 0;
+    }
+    pthread_mutex_lock(&prof.lock);
+    const char *name = file ? intern_file(file) : parent->file;
+    ProfileNode *node = name ? find_node(parent->node, name, line, text) : NULL;
+    pthread_mutex_unlock(&prof.lock);
+    if (!node) {
+        return 0;               // out of memory: the line runs unrecorded
+    }
+
+    f->parent = parent;
+    f->node = node;
+    f->file = name;
+    frame_start(f);
+    current_frame = f;
+    return 1;
+}
+
+void profile_leave(ProfileFrame *f) {
+    int64_t wall, cpu, child;
+    frame_times(f, &wall, &cpu, &child);
+    current_frame = f->parent;
+
+    pthread_mutex_lock(&prof.lock);
+    ProfileNode *n = f->node;
+    n->count++;
+    n->self_us += wall > f->nested_us ? wall - f->nested_us : 0;
+    if (!line_on_stack(f->parent, n)) {
+        n->wall_us += wall;
+        n->cpu_us += cpu;
+        n->child_us += child;
+    }
+    if (f->command && !command_on_stack(f->parent, f->command)) {
+        command_add(f->command, wall, cpu, child);
+    }
+    f->parent->nested_us += wall;   // may be another thread's frame
+    f->parent->child_us += child;
+    pthread_mutex_unlock(&prof.lock);
+}
+
+void profile_command(const char *name) {
+    if (current_frame && current_frame->node) {
+        current_frame->command = name;
+    }
+}
+
+void profile_child_reaped(const struct rusage *ru) {
+    if (!current_frame) {
+        return;
+    }
+    // A parallel-for iteration adds to its parent frame under the lock too
+    pthread_mutex_lock(&prof.lock);
+    current_frame->child_us += timeval_us(&ru->ru_utime) + timeval_us(&ru->ru_stime);
+    pthread_mutex_unlock(&prof.lock);
+}
+
+ProfileFrame *profile_current(void) {
+    return current_frame;
+}
+
+void profile_attach(ProfileFrame *parent) {
+    current_frame = parent;
+}
+
+// ---------------------------------------------------------------------------
+// Report
+// ---------------------------------------------------------------------------
+
+static int by_location(const void *a, const void *b) {
+    const ProfileNode *x = *(ProfileNode *const *)a, *y = *(ProfileNode *const *)b;
+    if (x->file != y->file) {
+        return x->file < y->file ? -1 : 1;
+    }
+    return (x->line > y->line) - (x->line < y->line);
+}
+
+static int by_self(const void *a, const void *b) {
+    const LineStat *x = a, *y = b;
+    return (x->self_us < y->self_us) - (x->self_us > y->self_us);
+}
+
+static int by_wall(const void *a, const void *b) {
+    const CommandStat *x = a, *y = b;
+    return (x->wall_us < y->wall_us) - (x->wall_us > y->wall_us);
+}
+
+static double ms(int64_t us) {
+    return us / 1000.0;
+}
+
+static void print_lines(void) {
+    ProfileNode **sorted = malloc((size_t)prof.nnodes * sizeof(*sorted) + 1);
+    LineStat *lines = malloc((size_t)prof.nnodes * sizeof(*lines) + 1);
+    if (!sorted || !lines) {
+        fprintf(cli_err(), "profile: out of memory\n");
+        free(sorted);
+        free(lines);
+        return;
+    }
+
+    // Merge the nodes of each line: a line reached through several
+    // stacks (a function called from two places) is one entry
+    int n = 0, nlines = 0;
+    for (int i = 0; i < prof.nnodes; i++) {
+        if (prof.nodes[i]->line > 0) {
+            sorted[n++] = prof.nodes[i];
+        }
+    }
+    qsort(sorted, (size_t)n, sizeof(*sorted), by_location);
+    for (int i = 0; i < n; i++) {
+        const ProfileNode *node = sorted[i];
+        LineStat *s = nlines ? &lines[nlines - 1] : NULL;
+        if (!s || s->file != node->file || s->line != node->line) {
+            s = &lines[nlines++];
+            memset(s, 0, sizeof(*s));
+            s->file = node->file;
+            s->line = node->line;
+            s->text = node->text;
+        }
+        s->count += node->count;
+        s->self_us += node->self_us;
+        s->wall_us += node->wall_us;
+        s->cpu_us += node->cpu_us;
+        s->child_us += node->child_us;
+    }
+    qsort(lines, (size_t)nlines, sizeof(*lines), by_self);
+
+    cli_printf("\nHottest lines (by self time):\n");
+    cli_printf("%10s %10s %10s %10s %8s  %s\n", "self ms", "total ms", "cpu ms", "child ms", "runs", "line");
+    for (int i = 0; i < nlines && i < PROFILE_TOP_LINES; i++) {
+        const LineStat *s = &lines[i];
+        cli_printf("%10.1f %10.1f %10.1f %10.1f %8ld  %s:%d  %s\n",
+                   ms(s->self_us), ms(s->wall_us), ms(s->cpu_us), ms(s->child_us),
+                   s->count, s->file, s->line, s->text);
+    }
+    if (nlines > PROFILE_TOP_LINES) {
+        cli_printf("  ... %d more line(s)\n", nlines - PROFILE_TOP_LINES);
+    }
+    free(sorted);
+    free(lines);
+}
+
+static void print_commands(void) {
+    if (prof.ncommands == 0) {
+        return;
+    }
+    qsort(prof.commands, (size_t)prof.ncommands, sizeof(CommandStat), by_wall);
+    cli_printf("\nBuilt-in commands (by total time):\n");
+    cli_printf("%10s %10s %10s %8s  %s\n", "total ms", "cpu ms", "child ms", "runs", "command");
+    for (int i = 0; i < prof.ncommands; i++) {
+        const CommandStat *c = &prof.commands[i];
+        cli_printf("%10.1f %10.1f %10.1f %8ld  %s\n",
+                   ms(c->wall_us), ms(c->cpu_us), ms(c->child_us), c->count, c->name);
+    }
+}
+
+static void write_stack(FILE *out, const ProfileNode *n) {
+    if (n->parent) {
+        write_stack(out, n->parent);
+        fputc(';', out);
+    }
+    if (n->line > 0) {
+        fprintf(out, "%s:%d %s", n->file, n->line, n->text);
+    } else {
+        fputs(n->file, out);
+    }
+}
+
+// One "frame;frame;frame <self microseconds>" line per stack, as read by
+// flamegraph.pl and speedscope
+static int write_folded(const char *path) {
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        return -1;
+    }
+    for (int i = 0; i < prof.nnodes; i++) {
+        const ProfileNode *n = prof.nodes[i];
+        if (n->self_us > 0) {
+            write_stack(out, n);
+            fprintf(out, " %lld\n", (long long)n->self_us);
+        }
+    }
+    return fclose(out);
+}
+
+int profile_begin(ProfileFrame *root) {
+    pthread_mutex_lock(&prof.lock);
+    int busy = prof.active;
+    prof.active = 1;
+    pthread_mutex_unlock(&prof.lock);
+    if (busy) {
+        return -1;
+    }
+
+    memset(root, 0, sizeof(*root));
+    frame_start(root);
+    root->child0_us = children_us();
+    current_frame = root;
+    return 0;
+}
+
+int profile_end(ProfileFrame *root, const char *folded_path) {
+    int64_t wall, cpu, child;
+    frame_times(root, &wall, &cpu, &child);
+    current_frame = NULL;
+    // The total also covers background jobs reaped while the script ran
+    child = children_us() - root->child0_us;
+
+    long runs = 0;
+    for (int i = 0; i < prof.nnodes; i++) {
+        if (prof.nodes[i]->line > 0) {
+            runs += prof.nodes[i]->count;
+        }
+    }
+    cli_printf("\nProfile: %.3f s wall, %.3f s CPU, %.3f s child CPU, %ld line(s) run\n",
+               wall / 1e6, cpu / 1e6, child / 1e6, runs);
+    print_lines();
+    print_commands();
+
+    int rc = 0;
+    if (folded_path) {
+        if (write_folded(folded_path) != 0) {
+            cli_perror(folded_path);
+            rc = -1;
+        } else {
+            cli_printf("\nFolded stacks written to %s (flamegraph.pl %s > profile.svg)\n",
+                       folded_path, folded_path);
+        }
+    }
+
+    pthread_mutex_lock(&prof.lock);
+    for (int i = 0; i < prof.nnodes; i++) {
+        free(prof.nodes[i]->text);
+        free(prof.nodes[i]);
+    }
+    for (int i = 0; i < prof.nfiles; i++) {
+        free(prof.files[i]);
+    }
+    free(prof.nodes);
+    free(prof.index);
+    free(prof.files);
+    free(prof.commands);
+    prof.nodes = NULL;
+    prof.index = NULL;
+    prof.files = NULL;
+    prof.commands = NULL;
+    prof.nnodes = prof.nodes_cap = prof.nfiles = prof.files_cap = 0;
+    prof.ncommands = prof.commands_cap = 0;
+    prof.index_cap = 0;
+    prof.active = 0;
+    pthread_mutex_unlock(&prof.lock);
+    return rc;
+}
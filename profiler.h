@@ -0,0 +1,62 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/resource.h>
+
+// Script profiler behind `source --profile`. The script runner opens a
+// frame for every script it runs and every line it executes; frames nest
+// through `source`, function calls and loop bodies, and each distinct stack
+// of frames is one node of a calling-context tree. At the end the profiler
+// prints the hottest lines by self time, totals per built-in command, and
+// can write the tree as folded stacks for flamegraph.pl.
+//
+// Only the thread that started the profile, and parallel-for iterations
+// attached to it, are recorded; a script running anywhere else at the same
+// time costs one thread-local check per line.
+
+struct ProfileNode;
+
+// Lives on the stack of whoever runs the line
+typedef struct ProfileFrame {
+    struct ProfileFrame *parent;
+    struct ProfileNode  *node;        // NULL for the root frame
+    const char          *file;        // interned script name
+    const char          *command;     // built-in the line ran, if any
+    struct timespec      wall0, cpu0;
+    int64_t              child_us;    // CPU of child processes waited for inside this frame
+    int64_t              child0_us;   // root only: RUSAGE_CHILDREN when the profile began
+    int64_t              nested_us;   // wall time of frames directly inside this one
+} ProfileFrame;
+
+// Start recording on this thread, with `root` as the outermost frame.
+// Returns -1 if a profile is already being recorded.
+int  profile_begin(ProfileFrame *root);
+
+// Stop recording, print the report and, if `folded_path` is set, write the
+// folded stacks there. Returns -1 if the folded file could not be written.
+int  profile_end(ProfileFrame *root, const char *folded_path);
+
+// Open a frame for a script (line 0, `file` set) or one of its lines
+// (`file` NULL: the enclosing script's). Returns 0 without touching `f`
+// when this thread is not being profiled, else 1; close with profile_leave().
+int  profile_enter(ProfileFrame *f, const char *file, int line, const char *text);
+void profile_leave(ProfileFrame *f);
+
+// Name the built-in run by the innermost open frame
+void profile_command(const char *name);
+
+// Charge a child process this thread has reaped to its innermost open
+// frame. Child time comes from the command's own PIDs (wait4()), not from
+// RUSAGE_CHILDREN, which a parallel-for iteration would share with its
+// siblings.
+void profile_child_reaped(const struct rusage *ru);
+
+// Innermost open frame of this thread (NULL if not profiling), and
+// attaching a worker thread under it for a parallel-for iteration
+// (NULL detaches). The frame must stay open until the worker detaches.
+ProfileFrame *profile_current(void);
+void profile_attach(ProfileFrame *parent);
+
+#endif
@@ -0,0 +1,56 @@
+#include <stdio.h>
+#include <string.h>
+#include "registry.h"
+#include "command_hash.h"
+#include "command_table.h"
+#include "commands.h"
+#include "file_management.h"
+#include "process_management.h"
+#include "auth.h"
+#include "logger.h"
+#include "cli_output.h"
+
+static const CommandInfo registry[] = {
+#define COMMAND(name, func, min_args, max_args, flags, complete, words, usage, summary) \
+    { #name, func, min_args, max_args, flags, complete, words, usage, summary },
+#include "commands.def"
+#undef COMMAND
+};
+
+_Static_assert(sizeof(registry) / sizeof(registry[0]) == COMMAND_COUNT,
+               "command_table.h is stale: rebuild it from commands.def");
+
+const CommandInfo *registry_find(const char *name) {
+    int index = command_slots[command_hash(name, COMMAND_HASH_SEED) & (COMMAND_TABLE_SIZE - 1)];
+    if (index >= 0 && strcmp(registry[index].name, name) == 0) {
+        return &registry[index];
+    }
+    return NULL;
+}
+
+int registry_count(void) {
+    return COMMAND_COUNT;
+}
+
+const CommandInfo *registry_at(int index) {
+    return (index >= 0 && index < COMMAND_COUNT) ? &registry[index] : NULL;
+}
+
+int registry_check(const CommandInfo *cmd, int argc) {
+    if ((cmd->flags & CMD_ADMIN) && !is_admin()) {
+        char entry[64];
+        snprintf(entry, sizeof(entry), "UNAUTHORIZED %s attempt", cmd->name);
+        cli_printf("🚫  Permission denied: only admin can use %s.\n", cmd->name);
+        log_command(entry);
+        cli_set_status(1);
+        return -1;
+    }
+
+    int nargs = argc - 1;
+    if (nargs < cmd->min_args || (cmd->max_args >= 0 && nargs > cmd->max_args)) {
+        cli_printf("Usage: %s\n", cmd->usage);
+        cli_set_status(2);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,48 @@
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+// The built-in command registry, generated from commands.def. The REPL,
+// scripts, `help` and tab completion all look commands up here.
+
+// Command flags
+#define CMD_FOREGROUND  0x01  // never runs as a background task ("&" is its own argument)
+#define CMD_SECRET      0x02  // prompts for a password, read before queueing as a task
+#define CMD_ADMIN       0x04  // admin only; checked by registry_check()
+#define CMD_MAIN_THREAD 0x08  // uses the job table or the terminal: not inside a parallel for
+#define CMD_REPL_ONLY   0x10  // interactive prompt only, not callable from scripts
+
+// What a command's arguments complete to
+typedef enum {
+    COMPLETE_NONE,
+    COMPLETE_FILES,
+    COMPLETE_JOBS,        // job IDs from the job table
+    COMPLETE_PIDS,        // PIDs of background jobs
+    COMPLETE_COMMANDS,    // command names
+    COMPLETE_PROGRAM      // a program on PATH (after any --options, and after each "|"), then files
+} CompleteHint;
+
+typedef void (*CommandFunc)(int argc, char *argv[]);
+
+typedef struct {
+    const char  *name;
+    CommandFunc  func;
+    int          min_args, max_args;   // not counting the name; max -1 = no limit
+    int          flags;
+    CompleteHint complete;
+    const char  *words;                // space-separated literal completions, or NULL
+    const char  *usage;
+    const char  *summary;
+} CommandInfo;
+
+// O(1) lookup; NULL if `name` is not a built-in command
+const CommandInfo *registry_find(const char *name);
+
+// Commands in commands.def order: for (int i = 0; i < registry_count(); i++)
+int registry_count(void);
+const CommandInfo *registry_at(int index);
+
+// Check the caller may run `cmd` with argc - 1 arguments. Prints usage (status
+// 2) or a permission error (status 1) and returns -1 if not, else 0.
+int registry_check(const CommandInfo *cmd, int argc);
+
+#endif
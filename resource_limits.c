@@ -0,0 +1,204 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include "resource_limits.h"
+#include "cli_output.h"
+
+// ioprio_set(2) has no glibc wrapper; these mirror <linux/ioprio.h>
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_CLASS_RT    1
+#define IOPRIO_CLASS_BE    2
+#define IOPRIO_CLASS_IDLE  3
+#define IOPRIO_WHO_PROCESS 1
+#define IOPRIO_PRIO_VALUE(cls, data) (((cls) << IOPRIO_CLASS_SHIFT) | (data))
+
+void resource_limits_init(ResourceLimits *rl) {
+    memset(rl, 0, sizeof(*rl));
+    CPU_ZERO(&rl->affinity);
+    rl->ionice_class = -1;
+    rl->cpu_seconds = -1;
+    rl->mem_mb = -1;
+    rl->nofile = -1;
+}
+
+// Parse a decimal number with an optional sign, rejecting empty values,
+// leading blanks and trailing garbage
+static int parse_signed(const char *s, long *out) {
+    if (!s || !*s || isspace((unsigned char)*s)) return -1;
+    char *end;
+    errno = 0;
+    long v = strtol(s, &end, 10);
+    if (errno != 0 || end == s || *end != '\0') return -1;
+    *out = v;
+    return 0;
+}
+
+// Parse a non-negative decimal number
+static int parse_long(const char *s, long *out) {
+    long v;
+    if (parse_signed(s, &v) != 0 || v < 0) return -1;
+    *out = v;
+    return 0;
+}
+
+// Parse a CPU list such as "0-3,6,8-9"
+static int parse_cpu_list(const char *spec, cpu_set_t *set) {
+    char buf[sizeof(((ResourceLimits *)0)->affinity_spec)];
+    if (strlen(spec) >= sizeof(buf)) return -1;     // rather than drop CPUs silently
+    strcpy(buf, spec);
+
+    CPU_ZERO(set);
+    char *save = NULL;
+    for (char *part = strtok_r(buf, ",", &save); part; part = strtok_r(NULL, ",", &save)) {
+        long lo, hi;
+        char *dash = strchr(part, '-');
+        if (dash) {
+            *dash = '\0';
+            if (parse_long(part, &lo) != 0 || parse_long(dash + 1, &hi) != 0) return -1;
+        } else {
+            if (parse_long(part, &lo) != 0) return -1;
+            hi = lo;
+        }
+        if (lo > hi || hi >= CPU_SETSIZE) return -1;
+        for (long cpu = lo; cpu <= hi; cpu++) {
+            CPU_SET((int)cpu, set);
+        }
+    }
+    return CPU_COUNT(set) > 0 ? 0 : -1;
+}
+
+// Parse "idle", "be[:N]" or "rt[:N]"
+static int parse_ionice(const char *spec, int *cls, int *level) {
+    const char *colon = strchr(spec, ':');
+    size_t name_len = colon ? (size_t)(colon - spec) : strlen(spec);
+    long lvl = 4;
+
+    if (colon && (parse_long(colon + 1, &lvl) != 0 || lvl > 7)) return -1;
+
+    if (name_len == 4 && strncmp(spec, "idle", 4) == 0) {
+        *cls = IOPRIO_CLASS_IDLE;
+        lvl = 0;
+    } else if (name_len == 2 && strncmp(spec, "be", 2) == 0) {
+        *cls = IOPRIO_CLASS_BE;
+    } else if (name_len == 2 && strncmp(spec, "rt", 2) == 0) {
+        *cls = IOPRIO_CLASS_RT;
+    } else {
+        return -1;
+    }
+    *level = (int)lvl;
+    return 0;
+}
+
+int resource_limits_parse(ResourceLimits *rl, int argc, char *argv[], int start) {
+    int i = start;
+    while (i < argc && argv[i] && strncmp(argv[i], "--", 2) == 0) {
+        const char *opt = argv[i];
+        const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (!val) {
+            cli_printf("Missing value for option %s\n", opt);
+            cli_set_status(2);
+            return -1;
+        }
+
+        int bad = 0;
+        if (strcmp(opt, "--cpus") == 0) {
+            bad = parse_cpu_list(val, &rl->affinity);
+            if (!bad) {
+                rl->has_affinity = 1;
+                strncpy(rl->affinity_spec, val, sizeof(rl->affinity_spec) - 1);
+                rl->affinity_spec[sizeof(rl->affinity_spec) - 1] = '\0';
+            }
+        } else if (strcmp(opt, "--nice") == 0) {
+            long n;
+            bad = parse_signed(val, &n) != 0 || n < -20 || n > 19;
+            if (!bad) {
+                rl->has_nice = 1;
+                rl->nice = (int)n;
+            }
+        } else if (strcmp(opt, "--ionice") == 0) {
+            bad = parse_ionice(val, &rl->ionice_class, &rl->ionice_level);
+        } else if (strcmp(opt, "--cpu-time") == 0) {
+            bad = parse_long(val, &rl->cpu_seconds);
+        } else if (strcmp(opt, "--mem") == 0) {
+            bad = parse_long(val, &rl->mem_mb);
+        } else if (strcmp(opt, "--nofile") == 0) {
+            bad = parse_long(val, &rl->nofile);
+        } else {
+            cli_printf("Unknown option: %s\n", opt);
+            cli_set_status(2);
+            return -1;
+        }
+
+        if (bad) {
+            cli_printf("Invalid value for %s: %s\n", opt, val);
+            cli_set_status(2);
+            return -1;
+        }
+        i += 2;
+    }
+    return i;
+}
+
+int resource_limits_any(const ResourceLimits *rl) {
+    return rl->has_affinity || rl->has_nice || rl->ionice_class >= 0 ||
+           rl->cpu_seconds >= 0 || rl->mem_mb >= 0 || rl->nofile >= 0;
+}
+
+static int set_limit(int resource, rlim_t value) {
+    struct rlimit lim = { value, value };
+    return setrlimit(resource, &lim);
+}
+
+int resource_limits_apply(const ResourceLimits *rl) {
+    if (rl->has_affinity && sched_setaffinity(0, sizeof(rl->affinity), &rl->affinity) != 0) {
+        return -1;
+    }
+    if (rl->has_nice && setpriority(PRIO_PROCESS, 0, rl->nice) != 0) {
+        return -1;
+    }
+    if (rl->ionice_class >= 0 &&
+        syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0,
+                IOPRIO_PRIO_VALUE(rl->ionice_class, rl->ionice_level)) != 0) {
+        return -1;
+    }
+    if (rl->cpu_seconds >= 0 && set_limit(RLIMIT_CPU, (rlim_t)rl->cpu_seconds) != 0) {
+        return -1;
+    }
+    if (rl->mem_mb >= 0 && set_limit(RLIMIT_AS, (rlim_t)rl->mem_mb * 1024 * 1024) != 0) {
+        return -1;
+    }
+    if (rl->nofile >= 0 && set_limit(RLIMIT_NOFILE, (rlim_t)rl->nofile) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+void resource_limits_format(const ResourceLimits *rl, char *buf, size_t size) {
+    size_t len = 0;
+    buf[0] = '\0';
+
+#define APPEND(...) \
+    do { \
+        if (len < size) len += snprintf(buf + len, size - len, __VA_ARGS__); \
+    } while (0)
+
+    if (rl->has_affinity) APPEND("%scpus=%s", len ? " " : "", rl->affinity_spec);
+    if (rl->has_nice) APPEND("%snice=%d", len ? " " : "", rl->nice);
+    if (rl->ionice_class == IOPRIO_CLASS_IDLE) {
+        APPEND("%sio=idle", len ? " " : "");
+    } else if (rl->ionice_class >= 0) {
+        APPEND("%sio=%s:%d", len ? " " : "",
+               rl->ionice_class == IOPRIO_CLASS_RT ? "rt" : "be", rl->ionice_level);
+    }
+    if (rl->cpu_seconds >= 0) APPEND("%scpu=%lds", len ? " " : "", rl->cpu_seconds);
+    if (rl->mem_mb >= 0) APPEND("%smem=%ldM", len ? " " : "", rl->mem_mb);
+    if (rl->nofile >= 0) APPEND("%snofile=%ld", len ? " " : "", rl->nofile);
+
+#undef APPEND
+}
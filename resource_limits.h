@@ -0,0 +1,46 @@
+#ifndef RESOURCE_LIMITS_H
+#define RESOURCE_LIMITS_H
+
+#include <sched.h>
+#include <stddef.h>
+
+// Scheduling and resource controls applied to a launched program.
+// Unset fields are left at the values inherited from SecureSysCLI.
+typedef struct {
+    int       has_affinity;
+    cpu_set_t affinity;
+    char      affinity_spec[64];  // as typed, e.g. "0-3,6"
+    int       has_nice;
+    int       nice;
+    int       ionice_class;       // -1 = unset, otherwise IOPRIO_CLASS_*
+    int       ionice_level;       // 0-7 (ignored for the idle class)
+    long      cpu_seconds;        // RLIMIT_CPU, -1 = unset
+    long      mem_mb;             // RLIMIT_AS in MiB, -1 = unset
+    long      nofile;             // RLIMIT_NOFILE, -1 = unset
+} ResourceLimits;
+
+// Reset all controls to "unset"
+void resource_limits_init(ResourceLimits *rl);
+
+// Parse leading --cpus/--nice/--ionice/--cpu-time/--mem/--nofile options
+// from argv starting at `start`. Returns the index of the first argument
+// that is not an option, or -1 (after printing an error and setting status
+// 2) on bad input.
+int resource_limits_parse(ResourceLimits *rl, int argc, char *argv[], int start);
+
+// Returns non-zero if any control is set
+int resource_limits_any(const ResourceLimits *rl);
+
+// Apply the controls to the calling process (used in the child before exec).
+// Returns 0 on success, -1 with errno set on failure.
+int resource_limits_apply(const ResourceLimits *rl);
+
+// Short human-readable summary, e.g. "cpus=0-3 nice=10 io=idle" ("" if unset)
+void resource_limits_format(const ResourceLimits *rl, char *buf, size_t size);
+
+// Option summary for usage messages
+#define RESOURCE_LIMITS_USAGE \
+    "[--cpus LIST] [--nice N] [--ionice idle|be[:0-7]|rt[:0-7]] " \
+    "[--cpu-time SEC] [--mem MB] [--nofile N]"
+
+#endif
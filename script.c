@@ -1,174 +1,1466 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <glob.h>
+#include <pthread.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include "script.h"
-#include "commands.h"
-#include "file_management.h"
-#include "process_management.h"
+#include "arena.h"
+#include "lexer.h"
+#include "registry.h"
+#include "profiler.h"
+#include "jobs.h"
+#include "tasks.h"
+#include "worker_pool.h"
 #include "logger.h"
+#include "cli_output.h"
 
-#define MAX_LINE_LENGTH 1024
-#define MAX_VARIABLES 100
+#define MAX_ARGS 64             // argv entries kept on the stack; longer lists are allocated
+#define SCRIPT_CACHE_SIZE 16
+#define MAX_SOURCE_DEPTH 64
+#define MAX_CALL_DEPTH 256
+
+// ---------------------------------------------------------------------------
+// Variables
+//
+// Each scope is an open-addressing hash table (linear probing, kept at most
+// half full) whose names and values live in the scope's arena, so a scope
+// is freed in one go and there is no limit on the number of variables or
+// their length. The outermost scope holds the variables of scripts run from
+// the prompt and lasts for the session; each nested `source` and function
+// call gets its own scope. Lookups search from the innermost scope
+// outwards; `set` always writes to the innermost one, so a nested script
+// can read its caller's variables but its own are gone when it returns.
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint64_t hash;
+    char    *name;          // NULL = empty bucket
+    char    *value;
+    size_t   len, cap;      // value length and room (cap > len)
+} VarEntry;
 
-// Simple variable storage for scripting
 typedef struct {
-    char name[64];
-    char value[256];
-} Variable;
+    Arena     arena;
+    VarEntry *table;
+    size_t    cap, count;   // cap is 0 or a power of two
+} VarScope;
+
+// Interpreter state of one thread: the session context on the main thread,
+// or a parallel-for iteration on a worker. An iteration reads its parent's
+// variables (the parent waits until every iteration has finished) and
+// writes only its own.
+typedef struct ScriptContext {
+    VarScope *scopes;
+    int       nscopes, scopes_cap;
+    const struct ScriptContext *parent;
+    int       source_depth;
+    int       call_depth;
+    int       parallel;     // running a parallel-for iteration
+} ScriptContext;
+
+static ScriptContext session;
+static __thread ScriptContext *current = NULL;     // NULL = session
+
+static ScriptContext *context(void) {
+    return current ? current : &session;
+}
+
+static uint64_t var_hash(const char *name, size_t len) {
+    uint64_t h = 1469598103934665603ULL;     // FNV-1a
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (unsigned char)name[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+static VarEntry *scope_find(const VarScope *s, const char *name, size_t len, uint64_t hash) {
+    if (s->cap == 0) {
+        return NULL;
+    }
+    for (size_t i = hash & (s->cap - 1);; i = (i + 1) & (s->cap - 1)) {
+        VarEntry *e = &s->table[i];
+        if (!e->name) {
+            return e;
+        }
+        if (e->hash == hash && strncmp(e->name, name, len) == 0 && e->name[len] == '\0') {
+            return e;
+        }
+    }
+}
 
-static Variable variables[MAX_VARIABLES];
-static int variable_count = 0;
+static int scope_grow(VarScope *s) {
+    size_t cap = s->cap ? s->cap * 2 : 64;
+    VarEntry *table = calloc(cap, sizeof(VarEntry));
+    if (!table) {
+        return -1;
+    }
+    for (size_t i = 0; i < s->cap; i++) {
+        if (s->table[i].name) {
+            size_t j = s->table[i].hash & (cap - 1);
+            while (table[j].name) j = (j + 1) & (cap - 1);
+            table[j] = s->table[i];
+        }
+    }
+    free(s->table);
+    s->table = table;
+    s->cap = cap;
+    return 0;
+}
 
-// Set a variable
+static int scope_push(void) {
+    ScriptContext *c = context();
+    if (c->nscopes == c->scopes_cap) {
+        int cap = c->scopes_cap ? c->scopes_cap * 2 : 8;
+        VarScope *grown = realloc(c->scopes, (size_t)cap * sizeof(VarScope));
+        if (!grown) {
+            return -1;
+        }
+        c->scopes = grown;
+        c->scopes_cap = cap;
+    }
+    memset(&c->scopes[c->nscopes++], 0, sizeof(VarScope));
+    return 0;
+}
+
+static void scope_pop(void) {
+    ScriptContext *c = context();
+    VarScope *s = &c->scopes[--c->nscopes];
+    arena_free(&s->arena);
+    free(s->table);
+}
+
+// Set a variable in the innermost scope
 static void set_variable(const char *name, const char *value) {
-    // Check if variable exists
-    for (int i = 0; i < variable_count; i++) {
-        if (strcmp(variables[i].name, name) == 0) {
-            strncpy(variables[i].value, value, sizeof(variables[i].value) - 1);
-            variables[i].value[sizeof(variables[i].value) - 1] = '\0';
+    ScriptContext *c = context();
+    if (c->nscopes == 0 && scope_push() != 0) {
+        return;
+    }
+    VarScope *s = &c->scopes[c->nscopes - 1];
+    size_t name_len = strlen(name), len = strlen(value);
+    uint64_t hash = var_hash(name, name_len);
+
+    if ((s->count + 1) * 2 > s->cap && scope_grow(s) != 0) {
+        return;
+    }
+    VarEntry *e = scope_find(s, name, name_len, hash);
+    if (!e->name) {
+        char *copy = arena_alloc(&s->arena, name_len + 1);
+        if (!copy) {
             return;
         }
+        memcpy(copy, name, name_len + 1);
+        e->hash = hash;
+        e->name = copy;
+        e->value = NULL;
+        e->len = e->cap = 0;
+        s->count++;
     }
-
-    // Add new variable
-    if (variable_count < MAX_VARIABLES) {
-        strncpy(variables[variable_count].name, name, sizeof(variables[0].name) - 1);
-        variables[variable_count].name[sizeof(variables[0].name) - 1] = '\0';
-        strncpy(variables[variable_count].value, value, sizeof(variables[0].value) - 1);
-        variables[variable_count].value[sizeof(variables[0].value) - 1] = '\0';
-        variable_count++;
+    if (len >= e->cap) {
+        // Values that keep growing get room to grow in place
+        size_t cap = len + 1 > e->cap * 2 ? len + 1 : e->cap * 2;
+        char *room = arena_alloc(&s->arena, cap);
+        if (!room) {
+            if (!e->value) e->value = "";
+            return;
+        }
+        e->value = room;
+        e->cap = cap;
     }
+    memcpy(e->value, value, len + 1);
+    e->len = len;
 }
 
-// Get a variable value
-static const char *get_variable(const char *name) {
-    for (int i = 0; i < variable_count; i++) {
-        if (strcmp(variables[i].name, name) == 0) {
-            return variables[i].value;
+// Innermost variable called name[0..len), or NULL
+static const VarEntry *lookup_variable(const char *name, size_t len, uint64_t hash) {
+    for (const ScriptContext *c = context(); c; c = c->parent) {
+        for (int i = c->nscopes - 1; i >= 0; i--) {
+            const VarEntry *e = scope_find(&c->scopes[i], name, len, hash);
+            if (e && e->name) {
+                return e;
+            }
         }
     }
     return NULL;
 }
 
-// Expand variables in a string (simple $VAR substitution)
-static void expand_variables(char *line, size_t size) {
-    char result[MAX_LINE_LENGTH * 2] = {0};
-    char *src = line;
-    char *dst = result;
-
-    while (*src && (size_t)(dst - result) < sizeof(result) - 1) {
-        if (*src == '$' && (src[1] == '_' || (src[1] >= 'a' && src[1] <= 'z') || 
-                           (src[1] >= 'A' && src[1] <= 'Z'))) {
-            // Extract variable name
-            char var_name[64] = {0};
-            src++; // Skip $
-            int i = 0;
-            while ((*src == '_' || (*src >= 'a' && *src <= 'z') || 
-                   (*src >= 'A' && *src <= 'Z') || (*src >= '0' && *src <= '9')) &&
-                   (size_t)i < sizeof(var_name) - 1) {
-                var_name[i++] = *src++;
-            }
-
-            // Get variable value
-            const char *value = get_variable(var_name);
-            if (value) {
-                strncpy(dst, value, sizeof(result) - (dst - result) - 1);
-                dst += strlen(value);
+void script_each_variable(void (*fn)(const char *name, void *arg), void *arg) {
+    for (int i = 0; i < session.nscopes; i++) {
+        const VarScope *s = &session.scopes[i];
+        for (size_t j = 0; j < s->cap; j++) {
+            if (s->table[j].name) {
+                fn(s->table[j].name, arg);
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Compiled scripts
+//
+// A script is parsed once into a list of instructions: comments and blank
+// lines are dropped, blocks are matched, command handlers and function
+// calls are looked up, lines without variables are pre-split into words,
+// and each $VAR becomes a slot with its name already hashed. Compiled
+// scripts are cached by file identity and modification time, so running
+// an unchanged script again does no parsing at all.
+// ---------------------------------------------------------------------------
+
+typedef enum {
+    OP_COMMAND,
+    OP_FOR,
+    OP_IF,
+    OP_ELSE,
+    OP_END,
+    OP_FUNCTION,
+    OP_BREAK,
+    OP_CONTINUE,
+    OP_RETURN
+} OpCode;
+
+typedef enum { CALL_SET, CALL_ECHO, CALL_BUILTIN, CALL_FUNCTION } CallKind;
+
+typedef enum { CMP_NONE, CMP_EQ, CMP_NE, CMP_LT, CMP_GT, CMP_LE, CMP_GE } CmpOp;
+
+// A line with $VAR references is kept as literal and variable pieces;
+// expanding it and splitting the result matches expanding the raw line.
+// Values are escaped as they are pasted in, so quotes in a value are text,
+// while blanks in a value outside double quotes still split it.
+typedef enum { SEG_TEXT, SEG_VAR, SEG_VAR_QUOTED } SegKind;
+
+typedef struct {
+    SegKind kind;
+    int     off, len;       // SEG_TEXT: text in `strings`; SEG_VAR: `off` is the slot
+} Segment;
+
+typedef struct {
+    int      name;          // offset of the variable name in `strings`
+    size_t   len;
+    uint64_t hash;          // hashed once, at compile time
+} VarSlot;
+
+// Some words of a line (a command, a for list, an operand)
+typedef struct {
+    int text;               // as written (offset in `strings`)
+    int words;              // no variables: NUL-separated words (offset) ...
+    int words_len;
+    int value;              // ... the words unquoted but not split (offset) ...
+    int argc;
+    int first_word;         // ... and their offsets relative to `words`, in word_off[]
+    int first_seg;          // with variables: their pieces in segs[]
+    int nsegs;              // 0 = literal
+} Words;
+
+typedef struct {
+    Words       w;
+    int         name;       // command word, unquoted (offset in `strings`)
+    int         dynamic;    // the command word comes from a variable: resolve per run
+    CallKind    kind;
+    const CommandInfo *builtin;  // CALL_BUILTIN: registry entry; NULL if unknown
+    int         target;     // CALL_FUNCTION: index of the OP_FUNCTION instruction
+} Cmd;
+
+typedef struct {
+    OpCode op;
+    int    line;            // in the source file
+    int    text;            // COMMAND, FOR, IF: the line as written (offset in `strings`)
+    int    end;             // FOR, IF, ELSE, FUNCTION: index of the matching END
+    int    alt;             // IF: index of its ELSE, or `end` if none
+    int    name;            // FOR: loop variable; FUNCTION: function name
+    int    lines;           // FOR: iterate over the lines of a file
+    int    jobs;            // FOR: 0 = sequential; parallel: at most this many, -1 = pool size
+    int    negate;          // IF not ...
+    CmpOp  cmp;             // IF: CMP_NONE tests the exit status of `cmd`
+    Words  lhs, rhs;        // IF comparison operands
+    Words  list;            // FOR items or file; RETURN status
+    Cmd    cmd;             // COMMAND; IF condition
+} Instr;
+
+typedef struct {
+    int      refs;          // the cache's reference plus one per running execution
+    char    *strings;
+    size_t   strings_len, strings_cap;
+    Instr   *code;
+    int      ncode, code_cap;
+    int     *funcs;         // OP_FUNCTION instructions
+    int      nfuncs, funcs_cap;
+    int     *word_off;
+    int      nword_off, word_off_cap;
+    Segment *segs;
+    int      nsegs, segs_cap;
+    VarSlot *slots;
+    int      nslots, slots_cap;
+} CompiledScript;
+
+typedef struct {
+    dev_t           dev;
+    ino_t           ino;
+    struct timespec mtime;
+    off_t           size;
+    unsigned long   last_used;
+    CompiledScript *script;  // NULL = free entry
+} CacheEntry;
+
+// Parallel-for iterations may `source` scripts too
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static CacheEntry script_cache[SCRIPT_CACHE_SIZE];
+static unsigned long cache_clock = 0;
+
+// Grow an array to hold one more element; 0 on success
+static int grow(void **array, int *cap, int count, size_t elem) {
+    if (count < *cap) {
+        return 0;
+    }
+    int new_cap = *cap ? *cap * 2 : 16;
+    void *grown = realloc(*array, (size_t)new_cap * elem);
+    if (!grown) {
+        return -1;
+    }
+    *array = grown;
+    *cap = new_cap;
+    return 0;
+}
+
+// Copy `len` bytes into the string pool (NUL-terminated); returns the
+// offset, or -1. The pool may move: keep offsets, not pointers, across calls.
+static int add_string(CompiledScript *cs, const char *s, size_t len) {
+    if (cs->strings_len + len + 1 > cs->strings_cap) {
+        size_t cap = cs->strings_cap * 2 > cs->strings_len + len + 1 ?
+                     cs->strings_cap * 2 : cs->strings_len + len + 1;
+        char *grown = realloc(cs->strings, cap);
+        if (!grown) {
+            return -1;
+        }
+        cs->strings = grown;
+        cs->strings_cap = cap;
+    }
+    int off = (int)cs->strings_len;
+    memcpy(cs->strings + off, s, len);
+    cs->strings[off + len] = '\0';
+    cs->strings_len += len + 1;
+    return off;
+}
+
+static int slot_for(CompiledScript *cs, const char *name, size_t len) {
+    for (int i = 0; i < cs->nslots; i++) {
+        const char *known = cs->strings + cs->slots[i].name;
+        if (strncmp(known, name, len) == 0 && known[len] == '\0') {
+            return i;
+        }
+    }
+    if (grow((void **)&cs->slots, &cs->slots_cap, cs->nslots, sizeof(VarSlot)) != 0) {
+        return -1;
+    }
+    int off = add_string(cs, name, len);
+    if (off < 0) {
+        return -1;
+    }
+    cs->slots[cs->nslots].name = off;
+    cs->slots[cs->nslots].len = len;
+    cs->slots[cs->nslots].hash = var_hash(name, len);
+    return cs->nslots++;
+}
+
+static int is_name_start(char c) {
+    return c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static int is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static int is_name_char(char c) {
+    return is_name_start(c) || is_digit(c);
+}
+
+// $NAME, or $0, $1 ... inside a function
+static int is_var_ref(const char *p) {
+    return p[0] == '$' && (is_name_start(p[1]) || is_digit(p[1]));
+}
+
+static int is_valid_name(const char *s, size_t len) {
+    if (len == 0 || !is_name_start(s[0])) {
+        return 0;
+    }
+    for (size_t i = 1; i < len; i++) {
+        if (!is_name_char(s[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int add_segment(CompiledScript *cs, SegKind kind, int off, int len) {
+    if (grow((void **)&cs->segs, &cs->segs_cap, cs->nsegs, sizeof(Segment)) != 0) {
+        return -1;
+    }
+    cs->segs[cs->nsegs++] = (Segment){ kind, off, len };
+    return 0;
+}
+
+// Split already-checked words in place at `off` in `strings`, recording
+// each word's offset
+static int split_words(CompiledScript *cs, int off, Words *w) {
+    char *base = cs->strings + off;
+    int n = lex_count(base);
+    char *small[MAX_ARGS];
+    char **argv = n < MAX_ARGS ? small : malloc(((size_t)n + 1) * sizeof(char *));
+    if (!argv) {
+        return -1;
+    }
+    lex_split(base, argv);
+    w->first_word = cs->nword_off;
+    int rc = 0;
+    for (int i = 0; rc == 0 && i < n; i++) {
+        rc = grow((void **)&cs->word_off, &cs->word_off_cap, cs->nword_off, sizeof(int));
+        if (rc == 0) {
+            cs->word_off[cs->nword_off++] = (int)(argv[i] - base);
+            w->argc++;
+        }
+    }
+    if (argv != small) {
+        free(argv);
+    }
+    return rc;
+}
+
+static int compile_words(CompiledScript *cs, const char *src, size_t len, Words *w) {
+    memset(w, 0, sizeof(*w));
+    if ((w->text = add_string(cs, src, len)) < 0) {
+        return -1;
+    }
+
+    // A $ is a reference unless it is in single quotes or escaped
+    int has_vars = 0;
+    LexQuote q = LEX_PLAIN;
+    if (memchr(src, '$', len)) {
+        for (size_t i = 0; i < len && !has_vars; i += lex_step(src + i, &q)) {
+            has_vars = q != LEX_SINGLE && is_var_ref(src + i);
+        }
+    }
+
+    if (!has_vars) {
+        // Pre-split and unquoted: a run copies the words and points argv
+        // into the copy
+        if ((w->words = add_string(cs, src, len)) < 0 || split_words(cs, w->words, w) != 0) {
+            return -1;
+        }
+        w->value = w->text;
+        if (memchr(src, '\'', len) || memchr(src, '"', len) || memchr(src, '\\', len)) {
+            if ((w->value = add_string(cs, src, len)) < 0) {
+                return -1;
+            }
+            lex_unquote(cs->strings + w->value);
+        }
+        w->words_len = (int)len + 1;
+        return 0;
+    }
+
+    w->first_seg = cs->nsegs;
+    size_t i = 0, lit = 0;
+    q = LEX_PLAIN;
+    while (i < len) {
+        if (q == LEX_SINGLE || !is_var_ref(src + i)) {
+            i += lex_step(src + i, &q);
+            continue;
+        }
+        if (i > lit && add_segment(cs, SEG_TEXT, w->text + (int)lit, (int)(i - lit)) != 0) {
+            return -1;
+        }
+        size_t start = ++i;
+        if (is_digit(src[i])) {
+            while (i < len && is_digit(src[i])) i++;
+        } else {
+            while (i < len && is_name_char(src[i])) i++;
+        }
+        int slot = slot_for(cs, src + start, i - start);
+        SegKind kind = q == LEX_DOUBLE ? SEG_VAR_QUOTED : SEG_VAR;
+        if (slot < 0 || add_segment(cs, kind, slot, 0) != 0) {
+            return -1;
+        }
+        lit = i;
+    }
+    if (i > lit && add_segment(cs, SEG_TEXT, w->text + (int)lit, (int)(i - lit)) != 0) {
+        return -1;
+    }
+    w->nsegs = cs->nsegs - w->first_seg;
+    return 0;
+}
+
+static int compile_cmd(CompiledScript *cs, const char *src, size_t len, Cmd *c) {
+    memset(c, 0, sizeof(*c));
+    if (compile_words(cs, src, len, &c->w) != 0) {
+        return -1;
+    }
+    size_t name_len = (size_t)(lex_word_end(src) - src);
+    if (name_len > len) name_len = len;
+    if ((c->name = add_string(cs, src, name_len)) < 0) {
+        return -1;
+    }
+    // A variable in the command word itself is looked up per run
+    c->dynamic = memchr(src, '$', name_len) != NULL;
+    lex_unquote(cs->strings + c->name);
+    return 0;
+}
+
+// Fill in how to run a command word: set, echo, a script function (these
+// take precedence over built-ins of the same name) or a built-in
+static void resolve_call(const CompiledScript *cs, const char *name, Cmd *c) {
+    c->builtin = NULL;
+    if (strcmp(name, "set") == 0) {
+        c->kind = CALL_SET;
+        return;
+    }
+    if (strcmp(name, "echo") == 0) {
+        c->kind = CALL_ECHO;
+        return;
+    }
+    for (int i = 0; i < cs->nfuncs; i++) {
+        if (strcmp(name, cs->strings + cs->code[cs->funcs[i]].name) == 0) {
+            c->kind = CALL_FUNCTION;
+            c->target = cs->funcs[i];
+            return;
+        }
+    }
+    c->kind = CALL_BUILTIN;
+    c->builtin = registry_find(name);
+}
+
+// Next word of a source line, as written (quotes included)
+static const char *next_word(const char **p, size_t *len) {
+    const char *s = *p + strspn(*p, " \t");
+    *len = (size_t)(lex_word_end(s) - s);
+    *p = s + *len;
+    return *len ? s : NULL;
+}
+
+static int word_is(const char *w, size_t len, const char *keyword) {
+    return w && strlen(keyword) == len && strncmp(w, keyword, len) == 0;
+}
+
+static const char *skip_space(const char *p) {
+    return p + strspn(p, " \t");
+}
+
+static CmpOp parse_cmp(const char *w, size_t len) {
+    static const struct { const char *op; CmpOp cmp; } ops[] = {
+        {"==", CMP_EQ}, {"!=", CMP_NE}, {"<", CMP_LT}, {">", CMP_GT},
+        {"<=", CMP_LE}, {">=", CMP_GE}, {NULL, CMP_NONE}
+    };
+    for (int i = 0; ops[i].op; i++) {
+        if (word_is(w, len, ops[i].op)) {
+            return ops[i].cmp;
+        }
+    }
+    return CMP_NONE;
+}
+
+typedef struct {
+    int  stack[MAX_CALL_DEPTH];     // open blocks
+    int  depth;
+    char error[160];
+} CompileState;
+
+// Compile one trimmed, non-empty, non-comment line. Returns 0, or -1 with
+// st->error set (left empty for out of memory).
+static int compile_line(CompiledScript *cs, CompileState *st, const char *line, int lineno) {
+    if (grow((void **)&cs->code, &cs->code_cap, cs->ncode, sizeof(Instr)) != 0) {
+        return -1;
+    }
+    int idx = cs->ncode;
+    Instr *in = &cs->code[idx];
+    memset(in, 0, sizeof(*in));
+    in->line = lineno;
+
+    if (lex_count(line) < 0) {
+        snprintf(st->error, sizeof(st->error), "unterminated quote");
+        return -1;
+    }
+
+    const char *p = line;
+    size_t len;
+    const char *word = next_word(&p, &len);
+    int is_block = 0;
+
+    if (word_is(word, len, "for") || word_is(word, len, "parallel")) {
+        in->op = OP_FOR;
+        if (word_is(word, len, "parallel")) {
+            word = next_word(&p, &len);
+            if (!word_is(word, len, "for")) {
+                snprintf(st->error, sizeof(st->error), "expected 'parallel for'");
+                return -1;
+            }
+            in->jobs = -1;
+            const char *save = p;
+            word = next_word(&p, &len);
+            if (word_is(word, len, "-j")) {
+                word = next_word(&p, &len);
+                char *end;
+                long n = word ? strtol(word, &end, 10) : 0;
+                if (!word || end != word + len || n <= 0 || n > 4096) {
+                    snprintf(st->error, sizeof(st->error), "parallel for: -j needs a number of jobs");
+                    return -1;
+                }
+                in->jobs = (int)n;
             } else {
-                // Variable not found, keep $VAR
-                *dst++ = '$';
-                strncpy(dst, var_name, sizeof(result) - (dst - result) - 1);
-                dst += strlen(var_name);
+                p = save;
+            }
+        }
+        word = next_word(&p, &len);
+        if (!word || !is_valid_name(word, len)) {
+            snprintf(st->error, sizeof(st->error), "for: expected a variable name");
+            return -1;
+        }
+        if ((in->name = add_string(cs, word, len)) < 0) {
+            return -1;
+        }
+        word = next_word(&p, &len);
+        if (!word_is(word, len, "in")) {
+            snprintf(st->error, sizeof(st->error), "for: expected 'in'");
+            return -1;
+        }
+        const char *rest = skip_space(p);
+        if (rest[0] == '<' && (rest[1] == ' ' || rest[1] == '\t' || rest[1] == '\0')) {
+            in->lines = 1;
+            rest = skip_space(rest + 1);
+            if (*rest == '\0') {
+                snprintf(st->error, sizeof(st->error), "for: expected a file after '<'");
+                return -1;
+            }
+        }
+        if (compile_words(cs, rest, strlen(rest), &in->list) != 0) {
+            return -1;
+        }
+        is_block = 1;
+    } else if (word_is(word, len, "if")) {
+        in->op = OP_IF;
+        const char *save = p;
+        word = next_word(&p, &len);
+        if (word_is(word, len, "not")) {
+            in->negate = 1;
+        } else {
+            p = save;
+        }
+        const char *cond = skip_space(p);
+        if (*cond == '\0') {
+            snprintf(st->error, sizeof(st->error), "if: missing condition");
+            return -1;
+        }
+        // "A op B" with exactly three words compares; anything else is a
+        // command whose exit status decides
+        const char *q = cond, *a, *op, *b;
+        size_t alen, oplen, blen, extra;
+        a = next_word(&q, &alen);
+        op = next_word(&q, &oplen);
+        b = next_word(&q, &blen);
+        CmpOp cmp = b && !next_word(&q, &extra) ? parse_cmp(op, oplen) : CMP_NONE;
+        if (cmp != CMP_NONE) {
+            in->cmp = cmp;
+            if (compile_words(cs, a, alen, &in->lhs) != 0 ||
+                compile_words(cs, b, blen, &in->rhs) != 0) {
+                return -1;
+            }
+        } else if (compile_cmd(cs, cond, strlen(cond), &in->cmd) != 0) {
+            return -1;
+        }
+        in->alt = -1;
+        is_block = 1;
+    } else if (word_is(word, len, "function")) {
+        in->op = OP_FUNCTION;
+        if (st->depth > 0) {
+            snprintf(st->error, sizeof(st->error), "functions can only be defined at the top level");
+            return -1;
+        }
+        word = next_word(&p, &len);
+        if (!word || !is_valid_name(word, len) || *skip_space(p) != '\0') {
+            snprintf(st->error, sizeof(st->error), "usage: function NAME");
+            return -1;
+        }
+        for (int i = 0; i < cs->nfuncs; i++) {
+            if (word_is(word, len, cs->strings + cs->code[cs->funcs[i]].name)) {
+                snprintf(st->error, sizeof(st->error), "function %.*s is already defined", (int)len, word);
+                return -1;
+            }
+        }
+        if ((in->name = add_string(cs, word, len)) < 0 ||
+            grow((void **)&cs->funcs, &cs->funcs_cap, cs->nfuncs, sizeof(int)) != 0) {
+            return -1;
+        }
+        cs->funcs[cs->nfuncs++] = idx;
+        is_block = 1;
+    } else if (word_is(word, len, "else") || word_is(word, len, "end") ||
+               word_is(word, len, "break") || word_is(word, len, "continue")) {
+        char keyword[16];
+        snprintf(keyword, sizeof(keyword), "%.*s", (int)len, word);
+        if (*skip_space(p) != '\0') {
+            snprintf(st->error, sizeof(st->error), "'%s' takes no arguments", keyword);
+            return -1;
+        }
+        if (keyword[0] == 'b' || keyword[0] == 'c') {
+            in->op = keyword[0] == 'b' ? OP_BREAK : OP_CONTINUE;
+            int in_loop = 0;
+            for (int i = 0; i < st->depth; i++) {
+                in_loop |= cs->code[st->stack[i]].op == OP_FOR;
+            }
+            if (!in_loop) {
+                snprintf(st->error, sizeof(st->error), "'%s' outside a loop", keyword);
+                return -1;
+            }
+        } else if (st->depth == 0) {
+            snprintf(st->error, sizeof(st->error), "'%s' without a block", keyword);
+            return -1;
+        } else if (keyword[1] == 'l') {
+            in->op = OP_ELSE;
+            Instr *open = &cs->code[st->stack[st->depth - 1]];
+            if (open->op != OP_IF || open->alt >= 0) {
+                snprintf(st->error, sizeof(st->error), "'else' without 'if'");
+                return -1;
+            }
+            open->alt = idx;
+        } else {
+            in->op = OP_END;
+            Instr *open = &cs->code[st->stack[--st->depth]];
+            open->end = idx;
+            if (open->op == OP_IF) {
+                if (open->alt >= 0) {
+                    cs->code[open->alt].end = idx;
+                } else {
+                    open->alt = idx;
+                }
             }
+        }
+    } else if (word_is(word, len, "return")) {
+        in->op = OP_RETURN;
+        const char *rest = skip_space(p);
+        if (compile_words(cs, rest, strlen(rest), &in->list) != 0) {
+            return -1;
+        }
+    } else {
+        in->op = OP_COMMAND;
+        if (compile_cmd(cs, line, strlen(line), &in->cmd) != 0) {
+            return -1;
+        }
+    }
+
+    if (in->op == OP_COMMAND) {
+        in->text = in->cmd.w.text;
+    } else if ((in->op == OP_FOR || in->op == OP_IF) &&
+               (in->text = add_string(cs, line, strlen(line))) < 0) {
+        return -1;
+    }
+
+    if (is_block) {
+        if (st->depth == MAX_CALL_DEPTH) {
+            snprintf(st->error, sizeof(st->error), "blocks nested too deeply");
+            return -1;
+        }
+        st->stack[st->depth++] = idx;
+    }
+    cs->ncode++;
+    return 0;
+}
+
+static void script_free(CompiledScript *cs) {
+    free(cs->strings);
+    free(cs->code);
+    free(cs->funcs);
+    free(cs->word_off);
+    free(cs->segs);
+    free(cs->slots);
+    free(cs);
+}
+
+// Called with cache_lock held
+static void script_unref(CompiledScript *cs) {
+    if (cs && --cs->refs == 0) {
+        script_free(cs);
+    }
+}
+
+static void script_release(CompiledScript *cs) {
+    pthread_mutex_lock(&cache_lock);
+    script_unref(cs);
+    pthread_mutex_unlock(&cache_lock);
+}
+
+static const char *keyword_of(OpCode op) {
+    return op == OP_FOR ? "for" : op == OP_IF ? "if" : "function";
+}
+
+// Compile a script, printing "file:line: error" for a syntax error
+static CompiledScript *script_compile(FILE *file, off_t size, const char *filename) {
+    CompiledScript *cs = calloc(1, sizeof(*cs));
+    CompileState *st = calloc(1, sizeof(*st));
+    char *source = malloc((size_t)size + 1);
+    if (!cs || !st || !source) {
+        free(source);
+        free(st);
+        free(cs);
+        fprintf(cli_err(), "script: out of memory\n");
+        return NULL;
+    }
+    size_t got = fread(source, 1, (size_t)size, file);
+    source[got] = '\0';
+
+    int lineno = 0, failed = 0;
+    for (char *line = source, *next; !failed && line && line < source + got; line = next) {
+        char *nl = memchr(line, '\n', (size_t)(source + got - line));
+        next = nl ? nl + 1 : NULL;
+        if (nl) *nl = '\0';
+        lineno++;
+
+        // Skip empty lines and comments
+        while (*line == ' ' || *line == '\t') line++;
+        if (*line == '\0' || *line == '#') continue;
+
+        failed = compile_line(cs, st, line, lineno) != 0;
+    }
+    if (!failed && st->depth > 0) {
+        const Instr *open = &cs->code[st->stack[st->depth - 1]];
+        lineno = open->line;
+        snprintf(st->error, sizeof(st->error), "'%s' without 'end'", keyword_of(open->op));
+        failed = 1;
+    }
+
+    // Functions may be called above their definition: resolve at the end
+    for (int i = 0; !failed && i < cs->ncode; i++) {
+        Cmd *c = &cs->code[i].cmd;
+        int has_cmd = cs->code[i].op == OP_COMMAND ||
+                      (cs->code[i].op == OP_IF && cs->code[i].cmp == CMP_NONE);
+        if (has_cmd && !c->dynamic) {
+            resolve_call(cs, cs->strings + c->name, c);
+        }
+    }
+
+    free(source);
+    if (failed) {
+        if (st->error[0]) {
+            fprintf(cli_err(), "%s:%d: %s\n", filename, lineno, st->error);
         } else {
-            *dst++ = *src++;
+            fprintf(cli_err(), "script: out of memory\n");
+        }
+        free(st);
+        script_free(cs);
+        return NULL;
+    }
+    free(st);
+    cs->refs = 1;
+    return cs;
+}
+
+// The compiled form of `filename`, compiling it if the cache has no
+// current copy. The caller owns one reference. NULL after printing an error.
+static CompiledScript *script_load(const char *filename) {
+    struct stat st;
+    if (stat(filename, &st) != 0) {
+        fprintf(cli_err(), "Cannot open script file: %s\n", filename);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&cache_lock);
+    CacheEntry *victim = &script_cache[0];
+    for (int i = 0; i < SCRIPT_CACHE_SIZE; i++) {
+        CacheEntry *e = &script_cache[i];
+        if (e->script && e->dev == st.st_dev && e->ino == st.st_ino) {
+            if (e->size == st.st_size && e->mtime.tv_sec == st.st_mtim.tv_sec &&
+                e->mtime.tv_nsec == st.st_mtim.tv_nsec) {
+                e->last_used = ++cache_clock;
+                e->script->refs++;
+                pthread_mutex_unlock(&cache_lock);
+                return e->script;
+            }
+            victim = e;             // changed on disk: recompile in place
+            break;
+        }
+        if (!victim->script) continue;
+        if (!e->script || e->last_used < victim->last_used) {
+            victim = e;
+        }
+    }
+
+    CompiledScript *cs = NULL;
+    FILE *file = fopen(filename, "r");
+    if (!file) {
+        fprintf(cli_err(), "Cannot open script file: %s\n", filename);
+    } else {
+        cs = script_compile(file, st.st_size, filename);
+        fclose(file);
+    }
+    if (cs) {
+        script_unref(victim->script);   // still alive while an older run uses it
+        victim->script = cs;
+        victim->dev = st.st_dev;
+        victim->ino = st.st_ino;
+        victim->size = st.st_size;
+        victim->mtime = st.st_mtim;
+        victim->last_used = ++cache_clock;
+        cs->refs++;
+    }
+    pthread_mutex_unlock(&cache_lock);
+    return cs;
+}
+
+// ---------------------------------------------------------------------------
+// Execution
+// ---------------------------------------------------------------------------
+
+// Growable line buffer; lines that fit stay on the stack
+typedef struct {
+    char  *data;
+    size_t len, cap;
+    char   small[1024];
+} LineBuf;
+
+static void linebuf_init(LineBuf *b) {
+    b->data = b->small;
+    b->len = 0;
+    b->cap = sizeof(b->small);
+    b->small[0] = '\0';
+}
+
+static int linebuf_append(LineBuf *b, const char *s, size_t n) {
+    if (b->len + n + 1 > b->cap) {
+        size_t cap = b->cap * 2 > b->len + n + 1 ? b->cap * 2 : b->len + n + 1;
+        char *grown = b->data == b->small ? malloc(cap) : realloc(b->data, cap);
+        if (!grown) {
+            return -1;
         }
+        if (b->data == b->small) {
+            memcpy(grown, b->small, b->len);
+        }
+        b->data = grown;
+        b->cap = cap;
     }
-    *dst = '\0';
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+    b->data[b->len] = '\0';
+    return 0;
+}
 
-    // Copy result back if it fits
-    if (strlen(result) < size) {
-        strncpy(line, result, size - 1);
-        line[size - 1] = '\0';
+static void linebuf_free(LineBuf *b) {
+    if (b->data != b->small) {
+        free(b->data);
     }
 }
 
-// Execute a command (similar to main.c's command dispatcher)
-static void execute_command_line(const char *line) {
-    if (!line || strlen(line) == 0) return;
+// Growable argv; always NULL-terminated
+typedef struct {
+    char **argv;
+    int    argc, cap;
+    char  *small[MAX_ARGS];
+} ArgList;
 
-    // Log the command
-    log_command(line);
+static void arglist_init(ArgList *a) {
+    a->argv = a->small;
+    a->argc = 0;
+    a->cap = MAX_ARGS;
+    a->argv[0] = NULL;
+}
 
-    // Tokenize
-    char line_copy[MAX_LINE_LENGTH];
-    strncpy(line_copy, line, sizeof(line_copy) - 1);
-    line_copy[sizeof(line_copy) - 1] = '\0';
+// Room for `more` entries after the current ones, plus the NULL
+static int arglist_reserve(ArgList *a, int more) {
+    if (a->argc + more + 1 > a->cap) {
+        int cap = a->cap * 2 > a->argc + more + 1 ? a->cap * 2 : a->argc + more + 1;
+        char **grown = a->argv == a->small ? malloc((size_t)cap * sizeof(char *))
+                                           : realloc(a->argv, (size_t)cap * sizeof(char *));
+        if (!grown) {
+            return -1;
+        }
+        if (a->argv == a->small) {
+            memcpy(grown, a->small, (size_t)a->argc * sizeof(char *));
+        }
+        a->argv = grown;
+        a->cap = cap;
+    }
+    return 0;
+}
 
-    char *argv[64];
-    int argc = 0;
-    char *token = strtok(line_copy, " \t");
-    while (token && argc < 63) {
-        argv[argc++] = token;
-        token = strtok(NULL, " \t");
+static int arglist_push(ArgList *a, char *arg) {
+    if (arglist_reserve(a, 1) != 0) {
+        return -1;
     }
-    argv[argc] = NULL;
+    a->argv[a->argc++] = arg;
+    a->argv[a->argc] = NULL;
+    return 0;
+}
 
-    if (argc == 0) return;
+static void arglist_free(ArgList *a) {
+    if (a->argv != a->small) {
+        free(a->argv);
+    }
+}
 
-    // Handle special scripting commands
-    if (strcmp(argv[0], "set") == 0) {
-        if (argc >= 3) {
-            set_variable(argv[1], argv[2]);
+// Append a variable's value so that the lexer reads it back as text:
+// backslash-escape what it would take as quoting (`special`)
+static int append_value(LineBuf *b, const char *value, size_t len, const char *special) {
+    size_t plain;
+    while ((plain = strcspn(value, special)) < len) {
+        if (linebuf_append(b, value, plain) != 0 || linebuf_append(b, "\\", 1) != 0 ||
+            linebuf_append(b, value + plain, 1) != 0) {
+            return -1;
         }
-        return;
+        value += plain + 1;
+        len -= plain + 1;
     }
+    return linebuf_append(b, value, len);
+}
 
-    if (strcmp(argv[0], "echo") == 0) {
-        for (int i = 1; i < argc; i++) {
-            printf("%s ", argv[i]);
+// Expand a line's pieces into b (unset variables stay as $NAME)
+static int expand_segments(const CompiledScript *cs, const Words *w, LineBuf *b) {
+    for (int i = 0; i < w->nsegs; i++) {
+        const Segment *seg = &cs->segs[w->first_seg + i];
+        int rc;
+        if (seg->kind == SEG_TEXT) {
+            rc = linebuf_append(b, cs->strings + seg->off, (size_t)seg->len);
+        } else {
+            const VarSlot *v = &cs->slots[seg->off];
+            const char *name = cs->strings + v->name;
+            const VarEntry *e = lookup_variable(name, v->len, v->hash);
+            if (e) {
+                rc = append_value(b, e->value, e->len,
+                                  seg->kind == SEG_VAR_QUOTED ? "\\\"" : "\\\"'");
+            } else {
+                rc = linebuf_append(b, "$", 1);
+                if (rc == 0) rc = linebuf_append(b, name, v->len);
+            }
+        }
+        if (rc != 0) {
+            return -1;
         }
-        printf("\n");
+    }
+    return 0;
+}
+
+// The words as one string, variables expanded and quotes removed but not split
+static const char *expand_text(const CompiledScript *cs, const Words *w, LineBuf *b) {
+    if (w->nsegs == 0) {
+        return cs->strings + w->value;
+    }
+    return expand_segments(cs, w, b) == 0 && lex_unquote(b->data) == 0 ? b->data : NULL;
+}
+
+// Expand and split into args (pointing into b); logs the line if `log`
+static int expand_args(const CompiledScript *cs, const Words *w, LineBuf *b, ArgList *args, int log) {
+    if (w->nsegs == 0) {
+        if (log) log_command(cs->strings + w->text);
+        // Commands may modify their arguments: give them a fresh copy
+        if (linebuf_append(b, cs->strings + w->words, (size_t)w->words_len) != 0) {
+            return -1;
+        }
+        for (int i = 0; i < w->argc; i++) {
+            if (arglist_push(args, b->data + cs->word_off[w->first_word + i]) != 0) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+    if (expand_segments(cs, w, b) != 0) {
+        return -1;
+    }
+    if (log) log_command(b->data);
+    // Quotes were checked at compile time and values are escaped, so this
+    // cannot fail on syntax. Words need a blank between them: short lines
+    // fit without counting first.
+    int n = (int)(b->len / 2) + 1;
+    if (n >= MAX_ARGS) {
+        n = lex_count(b->data);
+    }
+    if (n < 0 || arglist_reserve(args, n) != 0) {
+        return -1;
+    }
+    args->argc += lex_split(b->data, args->argv + args->argc);
+    return 0;
+}
+
+enum { FLOW_NEXT, FLOW_BREAK, FLOW_CONTINUE, FLOW_RETURN };
+
+static int run_block(const CompiledScript *cs, int from, int to);
+
+static void call_function(const CompiledScript *cs, int target, int argc, char *argv[]) {
+    ScriptContext *c = context();
+    if (c->call_depth >= MAX_CALL_DEPTH) {
+        fprintf(cli_err(), "%s: functions nested more than %d deep\n", argv[0], MAX_CALL_DEPTH);
+        cli_set_status(1);
+        return;
+    }
+    if (scope_push() != 0) {
+        fprintf(cli_err(), "script: out of memory\n");
+        cli_set_status(1);
         return;
     }
+    // $0 is the function, $1... its arguments, $ARGC how many
+    char num[16];
+    for (int i = 0; i < argc; i++) {
+        snprintf(num, sizeof(num), "%d", i);
+        set_variable(num, argv[i]);
+    }
+    snprintf(num, sizeof(num), "%d", argc - 1);
+    set_variable("ARGC", num);
 
-    // Check for built-in commands
-    struct {
-        const char *name;
-        void (*func)(int argc, char *argv[]);
-    } builtin_commands[] = {
-        {"hello", cmd_hello},
-        {"help", cmd_help},
-        {"clear", cmd_clear},
-        {"exec", cmd_exec},
-        {"list", cmd_list},
-        {"create", cmd_create},
-        {"copy", cmd_copy},
-        {"delete", cmd_delete},
-        {"run", cmd_run},
-        {"pslist", cmd_pslist},
-        {"fgproc", cmd_fgproc},
-        {"bgproc", cmd_bgproc},
-        {"killproc", cmd_killproc},
-        {"whoami", cmd_whoami},
-        {NULL, NULL}
-    };
+    cli_set_status(0);
+    c->call_depth++;
+    run_block(cs, target + 1, cs->code[target].end);
+    c->call_depth--;
+    scope_pop();
+}
+
+// Run a command line; its exit status is left in cli_status()
+static void run_command(const CompiledScript *cs, const Cmd *cmd) {
+    LineBuf buf;
+    ArgList args;
+    linebuf_init(&buf);
+    arglist_init(&args);
+
+    if (expand_args(cs, &cmd->w, &buf, &args, 1) != 0) {
+        fprintf(cli_err(), "script: out of memory\n");
+        cli_set_status(1);
+    } else if (args.argc > 0) {
+        Cmd resolved;
+        if (cmd->dynamic) {
+            resolved = *cmd;
+            resolve_call(cs, args.argv[0], &resolved);
+            cmd = &resolved;
+        }
+        int argc = args.argc;
+        char **argv = args.argv;
 
-    int found = 0;
-    for (int i = 0; builtin_commands[i].name != NULL; i++) {
-        if (strcmp(argv[0], builtin_commands[i].name) == 0) {
-            builtin_commands[i].func(argc, argv);
-            found = 1;
+        cli_set_status(0);
+        switch (cmd->kind) {
+        case CALL_SET:
+            if (argc >= 3) {
+                set_variable(argv[1], argv[2]);
+            }
+            break;
+        case CALL_ECHO:
+            for (int i = 1; i < argc; i++) {
+                cli_printf("%s ", argv[i]);
+            }
+            cli_printf("\n");
+            break;
+        case CALL_FUNCTION:
+            call_function(cs, cmd->target, argc, argv);
+            break;
+        case CALL_BUILTIN:
+            if (!cmd->builtin) {
+                cli_printf("Unknown command: %s\n", argv[0]);
+                cli_set_status(127);
+            } else if (cmd->builtin->flags & CMD_REPL_ONLY) {
+                fprintf(cli_err(), "%s: only available at the prompt\n", argv[0]);
+                cli_set_status(1);
+            } else if ((cmd->builtin->flags & (CMD_MAIN_THREAD | CMD_SECRET)) &&
+                       context()->parallel) {
+                fprintf(cli_err(), "%s: not available inside a parallel for\n", argv[0]);
+                cli_set_status(1);
+            } else if (registry_check(cmd->builtin, argc) == 0) {
+                profile_command(cmd->builtin->name);
+                cmd->builtin->func(argc, argv);
+            }
             break;
         }
     }
+    arglist_free(&args);
+    linebuf_free(&buf);
+}
+
+// Numbers compare as numbers, anything else as strings
+static int compare(const char *a, const char *b, CmpOp op) {
+    char *end_a, *end_b;
+    double x = strtod(a, &end_a), y = strtod(b, &end_b);
+    int diff;
+    if (*a && *b && *end_a == '\0' && *end_b == '\0') {
+        diff = (x > y) - (x < y);
+    } else {
+        diff = strcmp(a, b);
+        diff = (diff > 0) - (diff < 0);
+    }
+    switch (op) {
+    case CMP_EQ: return diff == 0;
+    case CMP_NE: return diff != 0;
+    case CMP_LT: return diff < 0;
+    case CMP_GT: return diff > 0;
+    case CMP_LE: return diff <= 0;
+    case CMP_GE: return diff >= 0;
+    default:     return 0;
+    }
+}
+
+static int eval_condition(const CompiledScript *cs, const Instr *in) {
+    int truth;
+    if (in->cmp == CMP_NONE) {
+        run_command(cs, &in->cmd);
+        truth = cli_status() == 0;
+    } else {
+        LineBuf a, b;
+        linebuf_init(&a);
+        linebuf_init(&b);
+        const char *lhs = expand_text(cs, &in->lhs, &a);
+        const char *rhs = expand_text(cs, &in->rhs, &b);
+        truth = lhs && rhs && compare(lhs, rhs, in->cmp);
+        linebuf_free(&a);
+        linebuf_free(&b);
+    }
+    if (in->negate) {
+        truth = !truth;
+    }
+    if (in->cmp != CMP_NONE || in->negate) {
+        cli_set_status(!truth);
+    }
+    return truth;
+}
+
+// Loop items, stored back to back
+typedef struct {
+    LineBuf text;
+    size_t *off;
+    int     n, cap;
+} ItemList;
+
+static int items_add(ItemList *items, const char *s, size_t len) {
+    if (grow((void **)&items->off, &items->cap, items->n, sizeof(size_t)) != 0) {
+        return -1;
+    }
+    items->off[items->n] = items->text.len;
+    if (linebuf_append(&items->text, s, len) != 0) {
+        return -1;
+    }
+    items->text.len++;      // keep the NUL
+    items->n++;
+    return 0;
+}
+
+// Collect the items of `for VAR in ...`: words (glob patterns expanded,
+// a pattern matching nothing yields nothing) or the lines of a file
+static int collect_items(const CompiledScript *cs, const Instr *in, ItemList *items) {
+    LineBuf buf;
+    ArgList args;
+    linebuf_init(&buf);
+    arglist_init(&args);
+    int rc = 0;
+
+    if (in->lines) {
+        const char *path = expand_text(cs, &in->list, &buf);
+        FILE *f = path ? fopen(path, "r") : NULL;
+        if (!f) {
+            fprintf(cli_err(), "for: %s: %s\n", path ? path : "", strerror(path ? errno : ENOMEM));
+            rc = -1;
+        } else {
+            char *line = NULL;
+            size_t cap = 0;
+            ssize_t n;
+            while (rc == 0 && (n = getline(&line, &cap, f)) >= 0) {
+                while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r')) n--;
+                rc = items_add(items, line, (size_t)n);
+            }
+            free(line);
+            fclose(f);
+        }
+    } else if (expand_args(cs, &in->list, &buf, &args, 0) != 0) {
+        rc = -1;
+    } else {
+        for (int i = 0; rc == 0 && i < args.argc; i++) {
+            const char *word = args.argv[i];
+            if (!strpbrk(word, "*?[")) {
+                rc = items_add(items, word, strlen(word));
+                continue;
+            }
+            glob_t g;
+            if (glob(word, 0, NULL, &g) == 0) {
+                for (size_t j = 0; rc == 0 && j < g.gl_pathc; j++) {
+                    rc = items_add(items, g.gl_pathv[j], strlen(g.gl_pathv[j]));
+                }
+            }
+            globfree(&g);
+        }
+    }
+    arglist_free(&args);
+    linebuf_free(&buf);
+    return rc;
+}
+
+// One iteration of a parallel for, run as a task on a worker
+typedef struct {
+    const CompiledScript *cs;
+    int                   from, to;
+    const char           *var, *value;
+    const ScriptContext  *parent;
+    ProfileFrame         *profile;      // the parallel for's frame when profiling
+    Task                 *task;
+    int                   job_id;
+    int                   status;
+} Iteration;
+
+static void iteration_run(void *arg) {
+    Iteration *it = arg;
+    ScriptContext c;
+    memset(&c, 0, sizeof(c));
+    c.parent = it->parent;
+    c.parallel = 1;
+    c.source_depth = it->parent->source_depth;
+    c.call_depth = it->parent->call_depth;
+    current = &c;
+    profile_attach(it->profile);
+
+    if (scope_push() == 0) {
+        set_variable(it->var, it->value);
+        cli_set_status(0);
+        run_block(it->cs, it->from, it->to);
+    } else {
+        fprintf(cli_err(), "script: out of memory\n");
+        cli_set_status(1);
+    }
+    it->status = cli_status();
+
+    while (c.nscopes > 0) {
+        scope_pop();
+    }
+    free(c.scopes);
+    profile_attach(NULL);
+    current = NULL;
+}
+
+// Wait for an iteration, print its output and forget its job
+static int iteration_finish(Iteration *it) {
+    Task *task = it->task;
+    task_wait(task);
+    if (task->output_len > 0) {
+        fwrite(task->output, 1, task->output_len, cli_out());
+    }
+    Job *job = job_find_by_id(it->job_id);
+    if (job) {
+        job_remove(job);
+    }
+    task_free(task);
+    return it->status;
+}
+
+// Iterations run as tasks on the worker pool, at most `jobs` at a time;
+// each one's output is printed in item order once it has finished
+static void run_parallel(const CompiledScript *cs, int at, const ItemList *items) {
+    const Instr *in = &cs->code[at];
+    int jobs = in->jobs > 0 ? in->jobs : worker_pool_size();
+    Iteration *its = calloc((size_t)items->n + 1, sizeof(Iteration));
+    if (!its) {
+        fprintf(cli_err(), "script: out of memory\n");
+        cli_set_status(1);
+        return;
+    }
+
+    int status = 0, next = 0;
+    for (int done = 0; done < items->n; done++) {
+        for (; next < items->n && next - done < jobs; next++) {
+            Iteration *it = &its[next];
+            it->cs = cs;
+            it->from = at + 1;
+            it->to = in->end;
+            it->var = cs->strings + in->name;
+            it->value = items->text.data + items->off[next];
+            it->parent = context();
+            it->profile = profile_current();
+
+            char cmd[256];
+            snprintf(cmd, sizeof(cmd), "parallel for %s=%s", it->var, it->value);
+            it->task = task_start_call(iteration_run, it, cmd, &it->job_id);
+        }
+        int rc = its[done].task ? iteration_finish(&its[done]) : 1;
+        if (rc != 0 && status == 0) {
+            status = rc;
+        }
+    }
+    free(its);
+    cli_set_status(status);
+}
 
-    // No plugin support
+static int run_for(const CompiledScript *cs, int at) {
+    const Instr *in = &cs->code[at];
+    ItemList items;
+    memset(&items, 0, sizeof(items));
+    linebuf_init(&items.text);
+    int flow = FLOW_NEXT;
 
-    if (!found) {
-        printf("Unknown command: %s\n", argv[0]);
+    if (collect_items(cs, in, &items) != 0) {
+        cli_set_status(1);
+    } else if (in->jobs != 0 && !context()->parallel) {
+        // A parallel for inside a parallel body runs sequentially
+        run_parallel(cs, at, &items);
+    } else {
+        const char *var = cs->strings + in->name;
+        cli_set_status(0);
+        for (int i = 0; i < items.n; i++) {
+            set_variable(var, items.text.data + items.off[i]);
+            flow = run_block(cs, at + 1, in->end);
+            if (flow == FLOW_BREAK || flow == FLOW_RETURN) {
+                break;
+            }
+        }
+        if (flow != FLOW_RETURN) {
+            flow = FLOW_NEXT;
+        }
     }
+    free(items.off);
+    linebuf_free(&items.text);
+    return flow;
+}
+
+// Under `source --profile` each command, loop (with its body) and if
+// condition is timed as a frame of its own
+static int run_block(const CompiledScript *cs, int from, int to) {
+    int i = from;
+    while (i < to) {
+        const Instr *in = &cs->code[i];
+        int flow = FLOW_NEXT, cond, profiled;
+        ProfileFrame frame;
+        switch (in->op) {
+        case OP_COMMAND:
+            profiled = profile_enter(&frame, NULL, in->line, cs->strings + in->text);
+            run_command(cs, &in->cmd);
+            if (profiled) profile_leave(&frame);
+            i++;
+            break;
+        case OP_FOR:
+            profiled = profile_enter(&frame, NULL, in->line, cs->strings + in->text);
+            flow = run_for(cs, i);
+            if (profiled) profile_leave(&frame);
+            i = in->end + 1;
+            break;
+        case OP_IF:
+            profiled = profile_enter(&frame, NULL, in->line, cs->strings + in->text);
+            cond = eval_condition(cs, in);
+            if (profiled) profile_leave(&frame);
+            if (cond) {
+                flow = run_block(cs, i + 1, in->alt);
+            } else if (in->alt < in->end) {
+                flow = run_block(cs, in->alt + 1, in->end);
+            }
+            i = in->end + 1;
+            break;
+        case OP_FUNCTION:
+            i = in->end + 1;        // defined, not run
+            break;
+        case OP_BREAK:
+            return FLOW_BREAK;
+        case OP_CONTINUE:
+            return FLOW_CONTINUE;
+        case OP_RETURN:
+            if (cs->strings[in->list.text] != '\0') {
+                LineBuf buf;
+                linebuf_init(&buf);
+                const char *value = expand_text(cs, &in->list, &buf);
+                cli_set_status(value ? atoi(value) : 1);
+                linebuf_free(&buf);
+            }
+            return FLOW_RETURN;
+        default:
+            i++;
+            break;
+        }
+        if (flow != FLOW_NEXT) {
+            return flow;
+        }
+    }
+    return FLOW_NEXT;
 }
 
 int script_is_cli_file(const char *filename) {
@@ -178,33 +1470,36 @@ int script_is_cli_file(const char *filename) {
 }
 
 int script_execute(const char *filename) {
-    FILE *file = fopen(filename, "r");
-    if (!file) {
-        fprintf(stderr, "Cannot open script file: %s\n", filename);
+    ScriptContext *c = context();
+    if (c->source_depth >= MAX_SOURCE_DEPTH) {
+        fprintf(cli_err(), "source: %s: scripts nested more than %d deep\n", filename, MAX_SOURCE_DEPTH);
+        return -1;
+    }
+    CompiledScript *cs = script_load(filename);
+    if (!cs) {
         return -1;
     }
 
-    char line[MAX_LINE_LENGTH];
-    printf("Executing script: %s\n", filename);
-
-    while (fgets(line, sizeof(line), file)) {
-        // Remove newline
-        line[strcspn(line, "\n")] = 0;
-
-        // Skip empty lines and comments
-        char *trimmed = line;
-        while (*trimmed == ' ' || *trimmed == '\t') trimmed++;
-        if (*trimmed == '\0' || *trimmed == '#') continue;
+    // The session scope holds top-level variables; nested scripts get their own
+    int scoped = c->source_depth > 0;
+    if ((c->nscopes == 0 || scoped) && scope_push() != 0) {
+        script_release(cs);
+        fprintf(cli_err(), "script: out of memory\n");
+        return -1;
+    }
 
-        // Expand variables
-        expand_variables(trimmed, sizeof(line));
+    cli_printf("Executing script: %s\n", filename);
+    ProfileFrame frame;
+    int profiled = profile_enter(&frame, filename, 0, NULL);
+    c->source_depth++;
+    run_block(cs, 0, cs->ncode);
+    c->source_depth--;
+    if (profiled) profile_leave(&frame);
+    cli_printf("Script execution completed.\n");
 
-        // Execute the command
-        execute_command_line(trimmed);
+    if (scoped) {
+        scope_pop();
     }
-
-    fclose(file);
-    printf("Script execution completed.\n");
+    script_release(cs);
     return 0;
 }
-
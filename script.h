@@ -8,6 +8,10 @@ int script_execute(const char *filename);
 // Check if a file is a .cli script
 int script_is_cli_file(const char *filename);
 
+// Call fn with the name of every variable the session holds: those set by
+// scripts run from the prompt. Main thread only, between commands.
+void script_each_variable(void (*fn)(const char *name, void *arg), void *arg);
+
 #endif
 
 
@@ -7,5 +7,8 @@
 // Global variable to track foreground child process (defined in main.c)
 extern volatile pid_t foreground_pid;
 
+// Set for `project -c` and `project script.cli`: no prompt to return to
+extern volatile sig_atomic_t in_batch;
+
 #endif
 
@@ -0,0 +1,231 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tasks.h"
+#include "jobs.h"
+#include "worker_pool.h"
+#include "cli_output.h"
+#include "audit.h"
+#include "metrics.h"
+
+// Task being executed by the calling worker thread, if any
+static __thread Task *current_task = NULL;
+
+static void task_run(void *arg) {
+    Task *task = arg;
+    AuditTimer timer;
+    audit_timer_start(&timer);
+    cli_set_status(0);
+
+    // A task cancelled while still queued never starts
+    if (!atomic_load(&task->cancel_requested)) {
+        atomic_store(&task->state, TASK_RUNNING);
+
+        FILE *capture = open_memstream(&task->output, &task->output_len);
+        cli_set_capture(capture);
+        current_task = task;
+
+        if (task->call) {
+            task->call(task->call_arg);
+        } else {
+            task->func(task->argc, task->argv);
+        }
+
+        current_task = NULL;
+        cli_set_capture(NULL);
+        if (capture) {
+            fclose(capture);
+        }
+    }
+    memset(task->secret, 0, sizeof(task->secret));
+    int status = atomic_load(&task->cancel_requested) ? 130 : cli_status();
+    audit_finish(&timer, task->argc, task->argv, status);
+    metrics_command_finished(status);
+
+    // Only the worker sets the final state, under the lock; task_free()
+    // takes the lock too, so it cannot free the task under our feet.
+    pthread_mutex_lock(&task->lock);
+    atomic_store(&task->state,
+                 atomic_load(&task->cancel_requested) ? TASK_CANCELLED : TASK_DONE);
+    pthread_cond_broadcast(&task->finished);
+    pthread_mutex_unlock(&task->lock);
+}
+
+// Allocate a task for argv (copied); the command line goes into cmd
+static Task *task_new(int argc, char *argv[], char *cmd, size_t cmd_size) {
+    Task *task = calloc(1, sizeof(Task));
+    char **copy = calloc(argc + 1, sizeof(char *));
+    if (!task || !copy) {
+        free(task);
+        free(copy);
+        cli_printf("Out of memory\n");
+        return NULL;
+    }
+
+    size_t len = 0;
+    cmd[0] = '\0';
+    for (int i = 0; i < argc; i++) {
+        copy[i] = strdup(argv[i]);
+        if (len < cmd_size) {
+            len += snprintf(cmd + len, cmd_size - len, "%s%s", i ? " " : "", argv[i]);
+        }
+    }
+
+    task->argc = argc;
+    task->argv = copy;
+    atomic_init(&task->state, TASK_QUEUED);
+    pthread_mutex_init(&task->lock, NULL);
+    pthread_cond_init(&task->finished, NULL);
+    return task;
+}
+
+// Register the task as a job and hand it to the worker pool
+static Job *task_queue(Task *task, const char *cmd) {
+    Job *job = job_add_task(task, cmd);
+    if (!job) {
+        cli_printf("Out of memory\n");
+        task_free(task);
+        return NULL;
+    }
+    if (worker_pool_submit(task_run, task) != 0) {
+        cli_printf("Cannot start background task\n");
+        job_remove(job);
+        task_free(task);
+        return NULL;
+    }
+    return job;
+}
+
+Task *task_start(void (*func)(int, char *[]), int argc, char *argv[], const char *secret) {
+    char cmd[256];
+    Task *task = task_new(argc, argv, cmd, sizeof(cmd));
+    if (!task) {
+        return NULL;
+    }
+    task->func = func;
+    if (secret) {
+        strncpy(task->secret, secret, sizeof(task->secret) - 1);
+        task->has_secret = 1;
+    }
+
+    Job *job = task_queue(task, cmd);
+    if (!job) {
+        return NULL;
+    }
+    cli_printf("[%d] started: %s\n", job->id, cmd);
+    return task;
+}
+
+Task *task_start_call(void (*call)(void *), void *arg, const char *cmd, int *job_id) {
+    char line[256];
+    char *argv[] = { (char *)cmd, NULL };
+    Task *task = task_new(1, argv, line, sizeof(line));
+    if (!task) {
+        return NULL;
+    }
+    task->call = call;
+    task->call_arg = arg;
+    atomic_store(&task->reported, 1);   // the caller reports it
+
+    Job *job = task_queue(task, line);
+    if (!job) {
+        return NULL;
+    }
+    *job_id = job->id;
+    return task;
+}
+
+void task_progress(long long done, long long total) {
+    if (current_task) {
+        atomic_store(&current_task->progress_total, total);
+        atomic_store(&current_task->progress_done, done);
+    }
+}
+
+int task_cancelled(void) {
+    return current_task && atomic_load(&current_task->cancel_requested);
+}
+
+int task_take_secret(char *buf, size_t size) {
+    if (!current_task || !current_task->has_secret) {
+        return 0;
+    }
+    strncpy(buf, current_task->secret, size - 1);
+    buf[size - 1] = '\0';
+    return 1;
+}
+
+void task_cancel(Task *task) {
+    atomic_store(&task->cancel_requested, 1);
+}
+
+void task_wait(Task *task) {
+    pthread_mutex_lock(&task->lock);
+    while (!task_finished(task)) {
+        pthread_cond_wait(&task->finished, &task->lock);
+    }
+    pthread_mutex_unlock(&task->lock);
+}
+
+int task_finished(const Task *task) {
+    int state = atomic_load(&((Task *)task)->state);
+    return state == TASK_DONE || state == TASK_CANCELLED;
+}
+
+void task_describe(const Task *task, char *buf, size_t size) {
+    Task *t = (Task *)task;
+    if (!task_finished(t) && atomic_load(&t->cancel_requested)) {
+        snprintf(buf, size, "cancelling");
+        return;
+    }
+    switch (atomic_load(&t->state)) {
+    case TASK_QUEUED:
+        snprintf(buf, size, "queued");
+        break;
+    case TASK_RUNNING: {
+        long long total = atomic_load(&t->progress_total);
+        long long done = atomic_load(&t->progress_done);
+        if (total > 0) {
+            snprintf(buf, size, "running %lld%%", done * 100 / total);
+        } else {
+            snprintf(buf, size, "running");
+        }
+        break;
+    }
+    case TASK_DONE:
+        snprintf(buf, size, "done");
+        break;
+    default:
+        snprintf(buf, size, "cancelled");
+        break;
+    }
+}
+
+void task_free(Task *task) {
+    if (!task) return;
+
+    // Wait for the worker to release the lock after publishing the final state
+    pthread_mutex_lock(&task->lock);
+    pthread_mutex_unlock(&task->lock);
+
+    for (int i = 0; i < task->argc && task->argv; i++) {
+        free(task->argv[i]);
+    }
+    free(task->argv);
+    free(task->output);
+    memset(task->secret, 0, sizeof(task->secret));
+    pthread_mutex_destroy(&task->lock);
+    pthread_cond_destroy(&task->finished);
+    free(task);
+}
+
+void tasks_report_finished(void) {
+    for (Job *job = job_first(); job; job = job->next) {
+        Task *task = job->task;
+        if (task && task_finished(task) && !atomic_exchange(&task->reported, 1)) {
+            printf("[%d] %s  %s  (fgproc %d for output)\n", job->id,
+                   atomic_load(&task->state) == TASK_DONE ? "Done" : "Cancelled",
+                   job->cmd, job->id);
+        }
+    }
+}
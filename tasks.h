@@ -0,0 +1,80 @@
+#ifndef TASKS_H
+#define TASKS_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+// A built-in command running on the worker pool ("checksum big.iso &").
+// Its output is captured in memory and shown by "fgproc <jobid>".
+
+typedef enum {
+    TASK_QUEUED,
+    TASK_RUNNING,
+    TASK_DONE,
+    TASK_CANCELLED
+} TaskState;
+
+typedef struct Task {
+    void  (*func)(int argc, char *argv[]);
+    int    argc;
+    char **argv;                  // owned, NULL-terminated copy
+
+    void  (*call)(void *arg);     // task_start_call(): runs instead of func
+    void  *call_arg;
+
+    char   secret[128];           // password read up front for encrypt/decrypt
+    int    has_secret;
+
+    char  *output;                // captured stdout+stderr (open_memstream)
+    size_t output_len;
+
+    atomic_int       state;       // TaskState
+    atomic_int       cancel_requested;
+    atomic_int       reported;    // "Done" notice already printed
+    atomic_llong     progress_done;
+    atomic_llong     progress_total;
+
+    pthread_mutex_t  lock;
+    pthread_cond_t   finished;
+} Task;
+
+// Queue a built-in as a background task and register it as a job.
+// `secret` may be NULL. Prints "[id] started: ..." and returns the task,
+// or NULL after printing an error.
+Task *task_start(void (*func)(int, char *[]), int argc, char *argv[], const char *secret);
+
+// Queue call(arg) as a task registered under job `cmd`, for a caller that
+// waits for it itself: no "started" or "Done" notices. Stores the job ID in
+// *job_id and returns the task, or NULL after printing an error. Once
+// task_finished() the caller prints task->output if it wants it, then
+// removes the job and frees the task.
+Task *task_start_call(void (*call)(void *), void *arg, const char *cmd, int *job_id);
+
+// Called from inside a built-in; no-ops when not running as a task
+void task_progress(long long done, long long total);
+int  task_cancelled(void);
+
+// Copy the pre-read secret of the current task into buf; returns 0 if none
+int  task_take_secret(char *buf, size_t size);
+
+// Request cancellation. A queued task never starts; a running one stops at
+// its next task_cancelled() check.
+void task_cancel(Task *task);
+
+// Block until the task has finished
+void task_wait(Task *task);
+
+// Non-zero once the task has finished or was cancelled
+int  task_finished(const Task *task);
+
+// "running 42%", "done", ... for pslist
+void task_describe(const Task *task, char *buf, size_t size);
+
+// Free a task; only valid once task_finished() is true
+void task_free(Task *task);
+
+// Print "[id] Done ..." once for every task that finished since last call
+void tasks_report_finished(void);
+
+#endif
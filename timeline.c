@@ -0,0 +1,431 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "timeline.h"
+
+#define MAGIC "SCTIMELN"
+#define VERSION 1
+#define HEADER_SIZE 16
+
+enum { FRAME_KEY = 1, FRAME_DELTA = 2 };
+
+// -------------------- Quantization --------------------
+
+static int64_t quantize(double v, double scale) {
+    v *= scale;
+    return (int64_t)(v < 0 ? v - 0.5 : v + 0.5);
+}
+
+// Fixed-point scalars of a sample, in frame order; returns how many
+static int to_scalars(const DashSample *s, int64_t *q) {
+    int n = 0;
+    q[n++] = s->time_ms;
+    q[n++] = s->uptime;
+    for (int i = 0; i < 3; i++) q[n++] = quantize(s->load[i], 100);
+    q[n++] = s->mem.total_kb;
+    q[n++] = s->mem.free_kb;
+    q[n++] = s->mem.available_kb;
+    q[n++] = s->tasks;
+    int ncpu = s->ncpu < 0 ? 0 : s->ncpu > DASH_MAX_CPUS ? DASH_MAX_CPUS : s->ncpu;
+    q[n++] = ncpu;
+    for (int i = 0; i <= ncpu; i++) q[n++] = quantize(s->cpu[i], 10);
+    for (int c = 0; c < DEV_COUNTERS; c++) q[n++] = quantize(s->disk[c], 10);
+    for (int c = 0; c < DEV_COUNTERS; c++) q[n++] = quantize(s->net[c], 10);
+    return n;
+}
+
+static int from_scalars(const int64_t *q, int n, DashSample *s) {
+    if (n < 10 || q[9] < 0 || q[9] > DASH_MAX_CPUS || n != 10 + (int)q[9] + 1 + 2 * DEV_COUNTERS) {
+        return -1;
+    }
+    int k = 0;
+    s->time_ms = q[k++];
+    s->uptime = (long)q[k++];
+    for (int i = 0; i < 3; i++) s->load[i] = q[k++] / 100.0;
+    s->mem.total_kb = (long)q[k++];
+    s->mem.free_kb = (long)q[k++];
+    s->mem.available_kb = (long)q[k++];
+    s->tasks = (int)q[k++];
+    s->ncpu = (int)q[k++];
+    for (int i = 0; i <= s->ncpu; i++) s->cpu[i] = (float)(q[k++] / 10.0);
+    for (int c = 0; c < DEV_COUNTERS; c++) s->disk[c] = q[k++] / 10.0;
+    for (int c = 0; c < DEV_COUNTERS; c++) s->net[c] = q[k++] / 10.0;
+    return 0;
+}
+
+// -------------------- Writing --------------------
+
+static void put_varint(TimelineWriter *w, uint64_t v) {
+    while (v >= 0x80) {
+        w->buf[w->len++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    w->buf[w->len++] = (unsigned char)v;
+}
+
+// Zigzag: small differences of either sign stay one byte
+static void put_signed(TimelineWriter *w, int64_t v) {
+    put_varint(w, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+static void put_bytes(TimelineWriter *w, const void *p, size_t n) {
+    memcpy(w->buf + w->len, p, n);
+    w->len += n;
+}
+
+static void encode(TimelineWriter *w, const DashSample *s, int key) {
+    TimelineState *prev = &w->prev;
+    if (key) {
+        memset(prev, 0, sizeof(*prev));
+    }
+
+    int64_t q[TIMELINE_MAX_SCALARS];
+    int n = to_scalars(s, q);
+    put_varint(w, (uint64_t)n);
+    for (int i = 0; i < n; i++) {
+        put_signed(w, q[i] - (i < prev->nq ? prev->q[i] : 0));
+    }
+    memcpy(prev->q, q, (size_t)n * sizeof(q[0]));
+    prev->nq = n;
+
+    // Processes are compared slot by slot: the same process in the same
+    // place costs three zero bytes and no name
+    int np = s->nprocs < 0 ? 0 : s->nprocs > DASH_MAX_PROCS ? DASH_MAX_PROCS : s->nprocs;
+    put_varint(w, (uint64_t)np);
+    for (int i = 0; i < np; i++) {
+        const ProcStat *p = &s->procs[i];
+        int had = i < prev->nprocs;
+        int64_t cpu = quantize(p->cpu, 10), mem = quantize(p->mem, 10);
+        put_signed(w, p->pid - (had ? prev->pid[i] : 0));
+        put_signed(w, cpu - (had ? prev->cpu[i] : 0));
+        put_signed(w, mem - (had ? prev->mem[i] : 0));
+        if (had && strcmp(p->comm, prev->comm[i]) == 0) {
+            put_varint(w, 0);
+        } else {
+            size_t len = strnlen(p->comm, PROC_COMM_LEN - 1);
+            put_varint(w, len + 1);
+            put_bytes(w, p->comm, len);
+            memcpy(prev->comm[i], p->comm, len);
+            prev->comm[i][len] = '\0';
+        }
+        prev->pid[i] = p->pid;
+        prev->cpu[i] = cpu;
+        prev->mem[i] = mem;
+    }
+    prev->nprocs = np;
+
+    // Log lines: all of them in a key frame, else only the new ones
+    int nlog = s->nlog < 0 ? 0 : s->nlog > DASH_LOG_LINES ? DASH_LOG_LINES : s->nlog;
+    int fresh = key ? nlog : (s->log_fresh < 0 ? 0 : s->log_fresh > nlog ? nlog : s->log_fresh);
+    put_varint(w, (uint64_t)fresh);
+    for (int i = nlog - fresh; i < nlog; i++) {
+        size_t len = strnlen(s->log[i], DASH_LINE_MAX - 1);
+        put_varint(w, len);
+        put_bytes(w, s->log[i], len);
+    }
+}
+
+int timeline_create(TimelineWriter *w, const char *path, int interval_ms) {
+    memset(w, 0, sizeof(*w));
+    w->buf = malloc(TIMELINE_FRAME_MAX);
+    if (!w->buf) {
+        return -1;
+    }
+    // Recordings include the command log: keep them private
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0 || !(w->f = fdopen(fd, "wb"))) {
+        int err = errno;
+        if (fd >= 0) close(fd);
+        free(w->buf);
+        w->buf = NULL;
+        errno = err;
+        return -1;
+    }
+
+    unsigned char header[HEADER_SIZE] = MAGIC;
+    uint32_t fields[2] = { VERSION, (uint32_t)interval_ms };
+    for (int f = 0; f < 2; f++) {
+        for (int b = 0; b < 4; b++) {
+            header[8 + 4 * f + b] = (unsigned char)(fields[f] >> (8 * b));
+        }
+    }
+    if (fwrite(header, 1, sizeof(header), w->f) != sizeof(header) || fflush(w->f) != 0) {
+        int err = errno;
+        timeline_close(w);
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+int timeline_append(TimelineWriter *w, const DashSample *s) {
+    if (!w->f) {
+        errno = EBADF;
+        return -1;
+    }
+    int key = w->count % TIMELINE_KEY_INTERVAL == 0;
+    w->len = 0;
+    encode(w, s, key);
+
+    unsigned char head[11];
+    size_t head_len = 0;
+    head[head_len++] = key ? FRAME_KEY : FRAME_DELTA;
+    for (uint64_t v = w->len; ; v >>= 7) {
+        head[head_len++] = (unsigned char)(v >= 0x80 ? (v | 0x80) : v);
+        if (v < 0x80) break;
+    }
+    // Both pieces land in the stdio buffer: one write per frame
+    if (fwrite(head, 1, head_len, w->f) != head_len ||
+        fwrite(w->buf, 1, w->len, w->f) != w->len || fflush(w->f) != 0) {
+        return -1;
+    }
+    w->count++;
+    return 0;
+}
+
+void timeline_close(TimelineWriter *w) {
+    if (w->f) fclose(w->f);
+    free(w->buf);
+    memset(w, 0, sizeof(*w));
+}
+
+// -------------------- Reading --------------------
+
+typedef struct {
+    const unsigned char *p, *end;
+    int bad;
+} Cursor;
+
+static uint64_t get_varint(Cursor *c) {
+    uint64_t v = 0;
+    for (int shift = 0; c->p < c->end && shift < 64; shift += 7) {
+        unsigned char b = *c->p++;
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) return v;
+    }
+    c->bad = 1;
+    return 0;
+}
+
+static int64_t get_signed(Cursor *c) {
+    uint64_t v = get_varint(c);
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static void get_bytes(Cursor *c, char *dst, size_t n) {
+    if ((size_t)(c->end - c->p) < n) {
+        c->bad = 1;
+        return;
+    }
+    memcpy(dst, c->p, n);
+    dst[n] = '\0';
+    c->p += n;
+}
+
+static void push_log(DashSample *s, const char *line) {
+    if (s->nlog == DASH_LOG_LINES) {
+        memmove(s->log[0], s->log[1], (DASH_LOG_LINES - 1) * sizeof(s->log[0]));
+        s->nlog--;
+    }
+    snprintf(s->log[s->nlog++], DASH_LINE_MAX, "%s", line);
+}
+
+// Apply one frame's payload to the state and the decoded sample
+static int decode(TimelineState *st, DashSample *s, int key, Cursor *c) {
+    if (key) {
+        memset(st, 0, sizeof(*st));
+        s->nlog = 0;
+    }
+
+    uint64_t n = get_varint(c);
+    if (c->bad || n > TIMELINE_MAX_SCALARS) return -1;
+    for (int i = 0; i < (int)n; i++) {
+        int64_t base = i < st->nq ? st->q[i] : 0;
+        st->q[i] = base + get_signed(c);
+    }
+    st->nq = (int)n;
+    if (c->bad || from_scalars(st->q, st->nq, s) != 0) return -1;
+
+    uint64_t np = get_varint(c);
+    if (c->bad || np > DASH_MAX_PROCS) return -1;
+    for (int i = 0; i < (int)np; i++) {
+        int had = i < st->nprocs;
+        st->pid[i] = (had ? st->pid[i] : 0) + get_signed(c);
+        st->cpu[i] = (had ? st->cpu[i] : 0) + get_signed(c);
+        st->mem[i] = (had ? st->mem[i] : 0) + get_signed(c);
+        uint64_t len = get_varint(c);
+        if (len == 0) {
+            if (!had) return -1;              // no previous name to keep
+        } else if (len - 1 < PROC_COMM_LEN) {
+            get_bytes(c, st->comm[i], (size_t)(len - 1));
+        } else {
+            return -1;
+        }
+        if (c->bad) return -1;
+        ProcStat *p = &s->procs[i];
+        p->pid = (pid_t)st->pid[i];
+        p->cpu = (float)(st->cpu[i] / 10.0);
+        p->mem = (float)(st->mem[i] / 10.0);
+        memcpy(p->comm, st->comm[i], PROC_COMM_LEN);
+    }
+    st->nprocs = s->nprocs = (int)np;
+
+    uint64_t fresh = get_varint(c);
+    if (c->bad || fresh > DASH_LOG_LINES) return -1;
+    for (int i = 0; i < (int)fresh; i++) {
+        char line[DASH_LINE_MAX];
+        uint64_t len = get_varint(c);
+        if (len >= DASH_LINE_MAX) return -1;
+        get_bytes(c, line, (size_t)len);
+        if (c->bad) return -1;
+        push_log(s, line);
+    }
+    s->log_fresh = (int)fresh;
+    return c->p == c->end ? 0 : -1;
+}
+
+// Locate the frame at `off`: its type and payload. Returns 0, or -1 if it
+// runs past the end of the file.
+static int frame_at(const TimelineReader *r, size_t off, int *type, Cursor *payload) {
+    Cursor c = { r->data + off, r->data + r->size, 0 };
+    if (c.p >= c.end) return -1;
+    *type = *c.p++;
+    uint64_t len = get_varint(&c);
+    if (c.bad || len > (uint64_t)(c.end - c.p)) return -1;
+    payload->p = c.p;
+    payload->end = c.p + len;
+    payload->bad = 0;
+    return 0;
+}
+
+static int decode_frame(TimelineReader *r, long index) {
+    int type;
+    Cursor c;
+    if (frame_at(r, r->offset[index], &type, &c) != 0 ||
+        (type != FRAME_KEY && type != FRAME_DELTA)) {
+        return -1;
+    }
+    return decode(&r->state, &r->cur, type == FRAME_KEY, &c);
+}
+
+int timeline_open(TimelineReader *r, const char *path) {
+    memset(r, 0, sizeof(*r));
+    r->pos = -1;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    if (st.st_size < HEADER_SIZE) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+    r->size = (size_t)st.st_size;
+    void *map = mmap(NULL, r->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    r->data = map;
+
+    uint32_t version = 0, interval = 0;
+    for (int b = 0; b < 4; b++) {
+        version |= (uint32_t)r->data[8 + b] << (8 * b);
+        interval |= (uint32_t)r->data[12 + b] << (8 * b);
+    }
+    if (memcmp(r->data, MAGIC, 8) != 0 || version != VERSION) {
+        timeline_close_reader(r);
+        errno = EINVAL;
+        return -1;
+    }
+    r->interval_ms = (int)interval;
+
+    // Index every frame, decoding each once to check it and learn its
+    // time; a torn or corrupt tail ends the recording there
+    long cap = 0;
+    size_t off = HEADER_SIZE;
+    int type;
+    Cursor c;
+    while (frame_at(r, off, &type, &c) == 0) {
+        if (r->count == cap) {
+            cap = cap ? cap * 2 : 1024;
+            size_t *offsets = realloc(r->offset, (size_t)cap * sizeof(*offsets));
+            if (offsets) r->offset = offsets;
+            int64_t *times = realloc(r->time_ms, (size_t)cap * sizeof(*times));
+            if (times) r->time_ms = times;
+            if (!offsets || !times) {
+                timeline_close_reader(r);
+                errno = ENOMEM;
+                return -1;
+            }
+        }
+        r->offset[r->count] = off;
+        if ((r->count == 0 && type != FRAME_KEY) || decode_frame(r, r->count) != 0) {
+            break;
+        }
+        r->time_ms[r->count++] = r->cur.time_ms;
+        off = (size_t)(c.end - r->data);
+    }
+    if (r->count == 0) {
+        timeline_close_reader(r);
+        errno = EINVAL;
+        return -1;
+    }
+    r->pos = -1;                  // a bad tail frame may have left `cur` half-applied
+    return 0;
+}
+
+int timeline_read(TimelineReader *r, long index, DashSample *out) {
+    if (index < 0 || index >= r->count) {
+        return -1;
+    }
+    long from;
+    if (r->pos >= 0 && index >= r->pos && index - r->pos <= TIMELINE_KEY_INTERVAL) {
+        from = r->pos + 1;                  // carry on from where we are
+    } else {
+        for (from = index; from > 0 && r->data[r->offset[from]] != FRAME_KEY; from--) {
+        }
+    }
+    for (long i = from; i <= index; i++) {
+        if (decode_frame(r, i) != 0) {
+            r->pos = -1;
+            return -1;
+        }
+        r->pos = i;
+    }
+    memcpy(out, &r->cur, sizeof(*out));
+    return 0;
+}
+
+long timeline_find(const TimelineReader *r, int64_t time_ms) {
+    long lo = 0, hi = r->count - 1;
+    while (lo < hi) {
+        long mid = lo + (hi - lo) / 2;
+        if (r->time_ms[mid] < time_ms) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+void timeline_close_reader(TimelineReader *r) {
+    if (r->data) munmap(r->data, r->size);
+    free(r->offset);
+    free(r->time_ms);
+    memset(r, 0, sizeof(*r));
+    r->pos = -1;
+}
@@ -0,0 +1,102 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "collectors.h"
+
+// Dashboard recordings: a compact binary timeline of everything the
+// dashboard showed, one frame per refresh.
+//
+// File: 16-byte header ("SCTIMELN", version, interval), then frames of
+// [type byte][varint payload length][payload]. A key frame holds a full
+// sample; a delta frame holds each field as a zigzag varint difference from
+// the previous frame (numbers quantized first: load x100, percentages and
+// rates x10), a process's name only when it changed, and only the log lines
+// added since. A key frame every TIMELINE_KEY_INTERVAL samples bounds the
+// work of a seek. A frame cut short by a crash is ignored when reading.
+
+#define DASH_MAX_PROCS 15
+#define DASH_MAX_CPUS 256
+#define DASH_LOG_LINES 20
+#define DASH_LINE_MAX 256
+
+// Everything one dashboard refresh displays
+typedef struct {
+    int64_t  time_ms;             // wall clock
+    long     uptime;
+    double   load[3];
+    MemInfo  mem;
+    int      tasks;
+    int      nprocs;
+    ProcStat procs[DASH_MAX_PROCS];
+    int      ncpu;
+    float    cpu[DASH_MAX_CPUS + 1];    // [0] = all CPUs
+    double   disk[DEV_COUNTERS];
+    double   net[DEV_COUNTERS];
+    int      nlog;                      // last command log lines, oldest first
+    int      log_fresh;                 // how many of them are new since the previous sample
+    char     log[DASH_LOG_LINES][DASH_LINE_MAX];
+} DashSample;
+
+#define TIMELINE_KEY_INTERVAL 64
+#define TIMELINE_MAX_SCALARS (16 + DASH_MAX_CPUS + 2 * DEV_COUNTERS)
+
+// Upper bound of one encoded frame (every field at its widest varint)
+#define TIMELINE_FRAME_MAX (TIMELINE_MAX_SCALARS * 10 + \
+                            DASH_MAX_PROCS * (3 * 10 + 1 + PROC_COMM_LEN) + \
+                            DASH_LOG_LINES * (2 + DASH_LINE_MAX) + 64)
+
+// Quantized state the next delta frame is relative to
+typedef struct {
+    int     nq;
+    int64_t q[TIMELINE_MAX_SCALARS];
+    int     nprocs;
+    int64_t pid[DASH_MAX_PROCS], cpu[DASH_MAX_PROCS], mem[DASH_MAX_PROCS];
+    char    comm[DASH_MAX_PROCS][PROC_COMM_LEN];
+} TimelineState;
+
+typedef struct {
+    FILE          *f;
+    long           count;         // frames written
+    TimelineState  prev;
+    unsigned char *buf;           // frame being encoded (TIMELINE_FRAME_MAX bytes)
+    size_t         len;
+} TimelineWriter;
+
+// Create (truncate) a recording. Returns 0, or -1 with errno set.
+int  timeline_create(TimelineWriter *w, const char *path, int interval_ms);
+
+// Append one sample and flush it, so a recording cut off by a crash keeps
+// everything up to the last refresh. Returns 0, or -1 with errno set.
+int  timeline_append(TimelineWriter *w, const DashSample *s);
+
+void timeline_close(TimelineWriter *w);
+
+typedef struct {
+    unsigned char *data;          // whole file, mapped read-only
+    size_t         size;
+    int            interval_ms;   // as recorded
+    long           count;         // complete frames
+    size_t        *offset;        // per frame
+    int64_t       *time_ms;       // per frame, for seeking by time
+    long           pos;           // frame `cur` holds, -1 if none
+    TimelineState  state;
+    DashSample     cur;
+} TimelineReader;
+
+// Map a recording and index its frames. Returns 0, or -1 with errno set
+// (EINVAL if it is not a recording or has no complete frame).
+int  timeline_open(TimelineReader *r, const char *path);
+
+// Decode frame `index` (0 <= index < count) into *out. Reading the next
+// frame decodes one delta; any other index restarts from its key frame.
+// Returns 0, or -1 if the frame is malformed.
+int  timeline_read(TimelineReader *r, long index, DashSample *out);
+
+// First frame recorded at or after `time_ms` (count - 1 if none)
+long timeline_find(const TimelineReader *r, int64_t time_ms);
+
+void timeline_close_reader(TimelineReader *r);
+
+#endif
@@ -0,0 +1,104 @@
+// Build-time generator for the command registry's lookup table.
+//
+// Usage: tools/gen_commands <output.h>
+//
+// Reads the command names from commands.def and searches for a hash seed
+// under which every name gets its own slot in a power-of-two table at least
+// twice the number of commands. The result is written as command_table.h:
+// the seed, the table size and, per slot, the command's index in
+// commands.def (-1 for an empty slot). Lookup is then one hash and one
+// strcmp. Fails on a duplicate name or if no seed is found.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "command_hash.h"
+
+#define MAX_SEEDS 10000000u
+
+static const char *names[] = {
+#define COMMAND(name, func, min_args, max_args, flags, complete, words, usage, summary) #name,
+#include "commands.def"
+#undef COMMAND
+};
+
+#define NCOMMANDS (int)(sizeof(names) / sizeof(names[0]))
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <output.h>\n", argv[0]);
+        return 1;
+    }
+
+    if (NCOMMANDS > 127) {
+        fprintf(stderr, "commands.def: more than 127 commands do not fit the slot type\n");
+        return 1;
+    }
+    for (int i = 0; i < NCOMMANDS; i++) {
+        for (int j = 0; j < i; j++) {
+            if (strcmp(names[i], names[j]) == 0) {
+                fprintf(stderr, "commands.def: duplicate command '%s'\n", names[i]);
+                return 1;
+            }
+        }
+    }
+
+    int size = 1;
+    while (size < 2 * NCOMMANDS) {
+        size <<= 1;
+    }
+    int *slots = malloc(size * sizeof(int));
+    if (!slots) {
+        perror("malloc");
+        return 1;
+    }
+
+    uint32_t seed;
+    for (seed = 1; seed < MAX_SEEDS; seed++) {
+        for (int i = 0; i < size; i++) {
+            slots[i] = -1;
+        }
+        int i;
+        for (i = 0; i < NCOMMANDS; i++) {
+            uint32_t slot = command_hash(names[i], seed) & (size - 1);
+            if (slots[slot] >= 0) {
+                break;
+            }
+            slots[slot] = i;
+        }
+        if (i == NCOMMANDS) {
+            break;
+        }
+    }
+    if (seed == MAX_SEEDS) {
+        fprintf(stderr, "%s: no collision-free seed for %d commands in %d slots\n",
+                argv[0], NCOMMANDS, size);
+        free(slots);
+        return 1;
+    }
+
+    FILE *out = fopen(argv[1], "w");
+    if (!out) {
+        perror(argv[1]);
+        free(slots);
+        return 1;
+    }
+    fprintf(out, "// Generated by tools/gen_commands from commands.def - do not edit.\n");
+    fprintf(out, "#define COMMAND_COUNT %d\n", NCOMMANDS);
+    fprintf(out, "#define COMMAND_HASH_SEED %uu\n", seed);
+    fprintf(out, "#define COMMAND_TABLE_SIZE %d\n\n", size);
+    fprintf(out, "// Index into commands.def by command_hash(name, COMMAND_HASH_SEED) & (COMMAND_TABLE_SIZE - 1)\n");
+    fprintf(out, "static const signed char command_slots[COMMAND_TABLE_SIZE] = {");
+    for (int i = 0; i < size; i++) {
+        fprintf(out, "%s%d%s", i % 16 ? " " : "\n    ", slots[i], i + 1 < size ? "," : "");
+    }
+    fprintf(out, "\n};\n");
+    free(slots);
+
+    if (fclose(out) != 0) {
+        perror(argv[1]);
+        return 1;
+    }
+    return 0;
+}
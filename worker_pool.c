@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include "worker_pool.h"
+
+#define MIN_WORKERS 2
+#define MAX_WORKERS 8
+
+typedef struct WorkItem {
+    void (*fn)(void *arg);
+    void *arg;
+    struct WorkItem *next;
+} WorkItem;
+
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  queue_ready = PTHREAD_COND_INITIALIZER;
+static WorkItem *queue_head = NULL, *queue_tail = NULL;
+static int worker_count = 0;
+
+static void *worker_main(void *unused) {
+    (void)unused;
+    for (;;) {
+        pthread_mutex_lock(&queue_lock);
+        while (!queue_head) {
+            pthread_cond_wait(&queue_ready, &queue_lock);
+        }
+        WorkItem *item = queue_head;
+        queue_head = item->next;
+        if (!queue_head) queue_tail = NULL;
+        pthread_mutex_unlock(&queue_lock);
+
+        item->fn(item->arg);
+        free(item);
+    }
+    return NULL;
+}
+
+// Called with queue_lock held
+static void start_workers(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int wanted = (cpus < MIN_WORKERS) ? MIN_WORKERS : (cpus > MAX_WORKERS ? MAX_WORKERS : (int)cpus);
+
+    // Threads inherit the creator's mask: block terminal signals while creating
+    sigset_t block, old;
+    sigemptyset(&block);
+    sigaddset(&block, SIGINT);
+    sigaddset(&block, SIGTERM);
+    sigaddset(&block, SIGWINCH);   // ncurses expects it on the main thread
+    pthread_sigmask(SIG_BLOCK, &block, &old);
+
+    for (int i = 0; i < wanted; i++) {
+        pthread_t tid;
+        if (pthread_create(&tid, NULL, worker_main, NULL) != 0) {
+            break;
+        }
+        pthread_detach(tid);
+        worker_count++;
+    }
+
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+}
+
+int worker_pool_submit(void (*fn)(void *arg), void *arg) {
+    WorkItem *item = malloc(sizeof(WorkItem));
+    if (!item) {
+        return -1;
+    }
+    item->fn = fn;
+    item->arg = arg;
+    item->next = NULL;
+
+    pthread_mutex_lock(&queue_lock);
+    if (worker_count == 0) {
+        start_workers();
+    }
+    if (worker_count == 0) {
+        pthread_mutex_unlock(&queue_lock);
+        free(item);
+        return -1;
+    }
+    if (queue_tail) queue_tail->next = item; else queue_head = item;
+    queue_tail = item;
+    pthread_cond_signal(&queue_ready);
+    pthread_mutex_unlock(&queue_lock);
+    return 0;
+}
+
+int worker_pool_size(void) {
+    pthread_mutex_lock(&queue_lock);
+    if (worker_count == 0) {
+        start_workers();
+    }
+    int n = worker_count;
+    pthread_mutex_unlock(&queue_lock);
+    return n;
+}
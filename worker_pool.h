@@ -0,0 +1,14 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+// Shared pool of worker threads for work that must not block the REPL.
+// Threads are started on first use and run with SIGINT/SIGTERM blocked,
+// so terminal signals are always delivered to the main thread.
+
+// Queue fn(arg) to run on a worker. Returns 0, or -1 if it could not be queued.
+int worker_pool_submit(void (*fn)(void *arg), void *arg);
+
+// Number of worker threads (starts the pool if needed)
+int worker_pool_size(void);
+
+#endif